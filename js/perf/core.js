@@ -1,9 +1,14 @@
 // -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
 
+const Clutter = imports.gi.Clutter;
+const GLib = imports.gi.GLib;
+const Shell = imports.gi.Shell;
+const St = imports.gi.St;
 const System = imports.system;
 
 const Main = imports.ui.main;
 const Scripting = imports.ui.scripting;
+const Tweener = imports.ui.tweener;
 
 // This performance script measure the most important (core) performance
 // metrics for the shell. By looking at the output metrics of this script
@@ -20,6 +25,9 @@ let METRICS = {
     overviewLatencySubsequent:
     { description: "Time to first frame after triggering overview, second time",
       units: "us"},
+    overviewLatencyFirstOverhead:
+    { description: "Additional time to first frame the first time the overview is triggered, compared to the second time",
+      units: "us"},
     overviewFpsSubsequent:
     { description: "Frames rate when going to the overview, second time",
       units: "frames / s" },
@@ -47,14 +55,115 @@ let METRICS = {
     leakedAfterOverview:
     { description: "Additional malloc'ed bytes the second time the overview is shown",
       units: "B" },
+    leakedInstancesAfterOverview:
+    { description: "Additional live widgets after the last time the overview is shown, compared to the first; see the leakedInstancesAfterOverview.<type> metrics for a breakdown",
+      units: "widgets" },
+    textureBytesAfterOverview:
+    { description: "Texture memory kept by St after the overview is shown once",
+      units: "B" },
+    leakedTextureBytesAfterOverview:
+    { description: "Additional texture memory kept by St the second time the overview is shown",
+      units: "B" },
+    gcPauseMax:
+    { description: "Longest JavaScript garbage collection pause during the test",
+      units: "us" },
     applicationsShowTimeFirst:
     { description: "Time to switch to applications view, first time",
       units: "us" },
     applicationsShowTimeSubsequent:
     { description: "Time to switch to applications view, second time",
-      units: "us"}
+      units: "us"},
+    pickLatencyColor:
+    { description: "Time to pick the actor under the pointer in the overview, by painting",
+      units: "us" },
+    pickLatencyGeometric:
+    { description: "Time to pick the actor under the pointer in the overview, geometrically",
+      units: "us" },
+    pickLatencyGeometricRedraw:
+    { description: "Time to pick the actor under the pointer in the overview, geometrically, with a redraw queued before each pick",
+      units: "us" },
+    pickLatencyColorAnimating:
+    { description: "Time to pick the actor under the pointer in the overview once per frame while an actor moves, by painting",
+      units: "us" },
+    pickLatencyGeometricAnimating:
+    { description: "Time to pick the actor under the pointer in the overview once per frame while an actor moves, geometrically",
+      units: "us" },
+    overviewDrawCallsPerFrame:
+    { description: "Rectangle batches submitted to paint theme node backgrounds and borders per frame, in the overview",
+      units: "calls / frame" }
 };
 
+const DRAW_CALL_FRAMES = 10;
+
+// Returns the number of live widgets of each type
+function _getInstanceCounts() {
+    let counts = {};
+    let types = St.statistics_get_instance_types();
+    for (let i = 0; i < types.length; i++)
+        counts[types[i]] = St.statistics_get_instance_count(types[i]);
+    return counts;
+}
+
+// Sets leakedInstancesAfterOverview, and a metric for each type whose
+// number of widgets changed between @before and @after
+function _setLeakedInstances(before, after) {
+    let total = 0;
+    let types = {};
+    for (let type in before)
+        types[type] = true;
+    for (let type in after)
+        types[type] = true;
+
+    for (let type in types) {
+        let leaked = (after[type] || 0) - (before[type] || 0);
+        if (leaked == 0)
+            continue;
+
+        METRICS['leakedInstancesAfterOverview.' + type] =
+            { description: "Additional live " + type + " widgets after the last time the overview is shown, compared to the first",
+              units: "widgets",
+              value: leaked };
+        total += leaked;
+    }
+
+    METRICS.leakedInstancesAfterOverview.value = total;
+}
+
+const PICK_GRID_SIZE = 10;
+const PICK_ANIMATION_TIME = 2; // seconds
+const PICK_ANIMATION_INTERVAL = 16; // milliseconds
+
+// The n-th point of a grid covering the stage
+function _getPickPoint(n) {
+    let i = Math.floor(n / PICK_GRID_SIZE) % PICK_GRID_SIZE;
+    let j = n % PICK_GRID_SIZE;
+
+    return [Math.floor((i + 0.5) * global.stage.width / PICK_GRID_SIZE),
+            Math.floor((j + 0.5) * global.stage.height / PICK_GRID_SIZE)];
+}
+
+// Picks on a grid of points covering the stage, the way a moving pointer
+// would, and returns the average time per pick in microseconds
+function _measurePicks(pickFunc) {
+    let count = PICK_GRID_SIZE * PICK_GRID_SIZE;
+    let start = GLib.get_monotonic_time();
+
+    for (let n = 0; n < count; n++) {
+        let [x, y] = _getPickPoint(n);
+        pickFunc(x, y);
+    }
+
+    return Math.round((GLib.get_monotonic_time() - start) / count);
+}
+
+function _pickColor(x, y) {
+    global.stage.get_actor_at_pos(Clutter.PickMode.REACTIVE, x, y);
+}
+
+function _pickGeometric(x, y) {
+    Shell.util_get_actor_at_pos(global.stage, Clutter.PickMode.REACTIVE, x, y);
+}
+
 let WINDOW_CONFIGS = [
     { width: 640, height: 480, alpha: false, maximized: false, count: 1,  metric: 'overviewFpsSubsequent' },
     { width: 640, height: 480, alpha: false, maximized: false, count: 5,  metric: 'overviewFps5Windows'  },
@@ -78,6 +187,7 @@ function run() {
 
     yield Scripting.sleep(1000);
 
+    let firstInstances;
     for (let i = 0; i < 2 * WINDOW_CONFIGS.length; i++) {
         // We go to the overview twice for each configuration; the first time
         // to calculate the mipmaps for the windows, the second time to get
@@ -105,6 +215,13 @@ function run() {
         yield Scripting.sleep(1000);
         Scripting.collectStatistics();
         Scripting.scriptEvent('afterShowHide');
+
+        // The counts can't be recorded in the perf log, so unlike the
+        // other metrics these are computed while the script runs
+        if (i == 0)
+            firstInstances = _getInstanceCounts();
+        else if (i == 2 * WINDOW_CONFIGS.length - 1)
+            _setLeakedInstances(firstInstances, _getInstanceCounts());
     }
 
     yield Scripting.destroyTestWindows();
@@ -113,6 +230,71 @@ function run() {
     Main.overview.show();
     yield Scripting.waitLeisure();
 
+    let perfLog = Shell.PerfLog.get_default();
+    perfLog.define_event('pick.colorLatency', 'Average time of a color-buffer pick', 'x');
+    perfLog.define_event('pick.geometricLatency', 'Average time of a geometric pick', 'x');
+    perfLog.define_event('pick.geometricRedrawLatency',
+                         'Average time of a geometric pick after a queued redraw', 'x');
+    perfLog.define_event('pick.colorAnimatingLatency',
+                         'Average time of a color-buffer pick per frame of an animation', 'x');
+    perfLog.define_event('pick.geometricAnimatingLatency',
+                         'Average time of a geometric pick per frame of an animation', 'x');
+
+    perfLog.event_x('pick.colorLatency', _measurePicks(_pickColor));
+    perfLog.event_x('pick.geometricLatency', _measurePicks(_pickGeometric));
+    perfLog.event_x('pick.geometricRedrawLatency', _measurePicks(function(x, y) {
+        global.stage.queue_redraw();
+        _pickGeometric(x, y);
+    }));
+
+    // Something moving on the stage queues a redraw every frame, like a
+    // drag over the overview while windows are rearranged
+    let animated = new Clutter.Actor({ width: 100, height: 100, reactive: true });
+    Main.uiGroup.add_actor(animated);
+
+    let animatingPicks = [['pick.colorAnimatingLatency', _pickColor],
+                          ['pick.geometricAnimatingLatency', _pickGeometric]];
+    for (let k = 0; k < animatingPicks.length; k++) {
+        let [event, pickFunc] = animatingPicks[k];
+        let pickTime = 0;
+        let count = 0;
+
+        animated.x = 0;
+        Tweener.addTween(animated, { x: global.stage.width - animated.width,
+                                     time: PICK_ANIMATION_TIME,
+                                     transition: 'linear' });
+
+        while (Tweener.isTweening(animated)) {
+            let [x, y] = _getPickPoint(count);
+            let start = GLib.get_monotonic_time();
+            pickFunc(x, y);
+            pickTime += GLib.get_monotonic_time() - start;
+            count++;
+
+            yield Scripting.sleep(PICK_ANIMATION_INTERVAL);
+        }
+
+        perfLog.event_x(event, Math.round(pickTime / Math.max(count, 1)));
+    }
+
+    animated.destroy();
+
+    perfLog.define_event('st.drawCallsPerFrame',
+                         'Average number of theme node draw calls per frame', 'x');
+
+    let drawCallsStart = St.statistics_get(St.Statistic.THEME_NODE_DRAW_CALLS);
+    let frames = 0;
+    let paintId = global.stage.connect_after('paint', function() {
+        frames++;
+    });
+    for (let i = 0; i < DRAW_CALL_FRAMES; i++) {
+        global.stage.queue_redraw();
+        yield Scripting.waitLeisure();
+    }
+    global.stage.disconnect(paintId);
+    let drawCalls = St.statistics_get(St.Statistic.THEME_NODE_DRAW_CALLS) - drawCallsStart;
+    perfLog.event_x('st.drawCallsPerFrame', Math.round(drawCalls / Math.max(frames, 1)));
+
     for (let i = 0; i < 2; i++) {
         Scripting.scriptEvent('applicationsShowStart');
         Main.overview._dash.showAppsButton.checked = true;
@@ -129,6 +311,7 @@ let overviewShowStart;
 let overviewFrames;
 let overviewLatency;
 let mallocUsedSize = 0;
+let textureBytes = 0;
 let overviewShowCount = 0;
 let firstOverviewUsedSize;
 let haveSwapComplete = false;
@@ -164,15 +347,49 @@ function script_applicationsShowDone(time) {
 function script_afterShowHide(time) {
     if (overviewShowCount == 1) {
         METRICS.usedAfterOverview.value = mallocUsedSize;
+        METRICS.textureBytesAfterOverview.value = textureBytes;
     } else {
         METRICS.leakedAfterOverview.value = mallocUsedSize - METRICS.usedAfterOverview.value;
+        METRICS.leakedTextureBytesAfterOverview.value = textureBytes - METRICS.textureBytesAfterOverview.value;
     }
 }
 
+function pick_colorLatency(time, latency) {
+    METRICS.pickLatencyColor.value = latency;
+}
+
+function pick_geometricLatency(time, latency) {
+    METRICS.pickLatencyGeometric.value = latency;
+}
+
+function pick_geometricRedrawLatency(time, latency) {
+    METRICS.pickLatencyGeometricRedraw.value = latency;
+}
+
+function pick_colorAnimatingLatency(time, latency) {
+    METRICS.pickLatencyColorAnimating.value = latency;
+}
+
+function pick_geometricAnimatingLatency(time, latency) {
+    METRICS.pickLatencyGeometricAnimating.value = latency;
+}
+
+function st_drawCallsPerFrame(time, drawCalls) {
+    METRICS.overviewDrawCallsPerFrame.value = drawCalls;
+}
+
 function malloc_usedSize(time, bytes) {
     mallocUsedSize = bytes;
 }
 
+function st_textureBytes(time, bytes) {
+    textureBytes = bytes;
+}
+
+function gc_pause(time, duration) {
+    METRICS.gcPauseMax.value = Math.max(METRICS.gcPauseMax.value || 0, duration);
+}
+
 function _frameDone(time) {
     if (showingOverview) {
         if (overviewFrames == 0)
@@ -197,6 +414,8 @@ function _frameDone(time) {
             METRICS.overviewFpsFirst.value = fps;
         } else if (overviewShowCount == 2) {
             METRICS.overviewLatencySubsequent.value = overviewLatency;
+            METRICS.overviewLatencyFirstOverhead.value =
+                METRICS.overviewLatencyFirst.value - overviewLatency;
         }
 
         // Other than overviewFpsFirst, we collect FPS metrics the second
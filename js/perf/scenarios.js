@@ -0,0 +1,291 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+const Clutter = imports.gi.Clutter;
+const Shell = imports.gi.Shell;
+
+const AltTab = imports.ui.altTab;
+const Main = imports.ui.main;
+const MessageTray = imports.ui.messageTray;
+const Scripting = imports.ui.scripting;
+
+// This performance script runs a set of interactive scenarios. Unlike
+// the core script, each metric is a series of samples, one per
+// keystroke, frame or click, so that gnome-shell-perf-tool can report
+// how slow the slowest cases are and not just a single value.
+
+let METRICS = {
+    notificationStormFrameTime:
+    { description: "Time between frames while 50 notifications arrive from 10 sources, with 20 tray icons and 2 animated windows",
+      units: "us" },
+    menuOpenLatency:
+    { description: "Time to first frame after opening a panel menu",
+      units: "us" },
+    searchKeystrokeLatency:
+    { description: "Time to first frame after each keystroke while typing a search in the overview",
+      units: "us" },
+    altTabLatency50Windows:
+    { description: "Time to the first frame showing the popup after starting to Alt+Tab between 50 windows of an application, including the popup delay",
+      units: "us" },
+    calendarMonthFlipLatency:
+    { description: "Time to first frame after switching the calendar to the next or previous month",
+      units: "us" }
+};
+
+const STORM_SOURCES = 10;
+const STORM_NOTIFICATIONS_PER_SOURCE = 5;
+const STORM_INTERVAL = 20; // milliseconds
+const STORM_SETTLE_TIME = 2000; // milliseconds
+const STORM_TRAY_ICONS = 20;
+const STORM_ANIMATED_WINDOWS = 2;
+
+const MENUS = ['dateMenu', 'userMenu', 'volume'];
+const MENU_OPEN_REPEATS = 5;
+
+const SEARCH_STRINGS = ['terminal', 'settings', 'calculator'];
+const KEYSTROKE_INTERVAL = 100; // milliseconds
+
+const ALT_TAB_WINDOWS = 50;
+const ALT_TAB_REPEATS = 5;
+
+const CALENDAR_FLIPS = 12;
+
+// The time from here to the next frame is recorded as a sample of @metric
+function _sampleStart(metric) {
+    Shell.PerfLog.get_default().event_s('scenario.sampleStart', metric);
+}
+
+// Frames painted between these don't end the current sample; for
+// actions whose result only shows up after a while
+function _sampleHold() {
+    Shell.PerfLog.get_default().event('scenario.sampleHold');
+}
+
+function _sampleRelease() {
+    Shell.PerfLog.get_default().event('scenario.sampleRelease');
+}
+
+function run() {
+    let perfLog = Shell.PerfLog.get_default();
+    perfLog.define_event('scenario.sampleStart',
+                         'Start of an action measured until the next frame; argument is the metric', 's');
+    perfLog.define_event('scenario.sampleHold',
+                         'Start of frames that do not end the current sample', '');
+    perfLog.define_event('scenario.sampleRelease',
+                         'End of frames that do not end the current sample', '');
+    perfLog.define_event('scenario.framesStart',
+                         'Start of measuring the time between frames; argument is the metric', 's');
+    perfLog.define_event('scenario.framesDone',
+                         'End of measuring the time between frames', '');
+
+    yield Scripting.sleep(1000);
+
+    // Notification storm
+    yield Scripting.createTestTrayIcons(STORM_TRAY_ICONS);
+    for (let i = 0; i < STORM_ANIMATED_WINDOWS; i++)
+        yield Scripting.createAnimatedTestWindow(640, 480, false, false);
+    yield Scripting.waitTestWindows();
+    yield Scripting.sleep(1000);
+
+    let sources = [];
+    for (let i = 0; i < STORM_SOURCES; i++) {
+        let source = new MessageTray.SystemNotificationSource();
+        Main.messageTray.add(source);
+        sources.push(source);
+    }
+
+    perfLog.event_s('scenario.framesStart', 'notificationStormFrameTime');
+    for (let i = 0; i < STORM_NOTIFICATIONS_PER_SOURCE; i++) {
+        for (let j = 0; j < sources.length; j++) {
+            let notification = new MessageTray.Notification(sources[j],
+                                                            "Notification " + (i + 1),
+                                                            "Sent by the performance test");
+            notification.setTransient(true);
+            sources[j].notify(notification);
+
+            yield Scripting.sleep(STORM_INTERVAL);
+        }
+    }
+    yield Scripting.sleep(STORM_SETTLE_TIME);
+    perfLog.event('scenario.framesDone');
+
+    for (let i = 0; i < sources.length; i++)
+        sources[i].destroy();
+
+    yield Scripting.destroyTestWindows();
+    yield Scripting.sleep(1000);
+    yield Scripting.waitLeisure();
+
+    // Popup menus
+    for (let i = 0; i < MENUS.length; i++) {
+        let indicator = Main.panel.statusArea[MENUS[i]];
+        if (!indicator || !indicator.menu)
+            continue;
+
+        for (let k = 0; k < MENU_OPEN_REPEATS; k++) {
+            _sampleStart('menuOpenLatency');
+            indicator.menu.open(true);
+            yield Scripting.waitLeisure();
+
+            indicator.menu.close(false);
+            yield Scripting.waitLeisure();
+        }
+    }
+
+    // Calendar
+    let dateMenu = Main.panel.statusArea.dateMenu;
+    if (dateMenu) {
+        dateMenu.menu.open(false);
+        yield Scripting.waitLeisure();
+
+        let calendar = dateMenu._calendar;
+        for (let i = 0; i < CALENDAR_FLIPS; i++) {
+            _sampleStart('calendarMonthFlipLatency');
+            if (i < CALENDAR_FLIPS / 2)
+                calendar._onNextMonthButtonClicked();
+            else
+                calendar._onPrevMonthButtonClicked();
+            yield Scripting.waitLeisure();
+        }
+
+        dateMenu.menu.close(false);
+        yield Scripting.waitLeisure();
+    }
+
+    // Search; we don't wait for the results between keystrokes, so
+    // searching delays the frames of the following keystrokes the way
+    // it would when typing
+    Main.overview.show();
+    yield Scripting.waitLeisure();
+
+    let searchEntry = Main.overview._searchEntry;
+    for (let i = 0; i < SEARCH_STRINGS.length; i++) {
+        let text = SEARCH_STRINGS[i];
+        for (let k = 1; k <= text.length; k++) {
+            _sampleStart('searchKeystrokeLatency');
+            searchEntry.set_text(text.substr(0, k));
+            yield Scripting.sleep(KEYSTROKE_INTERVAL);
+        }
+
+        yield Scripting.sleep(1000);
+        searchEntry.set_text('');
+        yield Scripting.waitLeisure();
+    }
+
+    Main.overview.hide();
+    yield Scripting.waitLeisure();
+
+    // Alt+Tab
+    for (let i = 0; i < ALT_TAB_WINDOWS; i++)
+        yield Scripting.createTestWindow(320, 240, false, false);
+    yield Scripting.waitTestWindows();
+    yield Scripting.sleep(1000);
+    yield Scripting.waitLeisure();
+
+    // The popup closes right away unless the modifier of the keybinding
+    // is still held down, as it is when Alt+Tab is actually pressed
+    let getPointer = global.get_pointer;
+    global.get_pointer = function() {
+        let [x, y, mods] = getPointer.call(global);
+        return [x, y, mods | Clutter.ModifierType.MOD1_MASK];
+    };
+
+    try {
+        for (let i = 0; i < ALT_TAB_REPEATS; i++) {
+            // All the test windows belong to the same application, so
+            // switching between its windows shows a thumbnail of each.
+            // The popup is painted transparent until POPUP_DELAY_TIMEOUT
+            // is over; the sample ends with the first frame after it
+            // became visible.
+            _sampleStart('altTabLatency50Windows');
+            _sampleHold();
+
+            let popup = new AltTab.AltTabPopup();
+            let opacityId = popup.actor.connect('notify::opacity', function() {
+                if (popup.actor.opacity == 255)
+                    _sampleRelease();
+            });
+
+            if (!popup.show(false, 'switch-group', Clutter.ModifierType.MOD1_MASK)) {
+                _sampleRelease();
+                popup.actor.disconnect(opacityId);
+                popup.destroy();
+                continue;
+            }
+
+            yield Scripting.sleep(AltTab.POPUP_DELAY_TIMEOUT);
+            yield Scripting.waitLeisure();
+
+            popup.actor.disconnect(opacityId);
+            popup.destroy();
+            yield Scripting.waitLeisure();
+        }
+    } finally {
+        delete global.get_pointer;
+    }
+
+    yield Scripting.destroyTestWindows();
+}
+
+let sampleMetric = null;
+let sampleStart;
+let sampleHeld = false;
+let sampleReleaseTime = 0;
+let framesMetric = null;
+let lastFrame = null;
+let haveSwapComplete = false;
+
+function _addSample(metric, value) {
+    if (METRICS[metric].value == null)
+        METRICS[metric].value = [];
+    METRICS[metric].value.push(value);
+}
+
+function scenario_sampleStart(time, metric) {
+    sampleMetric = metric;
+    sampleStart = time;
+}
+
+function scenario_sampleHold(time) {
+    sampleHeld = true;
+}
+
+function scenario_sampleRelease(time) {
+    sampleHeld = false;
+    sampleReleaseTime = time;
+}
+
+function scenario_framesStart(time, metric) {
+    framesMetric = metric;
+    lastFrame = null;
+}
+
+function scenario_framesDone(time) {
+    framesMetric = null;
+}
+
+function _frameDone(time) {
+    // A frame swapped before the release can complete after it
+    if (sampleMetric != null && !sampleHeld && time >= sampleReleaseTime) {
+        _addSample(sampleMetric, time - sampleStart);
+        sampleMetric = null;
+    }
+
+    if (framesMetric != null) {
+        if (lastFrame != null)
+            _addSample(framesMetric, time - lastFrame);
+        lastFrame = time;
+    }
+}
+
+function glx_swapComplete(time, swapTime) {
+    haveSwapComplete = true;
+
+    _frameDone(swapTime);
+}
+
+function clutter_stagePaintDone(time) {
+    // See the comment in core.js about approximating the time a frame
+    // is shown when we don't get GLXBufferSwapComplete events
+    if (!haveSwapComplete)
+        _frameDone(time);
+}
@@ -0,0 +1,177 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+const GLib = imports.gi.GLib;
+const Shell = imports.gi.Shell;
+
+const Main = imports.ui.main;
+const Scripting = imports.ui.scripting;
+
+// This performance script measures how the overview performs with many
+// windows spread over many workspaces, when the workspace thumbnails
+// are painted from snapshots and when all their windows are painted
+// live.
+
+let METRICS = {
+    overviewFpsThumbnailSnapshots:
+    { description: "Frame rate when going to the overview, 10 workspaces with 10 windows each, thumbnails painted from snapshots",
+      units: "frames / s" },
+    overviewFpsLiveThumbnails:
+    { description: "Frame rate when going to the overview, 10 workspaces with 10 windows each, thumbnails painted live",
+      units: "frames / s" },
+    overviewPaintTimeThumbnailSnapshots:
+    { description: "Time to paint a frame of the overview, 10 workspaces with 10 windows each, thumbnails painted from snapshots",
+      units: "us" },
+    overviewPaintTimeLiveThumbnails:
+    { description: "Time to paint a frame of the overview, 10 workspaces with 10 windows each, thumbnails painted live",
+      units: "us" }
+};
+
+const N_WORKSPACES = 10;
+const N_WINDOWS_PER_WORKSPACE = 10;
+const PAINT_FRAMES = 20;
+
+let SNAPSHOT_CONFIGS = [
+    { snapshotMode: true,  fpsMetric: 'overviewFpsThumbnailSnapshots', paintMetric: 'overviewPaintTimeThumbnailSnapshots' },
+    { snapshotMode: false, fpsMetric: 'overviewFpsLiveThumbnails',     paintMetric: 'overviewPaintTimeLiveThumbnails' }
+];
+
+function run() {
+    Scripting.defineScriptEvent("overviewShowStart", "Starting to show the overview");
+    Scripting.defineScriptEvent("overviewShowDone", "Overview finished showing");
+
+    let perfLog = Shell.PerfLog.get_default();
+    perfLog.define_event('thumbnails.paintTime',
+                         'Average time to paint the stage in the overview', 'x');
+
+    Main.overview.connect('shown', function() {
+                              Scripting.scriptEvent('overviewShowDone');
+                          });
+
+    yield Scripting.sleep(1000);
+
+    // New windows are placed on the active workspace; with dynamic
+    // workspaces, filling the last one adds another after it
+    for (let w = 0; w < N_WORKSPACES; w++) {
+        if (w == global.screen.n_workspaces)
+            global.screen.append_new_workspace(false, global.get_current_time());
+        global.screen.get_workspace_by_index(w).activate(global.get_current_time());
+
+        for (let k = 0; k < N_WINDOWS_PER_WORKSPACE; k++)
+            yield Scripting.createTestWindow(640, 480, false, false);
+
+        yield Scripting.waitTestWindows();
+    }
+
+    global.screen.get_workspace_by_index(0).activate(global.get_current_time());
+    yield Scripting.sleep(1000);
+    yield Scripting.waitLeisure();
+
+    let thumbnailsBox = Main.overview._viewSelector._workspacesDisplay._thumbnailsBox;
+
+    for (let i = 0; i < 2 * SNAPSHOT_CONFIGS.length; i++) {
+        // As in the core script, we go to the overview twice for each
+        // configuration and only measure the second time
+        let config = SNAPSHOT_CONFIGS[Math.floor(i / 2)];
+        thumbnailsBox.snapshotMode = config.snapshotMode;
+
+        Scripting.scriptEvent('overviewShowStart');
+        Main.overview.show();
+        yield Scripting.waitLeisure();
+
+        if ((i % 2) == 1) {
+            let paintStart;
+            let paintTime = 0;
+            let frames = 0;
+            let paintId = global.stage.connect('paint', function() {
+                paintStart = GLib.get_monotonic_time();
+            });
+            let paintDoneId = global.stage.connect_after('paint', function() {
+                paintTime += GLib.get_monotonic_time() - paintStart;
+                frames++;
+            });
+            for (let k = 0; k < PAINT_FRAMES; k++) {
+                global.stage.queue_redraw();
+                yield Scripting.waitLeisure();
+            }
+            global.stage.disconnect(paintId);
+            global.stage.disconnect(paintDoneId);
+
+            perfLog.event_x('thumbnails.paintTime', Math.round(paintTime / Math.max(frames, 1)));
+        }
+
+        Main.overview.hide();
+        yield Scripting.waitLeisure();
+    }
+
+    thumbnailsBox.snapshotMode = true;
+
+    yield Scripting.destroyTestWindows();
+}
+
+let showingOverview = false;
+let finishedShowingOverview = false;
+let overviewShowStart;
+let overviewFrames;
+let overviewLatency;
+let overviewShowCount = 0;
+let paintTimeCount = 0;
+let haveSwapComplete = false;
+
+function script_overviewShowStart(time) {
+    showingOverview = true;
+    finishedShowingOverview = false;
+    overviewShowStart = time;
+    overviewFrames = 0;
+}
+
+function script_overviewShowDone(time) {
+    // Wait for one more frame to paint before we count ourselves as done
+    finishedShowingOverview = true;
+}
+
+function thumbnails_paintTime(time, paintTime) {
+    let config = SNAPSHOT_CONFIGS[paintTimeCount];
+    METRICS[config.paintMetric].value = paintTime;
+    paintTimeCount++;
+}
+
+function _frameDone(time) {
+    if (showingOverview) {
+        if (overviewFrames == 0)
+            overviewLatency = time - overviewShowStart;
+
+        overviewFrames++;
+    }
+
+    if (finishedShowingOverview) {
+        showingOverview = false;
+        finishedShowingOverview = false;
+        overviewShowCount++;
+
+        let dt = (time - (overviewShowStart + overviewLatency)) / 1000000;
+
+        // If we see a start frame and an end frame, that would
+        // be 1 frame for a FPS computation, hence the '- 1'
+        let fps = (overviewFrames - 1) / dt;
+
+        // overviewShowCount is 1,2,3...; we use the second show of
+        // each configuration
+        if (overviewShowCount % 2 == 0) {
+            let config = SNAPSHOT_CONFIGS[(overviewShowCount / 2) - 1];
+            METRICS[config.fpsMetric].value = fps;
+        }
+    }
+}
+
+function glx_swapComplete(time, swapTime) {
+    haveSwapComplete = true;
+
+    _frameDone(swapTime);
+}
+
+function clutter_stagePaintDone(time) {
+    // See the comment in core.js about approximating the time a frame
+    // is shown when we don't get GLXBufferSwapComplete events
+    if (!haveSwapComplete)
+        _frameDone(time);
+}
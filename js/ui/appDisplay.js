@@ -32,21 +32,23 @@ const AlphabeticalView = new Lang.Class({
     Name: 'AlphabeticalView',
 
     _init: function() {
-        this._grid = new IconGrid.IconGrid({ xAlign: St.Align.START });
         this._appSystem = Shell.AppSystem.get_default();
 
-        this._pendingAppLaterId = 0;
-        this._appIcons = {}; // desktop file id
+        this._appIds = {}; // desktop file id
         this._allApps = [];
+        this._visibleApps = [];
 
-        let box = new St.BoxLayout({ vertical: true });
-        box.add(this._grid.actor, { y_align: St.Align.START, expand: true });
+        // Only the icons in view are created, and reused as we scroll
+        this._grid = new St.GridView({ style_class: 'icon-grid' });
+        this._grid.connect('style-changed', Lang.bind(this, this._onStyleChanged));
+        this._grid.connect('create-item', Lang.bind(this, this._createItem));
+        this._grid.connect('bind-item', Lang.bind(this, this._bindItem));
 
         this.actor = new St.ScrollView({ x_fill: true,
                                          y_fill: false,
                                          y_align: St.Align.START,
                                          style_class: 'vfade' });
-        this.actor.add_actor(box);
+        this.actor.add_actor(this._grid);
         this.actor.set_policy(Gtk.PolicyType.NEVER, Gtk.PolicyType.AUTOMATIC);
         this.actor.connect('notify::mapped', Lang.bind(this,
             function() {
@@ -62,28 +64,56 @@ const AlphabeticalView = new Lang.Class({
             }));
     },
 
+    _onStyleChanged: function() {
+        let themeNode = this._grid.get_theme_node();
+        let hItemSize = themeNode.get_length('-shell-grid-horizontal-item-size') || IconGrid.ICON_SIZE;
+        let vItemSize = themeNode.get_length('-shell-grid-vertical-item-size') || IconGrid.ICON_SIZE;
+        this._grid.set_item_size(hItemSize, vItemSize);
+    },
+
+    _createItem: function(grid) {
+        let item = new St.Bin({ x_fill: true,
+                                y_fill: true });
+        item._appIcon = null;
+        return item;
+    },
+
+    _bindItem: function(grid, item, index) {
+        let app = this._visibleApps[index];
+        item._index = index;
+
+        if (item._appIcon) {
+            item._appIcon.setApp(app);
+            return;
+        }
+
+        item._appIcon = new AppWellIcon(app);
+        item._appIcon.actor.connect('key-focus-in', Lang.bind(this,
+            function() {
+                this._ensureIconVisible(item);
+            }));
+        item.set_child(item._appIcon.actor);
+    },
+
     removeAll: function() {
-        this._grid.removeAll();
-        this._appIcons = {};
+        this._appIds = {};
         this._allApps = [];
+        this._setVisibleApps([]);
     },
 
     addApp: function(app) {
         var id = app.get_id();
-        if (this._appIcons[id] !== undefined)
+        if (this._appIds[id] !== undefined)
             return;
 
-        let appIcon = new AppWellIcon(app);
-        let pos = Util.insertSorted(this._allApps, app, function(a, b) {
+        Util.insertSorted(this._allApps, app, function(a, b) {
             return a.compare_by_name(b);
         });
-        this._grid.addItem(appIcon.actor, pos);
-        appIcon.actor.connect('key-focus-in', Lang.bind(this, this._ensureIconVisible));
 
-        this._appIcons[id] = appIcon;
+        this._appIds[id] = true;
     },
 
-    _ensureIconVisible: function(icon) {
+    _ensureIconVisible: function(item) {
         let adjustment = this.actor.vscroll.adjustment;
         let [value, lower, upper, stepIncrement, pageIncrement, pageSize] = adjustment.get_values();
 
@@ -92,9 +122,9 @@ const AlphabeticalView = new Lang.Class({
         if (vfade)
             offset = vfade.fade_offset;
 
-        // If this gets called as part of a right-click, the actor
-        // will be needs_allocation, and so "icon.y" would return 0
-        let box = icon.get_allocation_box();
+        // An item the grid just bound for keyboard navigation isn't
+        // allocated yet, so use the cell it is going to be placed in
+        let box = this._grid.get_cell_box(item._index);
 
         if (box.y1 < value + offset)
             value = Math.max(0, box.y1 - offset);
@@ -109,24 +139,24 @@ const AlphabeticalView = new Lang.Class({
                            transition: 'easeOutQuad' });
     },
 
+    _setVisibleApps: function(apps) {
+        this._visibleApps = apps;
+        this._grid.n_items = apps.length;
+        this._grid.items_changed();
+    },
+
     setVisibleApps: function(apps) {
         if (apps == null) { // null implies "all"
-            for (var id in this._appIcons) {
-                var icon = this._appIcons[id];
-                icon.actor.visible = true;
-            }
+            this._setVisibleApps(this._allApps);
         } else {
-            // Set everything to not-visible, then set to visible what we should see
-            for (var id in this._appIcons) {
-                var icon = this._appIcons[id];
-                icon.actor.visible = false;
-            }
-            for (var i = 0; i < apps.length; i++) {
-                var app = apps[i];
-                var id = app.get_id();
-                var icon = this._appIcons[id];
-                icon.actor.visible = true;
-            }
+            // Keep the alphabetical order of the whole grid
+            let ids = {};
+            for (let i = 0; i < apps.length; i++)
+                ids[apps[i].get_id()] = true;
+
+            this._setVisibleApps(this._allApps.filter(function(app) {
+                return ids[app.get_id()];
+            }));
         }
     }
 });
@@ -250,6 +280,9 @@ const ViewByCategories = new Lang.Class({
         this._view.removeAll();
         this._categories = [];
         this._categoryBox.destroy_all_children();
+
+        // Make sure the new apps get shown by the next _selectCategory()
+        this._currentCategory = -2;
     },
 
     refresh: function() {
@@ -432,6 +465,15 @@ const AppIcon = new Lang.Class({
         this.parent(label, params);
     },
 
+    setApp: function(app) {
+        this.app = app;
+
+        if (this.label)
+            this.label.text = app.get_name();
+        if (this.icon)
+            this._createIconTexture(this.iconSize);
+    },
+
     createIcon: function(iconSize) {
         return this.app.create_icon_texture(iconSize);
     }
@@ -495,6 +537,27 @@ const AppWellIcon = new Lang.Class({
         this._removeMenuTimeout();
     },
 
+    // Used when the icon is recycled to show another application
+    setApp: function(app) {
+        if (app == this.app)
+            return;
+
+        this._removeMenuTimeout();
+        if (this._menu)
+            this._menu.close();
+
+        if (this._stateChangedId > 0)
+            this.app.disconnect(this._stateChangedId);
+
+        this.app = app;
+        this.icon.setApp(app);
+
+        this._stateChangedId = this.app.connect('notify::state',
+                                                Lang.bind(this,
+                                                          this._onStateChanged));
+        this._onStateChanged();
+    },
+
     _removeMenuTimeout: function() {
         if (this._menuTimeoutId > 0) {
             Mainloop.source_remove(this._menuTimeoutId);
@@ -353,8 +353,9 @@ const _Draggable = new Lang.Class({
             this._dragActor.set_position(stageX + this._dragOffsetX,
                                          stageY + this._dragOffsetY);
 
-            let target = this._dragActor.get_stage().get_actor_at_pos(Clutter.PickMode.ALL,
-                                                                      stageX, stageY);
+            let target = Shell.util_get_actor_at_pos(this._dragActor.get_stage(),
+                                                     Clutter.PickMode.ALL,
+                                                     stageX, stageY);
 
             // We call observers only once per motion with the innermost
             // target actor. If necessary, the observer can walk the
@@ -708,15 +708,17 @@ const Chrome = new Lang.Class({
 
         this._trackedActors = [];
 
+        // The input region and struts are computed in C, which skips
+        // the X and mutter calls when nothing changed.
+        this._regions = new Shell.ChromeRegions(Main.uiGroup);
+        this._regions.connect('changed',
+                              Lang.bind(this, this._queueUpdateRegions));
+
         this._layoutManager.connect('monitors-changed',
                                     Lang.bind(this, this._relayout));
         global.screen.connect('restacked',
                               Lang.bind(this, this._windowsRestacked));
 
-        // Need to update struts on new workspaces when they are added
-        global.screen.connect('notify::n-workspaces',
-                              Lang.bind(this, this._queueUpdateRegions));
-
         this._relayout();
     },
 
@@ -779,17 +781,15 @@ const Chrome = new Lang.Class({
         let actorData = Params.parse(params, defaultParams);
         actorData.actor = actor;
         actorData.isToplevel = actor.get_parent() == Main.uiGroup;
-        actorData.visibleId = actor.connect('notify::visible',
-                                            Lang.bind(this, this._queueUpdateRegions));
-        actorData.allocationId = actor.connect('notify::allocation',
-                                               Lang.bind(this, this._queueUpdateRegions));
         actorData.parentSetId = actor.connect('parent-set',
                                               Lang.bind(this, this._actorReparented));
         // Note that destroying actor will unset its parent, so we don't
         // need to connect to 'destroy' too.
 
         this._trackedActors.push(actorData);
-        this._queueUpdateRegions();
+        this._regions.track_actor(actor,
+                                  actorData.affectsInputRegion,
+                                  actorData.affectsStruts);
     },
 
     _untrackActor: function(actor) {
@@ -800,11 +800,9 @@ const Chrome = new Lang.Class({
         let actorData = this._trackedActors[i];
 
         this._trackedActors.splice(i, 1);
-        actor.disconnect(actorData.visibleId);
-        actor.disconnect(actorData.allocationId);
         actor.disconnect(actorData.parentSetId);
 
-        this._queueUpdateRegions();
+        this._regions.untrack_actor(actor);
     },
 
     _actorReparented: function(actor, oldParent) {
@@ -1016,113 +1014,12 @@ const Chrome = new Lang.Class({
     },
 
     updateRegions: function() {
-        let rects = [], struts = [], i;
-
         if (this._updateRegionIdle) {
             Mainloop.source_remove(this._updateRegionIdle);
             delete this._updateRegionIdle;
         }
 
-        for (i = 0; i < this._trackedActors.length; i++) {
-            let actorData = this._trackedActors[i];
-            if (!actorData.affectsInputRegion && !actorData.affectsStruts)
-                continue;
-
-            let [x, y] = actorData.actor.get_transformed_position();
-            let [w, h] = actorData.actor.get_transformed_size();
-            x = Math.round(x);
-            y = Math.round(y);
-            w = Math.round(w);
-            h = Math.round(h);
-            let rect = new Meta.Rectangle({ x: x, y: y, width: w, height: h});
-
-            if (actorData.affectsInputRegion &&
-                actorData.actor.get_paint_visibility() &&
-                !Main.uiGroup.get_skip_paint(actorData.actor))
-                rects.push(rect);
-
-            if (!actorData.affectsStruts)
-                continue;
-
-            // Limit struts to the size of the screen
-            let x1 = Math.max(x, 0);
-            let x2 = Math.min(x + w, global.screen_width);
-            let y1 = Math.max(y, 0);
-            let y2 = Math.min(y + h, global.screen_height);
-
-            // NetWM struts are not really powerful enought to handle
-            // a multi-monitor scenario, they only describe what happens
-            // around the outer sides of the full display region. However
-            // it can describe a partial region along each side, so
-            // we can support having the struts only affect the
-            // primary monitor. This should be enough as we only have
-            // chrome affecting the struts on the primary monitor so
-            // far.
-            //
-            // Metacity wants to know what side of the screen the
-            // strut is considered to be attached to. If the actor is
-            // only touching one edge, or is touching the entire
-            // border of the primary monitor, then it's obvious which
-            // side to call it. If it's in a corner, we pick a side
-            // arbitrarily. If it doesn't touch any edges, or it spans
-            // the width/height across the middle of the screen, then
-            // we don't create a strut for it at all.
-            let side;
-            let primary = this._primaryMonitor;
-            if (x1 <= primary.x && x2 >= primary.x + primary.width) {
-                if (y1 <= primary.y)
-                    side = Meta.Side.TOP;
-                else if (y2 >= primary.y + primary.height)
-                    side = Meta.Side.BOTTOM;
-                else
-                    continue;
-            } else if (y1 <= primary.y && y2 >= primary.y + primary.height) {
-                if (x1 <= 0)
-                    side = Meta.Side.LEFT;
-                else if (x2 >= global.screen_width)
-                    side = Meta.Side.RIGHT;
-                else
-                    continue;
-            } else if (x1 <= 0)
-                side = Meta.Side.LEFT;
-            else if (y1 <= 0)
-                side = Meta.Side.TOP;
-            else if (x2 >= global.screen_width)
-                side = Meta.Side.RIGHT;
-            else if (y2 >= global.screen_height)
-                side = Meta.Side.BOTTOM;
-            else
-                continue;
-
-            // Ensure that the strut rects goes all the way to the screen edge,
-            // as this really what mutter expects.
-            switch (side) {
-            case Meta.Side.TOP:
-                y1 = 0;
-                break;
-            case Meta.Side.BOTTOM:
-                y2 = global.screen_height;
-                break;
-            case Meta.Side.LEFT:
-                x1 = 0;
-                break;
-            case Meta.Side.RIGHT:
-                x2 = global.screen_width;
-                break;
-            }
-
-            let strutRect = new Meta.Rectangle({ x: x1, y: y1, width: x2 - x1, height: y2 - y1});
-            let strut = new Meta.Strut({ rect: strutRect, side: side });
-            struts.push(strut);
-        }
-
-        global.set_stage_input_region(rects);
-
-        let screen = global.screen;
-        for (let w = 0; w < screen.n_workspaces; w++) {
-            let workspace = screen.get_workspace_by_index(w);
-            workspace.set_builtin_struts(struts);
-        }
+        this._regions.update();
 
         return false;
     }
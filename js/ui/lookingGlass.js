@@ -48,6 +48,9 @@ const AUTO_COMPLETE_DOUBLE_TAB_DELAY = 500;
 const AUTO_COMPLETE_SHOW_COMPLETION_ANIMATION_DURATION = 0.2;
 const AUTO_COMPLETE_GLOBAL_KEYWORDS = _getAutoCompleteGlobalKeywords();
 
+// Number of widget types with the most instances shown in the Memory tab
+const MEMORY_TOP_TYPES = 10;
+
 function _getAutoCompleteGlobalKeywords() {
     const keywords = ['true', 'false', 'null', 'new'];
     // Don't add the private properties of window (i.e., ones starting with '_')
@@ -658,6 +661,12 @@ const Memory = new Lang.Class({
         this._last_gc_seconds_ago = new St.Label();
         this.actor.add(this._last_gc_seconds_ago);
 
+        this._texture_bytes = new St.Label();
+        this.actor.add(this._texture_bytes);
+
+        this._instances = new St.Label();
+        this.actor.add(this._instances);
+
         this._gcbutton = new St.Button({ label: 'Full GC',
                                          style_class: 'lg-obj-inspector-button' });
         this._gcbutton.connect('clicked', Lang.bind(this, function () { System.gc(); this._renderText(); }));
@@ -678,6 +687,15 @@ const Memory = new Lang.Class({
         this._gjs_function.text = 'gjs_function: ' + memInfo.gjs_function;
         this._gjs_closure.text = 'gjs_closure: ' + memInfo.gjs_closure;
         this._last_gc_seconds_ago.text = 'last_gc_seconds_ago: ' + memInfo.last_gc_seconds_ago;
+        this._texture_bytes.text = 'texture_bytes: ' + memInfo.texture_bytes;
+
+        let types = St.statistics_get_instance_types().map(function(type) {
+            return [type, St.statistics_get_instance_count(type)];
+        });
+        types.sort(function(a, b) { return b[1] - a[1]; });
+        this._instances.text = 'widgets:\n' + types.slice(0, MEMORY_TOP_TYPES).map(function(t) {
+            return '  ' + t[0] + ': ' + t[1];
+        }).join('\n');
     }
 });
 
@@ -209,6 +209,10 @@ function start() {
 
     _nWorkspacesChanged();
 
+    // Once startup is over and nothing else is going on, get the
+    // overview ready so showing it the first time isn't slower
+    global.run_at_leisure(Lang.bind(overview, overview.prewarm));
+
     ExtensionDownloader.init();
     ExtensionSystem.init();
 }
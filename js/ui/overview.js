@@ -28,6 +28,16 @@ const DASH_MAX_WIDTH = 96;
 
 const DND_WINDOW_SWITCH_TIMEOUT = 1250;
 
+// How much more malloc'ed memory we accept to use for keeping the
+// overview prewarmed; if prewarming takes more, it's discarded again
+const PREWARM_MEMORY_BUDGET = 8 * 1024 * 1024;
+
+// While the overview is kept prewarmed, how often we check whether
+// the system is short of memory, and below which fraction of the total
+// memory available we discard the prewarm
+const PREWARM_MEMORY_CHECK_INTERVAL = 60; // seconds
+const PREWARM_LOW_MEMORY_FRACTION = 0.05;
+
 const GLSL_DIM_EFFECT_DECLARATIONS = '';
 const GLSL_DIM_EFFECT_CODE = '\
    vec2 dist = cogl_tex_coord_in[0].xy - vec2(0.5, 0.5); \
@@ -46,6 +56,44 @@ const GLSL_DIM_EFFECT_CODE = '\
    cogl_color_out.xyz = cogl_color_out.xyz * (1.0 - a); \
    cogl_color_out.a = 1.0;';
 
+const PrewarmState = {
+    NONE: 0,
+    PREWARMING: 1,
+    PREWARMED: 2,
+    DISCARDED: 3
+};
+
+// Returns the fraction of the system's memory that is available for
+// new allocations without swapping, from /proc/meminfo, or 1 if that
+// can't be told
+function _getAvailableMemoryFraction() {
+    let contents;
+    try {
+        contents = Shell.get_file_contents_utf8_sync('/proc/meminfo');
+    } catch (e) {
+        return 1;
+    }
+
+    let info = {};
+    contents.split('\n').forEach(function(line) {
+        let match = /^(\w+):\s+(\d+)/.exec(line);
+        if (match)
+            info[match[1]] = parseInt(match[2]);
+    });
+
+    if (!info.MemTotal)
+        return 1;
+
+    // Older kernels don't estimate MemAvailable
+    let available;
+    if ('MemAvailable' in info)
+        available = info.MemAvailable;
+    else
+        available = (info.MemFree || 0) + (info.Cached || 0);
+
+    return available / info.MemTotal;
+}
+
 const SwipeScrollDirection = {
     NONE: 0,
     HORIZONTAL: 1,
@@ -176,6 +224,9 @@ const Overview = new Lang.Class({
         this._modal = false;            // have a modal grab
         this.animationInProgress = false;
         this._hideInProgress = false;
+        this._prewarmState = PrewarmState.NONE;
+        this._prewarmClone = null;
+        this._prewarmCheckId = 0;
 
         // During transitions, we raise this to the top to avoid having the overview
         // area be reactive; it causes too many issues such as double clicks on
@@ -582,6 +633,85 @@ const Overview = new Lang.Class({
         this.emit('window-drag-end');
     },
 
+    // prewarm:
+    //
+    // Paints the hidden overview once, underneath the windows where it
+    // can't be seen, so that showing it the first time doesn't have to
+    // resolve styles, load icons and render backgrounds and shadows.
+    // Meant to be called when the shell is otherwise idle.
+    prewarm: function() {
+        if (this.isDummy)
+            return;
+        if (this._prewarmState != PrewarmState.NONE || this.visible)
+            return;
+
+        let usedBefore = global.get_memory_info().glibc_uordblks;
+
+        this._prewarmState = PrewarmState.PREWARMING;
+        this._prewarmClone = new Clutter.Clone({ source: this._group,
+                                                 x: this._group.x,
+                                                 y: this._group.y });
+        global.stage.insert_child_below(this._prewarmClone, Main.uiGroup);
+
+        let paintId = global.stage.connect_after('paint', Lang.bind(this, function() {
+            global.stage.disconnect(paintId);
+
+            // We can't remove actors from within a paint
+            Mainloop.idle_add(Lang.bind(this, function() {
+                this._prewarmClone.destroy();
+                this._prewarmClone = null;
+                this._prewarmState = PrewarmState.PREWARMED;
+
+                let used = global.get_memory_info().glibc_uordblks - usedBefore;
+                if (used > PREWARM_MEMORY_BUDGET)
+                    this.discardPrewarm();
+                else
+                    this._prewarmCheckId = Mainloop.timeout_add_seconds(PREWARM_MEMORY_CHECK_INTERVAL,
+                                                                        Lang.bind(this, this._checkPrewarmMemory));
+                return false;
+            }));
+        }));
+    },
+
+    _checkPrewarmMemory: function() {
+        if (_getAvailableMemoryFraction() >= PREWARM_LOW_MEMORY_FRACTION)
+            return true;
+
+        this._prewarmCheckId = 0;
+        this.discardPrewarm();
+        return false;
+    },
+
+    // discardPrewarm:
+    //
+    // Frees what prewarm() kept around for painting the overview,
+    // for when memory is short; this is done automatically when the
+    // system runs low on available memory. The overview isn't
+    // prewarmed again.
+    discardPrewarm: function() {
+        if (this._prewarmState != PrewarmState.PREWARMED)
+            return;
+
+        if (this._prewarmCheckId) {
+            Mainloop.source_remove(this._prewarmCheckId);
+            this._prewarmCheckId = 0;
+        }
+
+        this._prewarmState = PrewarmState.DISCARDED;
+        if (this.visible)
+            return;
+
+        let discard = function(actor) {
+            if (actor instanceof St.Widget) {
+                let node = actor.peek_theme_node();
+                if (node)
+                    node.discard_paint_state();
+            }
+            actor.get_children().forEach(discard);
+        };
+        discard(this._group);
+    },
+
     // show:
     //
     // Animates the overview visible and grabs mouse and keyboard input
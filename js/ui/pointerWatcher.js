@@ -9,8 +9,10 @@ const Shell = imports.gi.Shell;
 const IDLE_TIME = 1000;
 
 // This file implements a reasonably efficient system for tracking the position
-// of the mouse pointer. We simply query the pointer from the X server in a loop,
-// but we turn off the polling when the user is idle.
+// of the mouse pointer. Where the X server supports it, ShellGlobal reports
+// pointer motion to us at most once per frame and nothing happens while the
+// pointer is still. Otherwise, we simply query the pointer from the X server
+// in a loop, but we turn off the polling when the user is idle.
 
 let _pointerWatcher = null;
 function getPointerWatcher() {
@@ -48,12 +50,14 @@ const PointerWatcher = new Lang.Class({
         this._watches = [];
         this.pointerX = null;
         this.pointerY = null;
+
+        global.connect('pointer-moved', Lang.bind(this, this._onPointerMoved));
     },
 
     // addWatch:
-    // @interval: hint as to the time resolution needed. When the user is
-    //   not idle, the position of the pointer will be queried at least
-    //   once every this many milliseconds.
+    // @interval: hint as to the time resolution needed. When the pointer
+    //   position has to be polled and the user is not idle, it will be
+    //   queried at least once every this many milliseconds.
     // @callback: function to call when the pointer position changes - takes
     //   two arguments, X and Y.
     //
@@ -96,6 +100,9 @@ const PointerWatcher = new Lang.Class({
             this._timeoutId = 0;
         }
 
+        if (global.set_pointer_tracking(this._watches.length > 0))
+            return;
+
         if (this._idle || this._watches.length == 0)
             return;
 
@@ -112,8 +119,16 @@ const PointerWatcher = new Lang.Class({
         return true;
     },
 
+    _onPointerMoved: function(shellGlobal, x, y) {
+        this._setPointer(x, y);
+    },
+
     _updatePointer: function() {
         let [x, y, mods] = global.get_pointer();
+        this._setPointer(x, y);
+    },
+
+    _setPointer: function(x, y) {
         if (this.pointerX == x && this.pointerY == y)
             return;
 
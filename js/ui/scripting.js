@@ -76,6 +76,15 @@ const PerfHelperIface = <interface name="org.gnome.Shell.PerfHelper">
     <arg type="b" direction="in" />
     <arg type="b" direction="in" />
 </method>
+<method name="CreateAnimatedWindow">
+    <arg type="i" direction="in" />
+    <arg type="i" direction="in" />
+    <arg type="b" direction="in" />
+    <arg type="b" direction="in" />
+</method>
+<method name="CreateTrayIcons">
+    <arg type="i" direction="in" />
+</method>
 <method name="WaitWindows" />
 <method name="DestroyWindows" />
 </interface>;
@@ -121,11 +130,59 @@ function createTestWindow(width, height, alpha, maximized) {
     };
 }
 
+/**
+ * createAnimatedTestWindow:
+ * @width: width of window, in pixels
+ * @height: height of window, in pixels
+ * @alpha: whether the window should be alpha transparent
+ * @maximized: whether the window should be created maximized
+ *
+ * Like createTestWindow(), but the window redraws its content every
+ * frame, the way a window playing a video would.
+ */
+function createAnimatedTestWindow(width, height, alpha, maximized) {
+    let cb;
+    let perfHelper = _getPerfHelper();
+
+    perfHelper.CreateAnimatedWindowRemote(width, height, alpha, maximized,
+                                          function(result, excp) {
+                                              if (cb)
+                                                  cb();
+                                          });
+
+    return function(callback) {
+        cb = callback;
+    };
+}
+
+/**
+ * createTestTrayIcons:
+ * @count: number of icons to create
+ *
+ * Creates @count legacy tray icons using gnome-shell-perf-helper.
+ * To wait until they have been embedded, use waitTestWindows().
+ */
+function createTestTrayIcons(count) {
+    let cb;
+    let perfHelper = _getPerfHelper();
+
+    perfHelper.CreateTrayIconsRemote(count,
+                                     function(result, excp) {
+                                         if (cb)
+                                             cb();
+                                     });
+
+    return function(callback) {
+        cb = callback;
+    };
+}
+
 /**
  * waitTestWindows:
  *
  * Used within an automation script to pause until all windows previously
- * created with createTestWindow have been mapped and exposed.
+ * created with createTestWindow have been mapped and exposed, and all
+ * tray icons created with createTestTrayIcons() have been embedded.
  */
 function waitTestWindows() {
     let cb;
@@ -144,7 +201,8 @@ function waitTestWindows() {
 /**
  * destroyTestWindows:
  *
- * Destroys all windows previously created with createTestWindow().
+ * Destroys all windows previously created with createTestWindow(),
+ * and all tray icons created with createTestTrayIcons().
  * While this function can be used with yield in an automation
  * script to pause until the D-Bus call to the helper process returns,
  * this doesn't guarantee that Mutter has actually finished the destroy
@@ -341,7 +399,8 @@ function _collect(scriptModule, outputFile) {
  *   unit values are recognized: s, ms, us, B, KiB, MiB. Other
  *   values can appear but are uninterpreted. Examples 's',
  *   '/ s', 'frames', 'frames / s', 'MiB / s / frame'
- *  value: computed value of the metric
+ *  value: computed value of the metric, or an array of samples;
+ *   gnome-shell-perf-tool reports percentiles for those
  *
  * The resulting metrics will be written to @outputFile as JSON, or,
  * if @outputFile is not provided, logged.
@@ -2,6 +2,7 @@
 
 const Clutter = imports.gi.Clutter;
 const GLib = imports.gi.GLib;
+const GObject = imports.gi.GObject;
 const Lang = imports.lang;
 const Mainloop = imports.mainloop;
 const Shell = imports.gi.Shell;
@@ -32,6 +33,14 @@ const Tweener = imports.tweener.tweener;
 // tween completes and then another is added before returning to the
 // main loop, the complete callback will not be called (until the new
 // tween finishes).
+//
+// Tweens that only animate numeric GObject properties of the target,
+// with a named transition, are run by Shell.TweenEngine, which updates
+// all of them in C each frame and only calls back into JS when a tween
+// starts or completes. Everything else (JS properties, special
+// properties, onUpdate or onOverwrite callbacks, transition functions)
+// goes through imports.tweener.tweener. Adding a tween in either one
+// overwrites tweens of the same properties in the other.
 
 
 // ActionScript Tweener methods that imports.tweener.tweener doesn't
@@ -44,6 +53,21 @@ const Tweener = imports.tweener.tweener;
 // calls any of these is almost certainly wrong anyway, because they
 // affect the entire application.)
 
+// Tweening parameters that Shell.TweenEngine supports. Any other
+// parameter that isn't a number means the tween needs Tweener.
+const ENGINE_PARAMETERS = {
+    time: true,
+    delay: true,
+    transition: true,
+    rounded: true,
+    onStart: true,
+    onStartScope: true,
+    onStartParams: true,
+    onComplete: true,
+    onCompleteScope: true,
+    onCompleteParams: true
+};
+
 // Called from Main.start
 function init() {
     Tweener.setFrameTicker(new ClutterFrameTicker());
@@ -57,9 +81,56 @@ function addCaller(target, tweeningParameters) {
 
 function addTween(target, tweeningParameters) {
     _wrapTweening(target, tweeningParameters);
+
+    if (_addEngineTween(target, tweeningParameters))
+        return;
+
+    if (target instanceof GObject.Object)
+        Shell.TweenEngine.get_default().remove_tweens(target, _getTweenedProperties(tweeningParameters));
     Tweener.addTween(target, tweeningParameters);
 }
 
+function _getTweenedProperties(params) {
+    let properties = [];
+    for (let name in params) {
+        if (!(name in ENGINE_PARAMETERS))
+            properties.push(name);
+    }
+    return properties;
+}
+
+// Returns false if the tween can't be run by Shell.TweenEngine
+function _addEngineTween(target, params) {
+    if (!(target instanceof GObject.Object))
+        return false;
+    if (params.transition && typeof params.transition != 'string')
+        return false;
+
+    let properties = _getTweenedProperties(params);
+    let values = [];
+    for (let i = 0; i < properties.length; i++) {
+        let value = params[properties[i]];
+        if (typeof value != 'number')
+            return false;
+        values.push(value);
+    }
+    if (properties.length == 0)
+        return false;
+
+    let id = Shell.TweenEngine.get_default().add_tween(target, properties, values,
+                                                       params.time || 0,
+                                                       params.delay || 0,
+                                                       params.transition || null,
+                                                       !!params.rounded,
+                                                       params.onStart,
+                                                       params.onComplete);
+    if (id == 0)
+        return false;
+
+    Tweener.removeTweens.apply(null, [target].concat(properties));
+    return true;
+}
+
 function _wrapTweening(target, tweeningParameters) {
     let state = _getTweenState(target);
 
@@ -116,6 +187,8 @@ function _addHandler(target, params, name, handler) {
 function _actorDestroyed(target) {
     _resetTweenState(target);
     Tweener.removeTweens(target);
+    if (target instanceof GObject.Object)
+        Shell.TweenEngine.get_default().remove_tweens(target, []);
 }
 
 function _tweenStarted(target) {
@@ -147,19 +220,37 @@ function _idleCompleted(target) {
 }
 
 function getTweenCount(scope) {
-    return Tweener.getTweenCount(scope);
+    let count = Tweener.getTweenCount(scope);
+    if (scope instanceof GObject.Object)
+        count += Shell.TweenEngine.get_default().get_tween_count(scope);
+    return count;
 }
 
 // imports.tweener.tweener doesn't provide this method (which exists
 // in the ActionScript version) but it's easy to implement.
 function isTweening(scope) {
-    return Tweener.getTweenCount(scope) != 0;
+    return getTweenCount(scope) != 0;
+}
+
+// Calls @method of Shell.TweenEngine with the scope and property
+// names passed to one of the functions below
+function _applyToEngine(method, args) {
+    let scope = args[0];
+    if (!(scope instanceof GObject.Object))
+        return false;
+
+    let engine = Shell.TweenEngine.get_default();
+    return engine[method](scope, Array.prototype.slice.call(args, 1));
 }
 
 function removeTweens(scope) {
-    if (Tweener.removeTweens.apply(null, arguments)) {
+    let removed = Tweener.removeTweens.apply(null, arguments);
+    if (_applyToEngine('remove_tweens', arguments))
+        removed = true;
+
+    if (removed) {
         // If we just removed the last active tween, clean up
-        if (Tweener.getTweenCount(scope) == 0)
+        if (getTweenCount(scope) == 0)
             _tweenCompleted(scope);
         return true;
     } else
@@ -167,11 +258,13 @@ function removeTweens(scope) {
 }
 
 function pauseTweens() {
-    return Tweener.pauseTweens.apply(null, arguments);
+    let paused = Tweener.pauseTweens.apply(null, arguments);
+    return _applyToEngine('pause_tweens', arguments) || paused;
 }
 
 function resumeTweens() {
-    return Tweener.resumeTweens.apply(null, arguments);
+    let resumed = Tweener.resumeTweens.apply(null, arguments);
+    return _applyToEngine('resume_tweens', arguments) || resumed;
 }
 
 
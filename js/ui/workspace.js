@@ -21,26 +21,25 @@ const FOCUS_ANIMATION_TIME = 0.15;
 
 const WINDOW_DND_SIZE = 256;
 
-const SCROLL_SCALE_AMOUNT = 100 / 5;
+// Windows in the overview are shown from a downscaled copy at most this
+// large; zooming a window past it is slightly blurry.
+const WINDOW_THUMBNAIL_SIZE = 1024;
 
-const WINDOW_CLONE_MAXIMUM_SCALE = 0.7;
+const SCROLL_SCALE_AMOUNT = 100 / 5;
 
 const LIGHTBOX_FADE_TIME = 0.1;
 const CLOSE_BUTTON_FADE_TIME = 0.1;
 
 const DRAGGING_WINDOW_OPACITY = 100;
 
+// Priority for building the window clones of workspaces other than the
+// active one with Shell.WorkScheduler; they aren't visible until the
+// user switches workspace, so they come after the thumbnails
+const WORKSPACE_BUILD_PRIORITY = 2;
+
 const BUTTON_LAYOUT_SCHEMA = 'org.gnome.shell.overrides';
 const BUTTON_LAYOUT_KEY = 'button-layout';
 
-// When calculating a layout, we calculate the scale of windows and the percent
-// of the available area the new layout uses. If the values for the new layout,
-// when weighted with the values as below, are worse than the previous layout's,
-// we stop looking for a new layout and use the previous layout.
-// Otherwise, we keep looking for a new layout.
-const LAYOUT_SCALE_WEIGHT = 1;
-const LAYOUT_SPACE_WEIGHT = 0.1;
-
 function _interpolate(start, end, step) {
     return start + (end - start) * step;
 }
@@ -95,9 +94,9 @@ const WindowClone = new Lang.Class({
         this._workspace = workspace;
 
         let [borderX, borderY] = this._getInvisibleBorderPadding();
-        this._windowClone = new Clutter.Clone({ source: realWindow.get_texture(),
-                                                x: -borderX,
-                                                y: -borderY });
+        let thumbnailer = Shell.WindowThumbnailer.get_default();
+        this._windowClone = thumbnailer.get_thumbnail(realWindow, WINDOW_THUMBNAIL_SIZE);
+        this._windowClone.set_position(-borderX, -borderY);
         // We expect this.actor to be used for all interaction rather than
         // this._windowClone; as the former is reactive and the latter
         // is not, this just works for most cases. However, for DND all
@@ -753,280 +752,6 @@ const WindowPositionFlags = {
     ANIMATE: 1 << 1
 };
 
-const LayoutStrategy = new Lang.Class({
-    Name: 'LayoutStrategy',
-    Abstract: true,
-
-    _init: function(monitor, rowSpacing, columnSpacing, bottomPadding) {
-        this._monitor = monitor;
-        this._rowSpacing = rowSpacing;
-        this._columnSpacing = columnSpacing;
-        this._bottomPadding = bottomPadding;
-    },
-
-    _newRow: function() {
-        // Row properties:
-        //
-        // * x, y are the position of row, relative to area
-        //
-        // * width, height are the scaled versions of fullWidth, fullHeight
-        //
-        // * width also has the spacing in between windows. It's not in
-        //   fullWidth, as the spacing is constant, whereas fullWidth is
-        //   meant to be scaled
-        //
-        // * neither height/fullHeight have any sort of spacing or padding
-        //
-        // * if cellWidth is present, all windows in the row will occupy
-        //   the space of cellWidth, centered.
-        return { x: 0, y: 0,
-                 width: 0, height: 0,
-                 fullWidth: 0, fullHeight: 0,
-                 cellWidth: 0,
-                 windows: [] };
-    },
-
-    // Compute the size and fancy scale for @window using the
-    // base scale, @scale.
-    //
-    // Returns a list structure: [ scaledWidth, scaledHeight, fancyScale ]
-    // where scaledWidth and scaledHeight are the window's
-    // width and height, scaled by fancyScale for convenience.
-    _computeWindowSizeAndScale: function(window, scale) {
-        let width = window.actor.width;
-        let height = window.actor.height;
-        let ratio;
-
-        if (width > height)
-            ratio = width / this._monitor.width;
-        else
-            ratio = height / this._monitor.height;
-
-        let fancyScale = (2 / (1 + ratio)) * scale;
-        return [width * fancyScale, height * fancyScale, fancyScale];
-    },
-
-    // Compute the size of each row, by assigning to the properties
-    // row.width, row.height, row.fullWidth, row.fullHeight, and
-    // (optionally) row.cellWidth, for each row in @layout.rows.
-    // This method is intended to be called by subclasses.
-    _computeRowSizes: function(layout) {
-        throw new Error('_computeRowSizes not implemented');
-    },
-
-    // Compute strategy-specific window slots for each window in
-    // @windows, given the @layout. The strategy may also use @layout
-    // as strategy-specific storage.
-    //
-    // This must calculate:
-    //  * maxColumns - The maximum number of columns used by the layout.
-    //  * gridWidth - The total width used by the grid, unscaled, unspaced.
-    //  * gridHeight - The totial height used by the grid, unscaled, unspaced.
-    //  * rows - A list of rows, which should be instantiated by _newRow.
-    computeLayout: function(windows, layout) {
-        throw new Error('computeLayout not implemented');
-    },
-
-    // Given @layout, compute the overall scale and space of the layout.
-    // The scale is the individual, non-fancy scale of each window, and
-    // the space is the percentage of the available area eventually
-    // used by the layout.
-
-    // This method does not return anything, but instead installs
-    // the properties "scale" and "space" on @layout directly.
-    //
-    // Make sure to call this methods before calling computeWindowSlots(),
-    // as it depends on the scale property installed in @layout here.
-    computeScaleAndSpace: function(layout) {
-        let area = layout.area;
-
-        let hspacing = (layout.maxColumns - 1) * this._columnSpacing;
-        let vspacing = (layout.numRows - 1) * this._rowSpacing + this._bottomPadding;
-
-        let spacedWidth = area.width - hspacing;
-        let spacedHeight = area.height - vspacing;
-
-        let horizontalScale = spacedWidth / layout.gridWidth;
-        let verticalScale = spacedHeight / layout.gridHeight;
-
-        // Thumbnails should be less than 70% of the original size
-        let scale = Math.min(horizontalScale, verticalScale, WINDOW_CLONE_MAXIMUM_SCALE);
-
-        let scaledLayoutWidth = layout.gridWidth * scale + hspacing;
-        let scaledLayoutHeight = layout.gridHeight * scale + vspacing;
-        let space = (scaledLayoutWidth * scaledLayoutHeight) / (area.width * area.height);
-
-        layout.scale = scale;
-        layout.space = space;
-    },
-
-    computeWindowSlots: function(layout, area) {
-        this._computeRowSizes(layout);
-
-        let { rows: rows, scale: scale, state: state } = layout;
-
-        let slots = [];
-
-        let y = 0;
-        for (let i = 0; i < rows.length; i++) {
-            let row = rows[i];
-            row.x = area.x + (area.width - row.width) / 2;
-            row.y = area.y + y;
-            y += row.height + this._rowSpacing;
-        }
-
-        let height = y - this._rowSpacing + this._bottomPadding;
-        let baseY = (area.height - height) / 2;
-
-        for (let i = 0; i < rows.length; i++) {
-            let row = rows[i];
-            row.y += baseY;
-            let baseX = row.x;
-            for (let j = 0; j < row.windows.length; j++) {
-                let window = row.windows[j];
-
-                let [width, height, s] = this._computeWindowSizeAndScale(window, scale);
-                let y = row.y + row.height - height;
-
-                let x = baseX;
-                if (row.cellWidth) {
-                    x += (row.cellWidth - width) / 2;
-                    width = row.cellWidth;
-                }
-
-                slots.push([x, y, s]);
-                baseX += width + this._columnSpacing;
-            }
-        }
-        return slots;
-    }
-});
-
-const UnalignedLayoutStrategy = new Lang.Class({
-    Name: 'UnalignedLayoutStrategy',
-    Extends: LayoutStrategy,
-
-    _computeRowSizes: function(layout) {
-        let { rows: rows, scale: scale } = layout;
-        for (let i = 0; i < rows.length; i++) {
-            let row = rows[i];
-            row.width = row.fullWidth * scale + (row.windows.length - 1) * this._columnSpacing;
-            row.height = row.fullHeight * scale;
-        }
-    },
-
-    _keepSameRow: function(row, window, width, idealRowWidth) {
-        if (row.fullWidth + width <= idealRowWidth)
-            return true;
-
-        let oldRatio = row.fullWidth / idealRowWidth;
-        let newRatio = (row.fullWidth + width) / idealRowWidth;
-
-        if (Math.abs(1 - newRatio) < Math.abs(1 - oldRatio))
-            return true;
-
-        return false;
-    },
-
-    computeLayout: function(windows, layout) {
-        let numRows = layout.numRows;
-
-        let rows = [];
-        let totalWidth = 0;
-        for (let i = 0; i < windows.length; i++) {
-            totalWidth += windows[i].actor.width;
-        }
-
-        let idealRowWidth = totalWidth / numRows;
-        let windowIdx = 0;
-        for (let i = 0; i < numRows; i++) {
-            let col = 0;
-            let row = this._newRow();
-            rows.push(row);
-
-            for (; windowIdx < windows.length; windowIdx++) {
-                let window = windows[windowIdx];
-                let [width, height] = this._computeWindowSizeAndScale(window, 1);
-                row.fullHeight = Math.max(row.fullHeight, height);
-
-                // either new width is < idealWidth or new width is nearer from idealWidth then oldWidth
-                if (this._keepSameRow(row, window, width, idealRowWidth) || (i == numRows - 1)) {
-                    row.windows.push(window);
-                    row.fullWidth += width;
-                } else {
-                    break;
-                }
-            }
-        }
-
-        let gridHeight = 0;
-        let maxRow;
-        for (let i = 0; i < numRows; i++) {
-            let row = rows[i];
-            if (!maxRow || row.fullWidth > maxRow.fullWidth)
-                maxRow = row;
-            gridHeight += row.fullHeight;
-        }
-
-        layout.rows = rows;
-        layout.maxColumns = maxRow.windows.length;
-        layout.gridWidth = maxRow.fullWidth;
-        layout.gridHeight = gridHeight;
-    }
-});
-
-const GridLayoutStrategy = new Lang.Class({
-    Name: 'GridLayoutStrategy',
-    Extends: LayoutStrategy,
-
-    _computeRowSizes: function(layout) {
-        let { rows: rows, scale: scale } = layout;
-
-        let gridWidth = layout.numColumns * layout.maxWindowWidth;
-        let hspacing = (layout.numColumns - 1) * this._columnSpacing;
-        for (let i = 0; i < rows.length; i++) {
-            let row = rows[i];
-            row.fullWidth = layout.gridWidth;
-            row.fullHeight = layout.maxWindowHeight;
-
-            row.width = row.fullWidth * scale + hspacing;
-            row.height = row.fullHeight * scale;
-            row.cellWidth = layout.maxWindowWidth * scale;
-        }
-    },
-
-    computeLayout: function(windows, layout) {
-        let { numRows: numRows, numColumns: numColumns } = layout;
-        let rows = [];
-        let windowIdx = 0;
-
-        let maxWindowWidth = 0;
-        let maxWindowHeight = 0;
-        for (let i = 0; i < numRows; i++) {
-            let row = this._newRow();
-            rows.push(row);
-            for (; windowIdx < windows.length; windowIdx++) {
-                if (row.windows.length >= numColumns)
-                    break;
-
-                let window = windows[windowIdx];
-                row.windows.push(window);
-
-                let [width, height] = this._computeWindowSizeAndScale(window, 1);
-                maxWindowWidth = Math.max(maxWindowWidth, width);
-                maxWindowHeight = Math.max(maxWindowHeight, height);
-            }
-        }
-
-        layout.rows = rows;
-        layout.maxColumns = numColumns;
-        layout.gridWidth = numColumns * maxWindowWidth;
-        layout.gridHeight = numRows * maxWindowHeight;
-        layout.maxWindowWidth = maxWindowWidth;
-        layout.maxWindowHeight = maxWindowHeight;
-    }
-});
-
 /**
  * @metaWorkspace: a #Meta.Workspace, or null
  */
@@ -1059,15 +784,23 @@ const Workspace = new Lang.Class({
 
         this.actor.connect('destroy', Lang.bind(this, this._onDestroy));
 
-        let windows = global.get_window_actors().filter(this._isMyWindow, this);
-
         // Create clones for windows that should be
         // visible in the Overview
         this._windows = [];
         this._windowOverlays = [];
-        for (let i = 0; i < windows.length; i++) {
-            if (this._isOverviewWindow(windows[i])) {
-                this._addWindowClone(windows[i]);
+        this._buildId = 0;
+        if (this.metaWorkspace && this.metaWorkspace != global.screen.get_active_workspace()) {
+            // Off-screen workspaces get their clones over the following
+            // frames, so they don't slow down the zoom into the overview
+            this._buildId = Shell.WorkScheduler.get_default().add('overview.workspaceWindows',
+                                                                  WORKSPACE_BUILD_PRIORITY,
+                                                                  Lang.bind(this, this._addNextWindowClone));
+        } else {
+            let windows = global.get_window_actors().filter(this._isMyWindow, this);
+            for (let i = 0; i < windows.length; i++) {
+                if (this._isOverviewWindow(windows[i])) {
+                    this._addWindowClone(windows[i]);
+                }
             }
         }
 
@@ -1089,7 +822,9 @@ const Workspace = new Lang.Class({
         this._positionWindowsFlags = 0;
         this._positionWindowsId = 0;
 
-        this._currentLayout = null;
+        // Finds the arrangement of the clones, remembering it for
+        // recently seen sets of window sizes
+        this._layout = new Shell.WindowLayout();
     },
 
     setGeometry: function(x, y, width, height) {
@@ -1132,7 +867,7 @@ const Workspace = new Lang.Class({
             clone = null;
 
         this._reservedSlot = clone;
-        this._currentLayout = null;
+        this._layout.invalidate();
         this.positionWindows(WindowPositionFlags.ANIMATE);
     },
 
@@ -1361,7 +1096,7 @@ const Workspace = new Lang.Class({
         this._cursorX = x;
         this._cursorY = y;
 
-        this._currentLayout = null;
+        this._layout.invalidate();
         this._repositionWindowsId = Mainloop.timeout_add(750,
             Lang.bind(this, this._delayedWindowRepositioning));
     },
@@ -1414,7 +1149,7 @@ const Workspace = new Lang.Class({
             clone.actor.set_position (this._x, this._y);
         }
 
-        this._currentLayout = null;
+        this._layout.invalidate();
         this.positionWindows(WindowPositionFlags.ANIMATE);
     },
 
@@ -1452,7 +1187,7 @@ const Workspace = new Lang.Class({
 
     // Animate the full-screen to Overview transition.
     zoomToOverview : function() {
-        this._currentLayout = null;
+        this._layout.invalidate();
 
         // Position and scale the windows.
         if (Main.overview.animationInProgress)
@@ -1536,6 +1271,11 @@ const Workspace = new Lang.Class({
         if (this._repositionWindowsId > 0)
             Mainloop.source_remove(this._repositionWindowsId);
 
+        if (this._buildId > 0) {
+            Shell.WorkScheduler.get_default().remove(this._buildId);
+            this._buildId = 0;
+        }
+
         if (this._positionWindowsId > 0)
             Meta.later_remove(this._positionWindowsId);
 
@@ -1565,6 +1305,26 @@ const Workspace = new Lang.Class({
         return tracker.is_window_interesting(win.get_meta_window());
     },
 
+    // Work scheduler item: adds one window clone per time slice, then lays them out
+    _addNextWindowClone: function() {
+        let windows = global.get_window_actors().filter(this._isMyWindow, this);
+        for (let i = 0; i < windows.length; i++) {
+            let win = windows[i];
+            if (this._lookupIndex(win.meta_window) != -1 || !this._isOverviewWindow(win))
+                continue;
+
+            this._addWindowClone(win);
+            return true;
+        }
+
+        this._buildId = 0;
+        if (!this.leavingOverview) {
+            this._layout.invalidate();
+            this.positionWindows(WindowPositionFlags.INITIAL);
+        }
+        return false;
+    },
+
     // Create a clone of a (non-desktop) window and add it to the window list
     _addWindowClone : function(win) {
         let clone = new WindowClone(win, this);
@@ -1618,69 +1378,6 @@ const Workspace = new Lang.Class({
         }
     },
 
-    _isBetterLayout: function(oldLayout, newLayout) {
-        if (oldLayout.scale === undefined)
-            return true;
-
-        let spacePower = (newLayout.space - oldLayout.space) * LAYOUT_SPACE_WEIGHT;
-        let scalePower = (newLayout.scale - oldLayout.scale) * LAYOUT_SCALE_WEIGHT;
-
-        if (newLayout.scale > oldLayout.scale && newLayout.space > oldLayout.space) {
-            // Win win -- better scale and better space
-            return true;
-        } else if (newLayout.scale > oldLayout.scale && newLayout.space <= oldLayout.space) {
-            // Keep new layout only if scale gain outweights aspect space loss
-            return scalePower > spacePower;
-        } else if (newLayout.scale <= oldLayout.scale && newLayout.space > oldLayout.space) {
-            // Keep new layout only if aspect space gain outweights scale loss
-            return spacePower > scalePower;
-        } else {
-            // Lose -- worse scale and space
-            return false;
-        }
-    },
-
-    _computeLayout: function(windows, area, rowSpacing, columnSpacing, bottomPadding) {
-        // We look for the largest scale that allows us to fit the
-        // largest row/tallest column on the workspace.
-
-        let lastLayout = {};
-
-        for (let numRows = 1; ; numRows++) {
-            let numColumns = Math.ceil(windows.length / numRows);
-
-            // If adding a new row does not change column count just stop
-            // (for instance: 9 windows, with 3 rows -> 3 columns, 4 rows ->
-            // 3 columns as well => just use 3 rows then)
-            if (numColumns == lastLayout.numColumns)
-                break;
-
-            let strategyClass = numRows > 2 ? GridLayoutStrategy : UnalignedLayoutStrategy;
-            let strategy = new strategyClass(this._monitor, rowSpacing, columnSpacing, bottomPadding);
-
-            let layout = { area: area, strategy: strategy, numRows: numRows, numColumns: numColumns };
-            strategy.computeLayout(windows, layout);
-            strategy.computeScaleAndSpace(layout);
-
-            if (!this._isBetterLayout(lastLayout, layout))
-                break;
-
-            lastLayout = layout;
-        }
-
-        return lastLayout;
-    },
-
-    _rectEqual: function(one, two) {
-        if (one == two)
-            return true;
-
-        return (one.x == two.x &&
-                one.y == two.y &&
-                one.width == two.width &&
-                one.height == two.height);
-    },
-
     _computeAllWindowSlots: function(windows) {
         let totalWindows = windows.length;
         let node = this.actor.get_theme_node();
@@ -1713,18 +1410,16 @@ const Workspace = new Lang.Class({
         area.x += leftBorder;
         area.width -= leftBorder;
 
-        if (!this._currentLayout)
-            this._currentLayout = this._computeLayout(windows, area, rowSpacing, columnSpacing, captionHeight);
+        this._layout.set_monitor_size(this._monitor.width, this._monitor.height);
+        this._layout.set_spacing(rowSpacing, columnSpacing, captionHeight);
 
-        let layout = this._currentLayout;
-        let strategy = layout.strategy;
+        let actors = windows.map(function(window) { return window.actor; });
+        let values = this._layout.compute_slots(actors, area.x, area.y, area.width, area.height);
 
-        if (!this._rectEqual(area, layout.area)) {
-            layout.area = area;
-            strategy.computeScaleAndSpace(layout);
-        }
-
-        return strategy.computeWindowSlots(layout, area);
+        let slots = [];
+        for (let i = 0; i < values.length; i += 3)
+            slots.push([values[i], values[i + 1], values[i + 2]]);
+        return slots;
     },
 
     _onCloneSelected : function (clone, time) {
@@ -27,12 +27,28 @@ const WORKSPACE_CUT_SIZE = 10;
 
 const WORKSPACE_KEEP_ALIVE_TIME = 100;
 
+// Windows in the workspace thumbnails are drawn from a downscaled copy
+// at most this large
+const WINDOW_THUMBNAIL_SIZE = 256;
+
+// Priorities for building window clones with Shell.WorkScheduler.
+// The thumbnail of the active workspace goes first, then the others;
+// the clones of non-active workspaces (see workspace.js) come last
+// since they aren't visible until the user switches workspace.
+const ACTIVE_THUMBNAIL_BUILD_PRIORITY = 0;
+const THUMBNAIL_BUILD_PRIORITY = 1;
+
+// Minimum time between two updates of the snapshot a thumbnail is painted
+// from, in milliseconds
+const THUMBNAIL_SNAPSHOT_INTERVAL = 100;
+
 const WindowClone = new Lang.Class({
     Name: 'WindowClone',
 
     _init : function(realWindow) {
-        this.actor = new Clutter.Clone({ source: realWindow.get_texture(),
-                                         reactive: true });
+        let thumbnailer = Shell.WindowThumbnailer.get_default();
+        this.actor = thumbnailer.get_thumbnail(realWindow, WINDOW_THUMBNAIL_SIZE);
+        this.actor.reactive = true;
         this.actor._delegate = this;
         this.realWindow = realWindow;
         this.metaWindow = realWindow.meta_window;
@@ -157,6 +173,7 @@ const WorkspaceThumbnail = new Lang.Class({
         this.monitorIndex = Main.layoutManager.primaryIndex;
 
         this._removed = false;
+        this._snapshotEffect = null;
 
         this.actor = new St.Widget({ clip_to_allocation: true,
                                      style_class: 'workspace-thumbnail' });
@@ -186,12 +203,15 @@ const WorkspaceThumbnail = new Lang.Class({
                                                          this._updateMinimized));
             this._allWindows.push(windows[i].meta_window);
             this._minimizedChangedIds.push(minimizedChangedId);
-
-            if (this._isMyWindow(windows[i]) && this._isOverviewWindow(windows[i])) {
-                this._addWindowClone(windows[i]);
-            }
         }
 
+        // The clones themselves are added over the following frames,
+        // so that opening the overview isn't held up by all of them
+        let priority = this.metaWorkspace == global.screen.get_active_workspace() ?
+                       ACTIVE_THUMBNAIL_BUILD_PRIORITY : THUMBNAIL_BUILD_PRIORITY;
+        this._buildId = Shell.WorkScheduler.get_default().add('overview.thumbnailWindows', priority,
+                                                              Lang.bind(this, this._addNextWindowClone));
+
         // Track window changes
         this._windowAddedId = this.metaWorkspace.connect('window-added',
                                                           Lang.bind(this, this._windowAdded));
@@ -207,6 +227,22 @@ const WorkspaceThumbnail = new Lang.Class({
         this._collapseFraction = 0; // Not collapsed
     },
 
+    // In snapshot mode the thumbnail is rendered into a texture, which
+    // is only updated when its windows are damaged, instead of painting
+    // all the window clones each frame
+    setSnapshotMode: function(enabled) {
+        if (enabled == (this._snapshotEffect != null))
+            return;
+
+        if (enabled) {
+            this._snapshotEffect = new Shell.SnapshotEffect({ interval: THUMBNAIL_SNAPSHOT_INTERVAL });
+            this.actor.add_effect(this._snapshotEffect);
+        } else {
+            this.actor.remove_effect(this._snapshotEffect);
+            this._snapshotEffect = null;
+        }
+    },
+
     setPorthole: function(x, y, width, height) {
         this._portholeX = x;
         this._portholeY = y;
@@ -223,6 +259,23 @@ const WorkspaceThumbnail = new Lang.Class({
         return -1;
     },
 
+    // Adds a clone for the next window that should have one;
+    // returns whether there may be more to add
+    _addNextWindowClone: function() {
+        let windows = global.get_window_actors().filter(this._isMyWindow, this);
+        for (let i = 0; i < windows.length; i++) {
+            let win = windows[i];
+            if (this._lookupIndex(win.meta_window) != -1 || !this._isOverviewWindow(win))
+                continue;
+
+            this._addWindowClone(win);
+            return true;
+        }
+
+        this._buildId = 0;
+        return false;
+    },
+
     syncStacking: function(stackIndices) {
         this._windows.sort(function (a, b) { return stackIndices[a.metaWindow.get_stable_sequence()] - stackIndices[b.metaWindow.get_stable_sequence()]; });
 
@@ -358,6 +411,11 @@ const WorkspaceThumbnail = new Lang.Class({
 
         this._removed = true;
 
+        if (this._buildId) {
+            Shell.WorkScheduler.get_default().remove(this._buildId);
+            this._buildId = 0;
+        }
+
         this.metaWorkspace.disconnect(this._windowAddedId);
         this.metaWorkspace.disconnect(this._windowRemovedId);
         global.screen.disconnect(this._windowEnteredMonitorId);
@@ -538,6 +596,7 @@ const ThumbnailsBox = new Lang.Class({
             this._stateCounts[ThumbnailState[key]] = 0;
 
         this._thumbnails = [];
+        this._snapshotMode = true;
 
         this.actor.connect('button-press-event', function() { return true; });
         this.actor.connect('button-release-event', Lang.bind(this, this._onButtonRelease));
@@ -556,6 +615,19 @@ const ThumbnailsBox = new Lang.Class({
                               Lang.bind(this, this._onDragCancelled));
     },
 
+    set snapshotMode(mode) {
+        if (mode == this._snapshotMode)
+            return;
+
+        this._snapshotMode = mode;
+        for (let i = 0; i < this._thumbnails.length; i++)
+            this._thumbnails[i].setSnapshotMode(mode);
+    },
+
+    get snapshotMode() {
+        return this._snapshotMode;
+    },
+
     _onButtonRelease: function(actor, event) {
         let [stageX, stageY] = event.get_coords();
         let [r, x, y] = this.actor.transform_stage_point(stageX, stageY);
@@ -763,6 +835,7 @@ const ThumbnailsBox = new Lang.Class({
             let thumbnail = new WorkspaceThumbnail(metaWorkspace);
             thumbnail.setPorthole(this._porthole.x, this._porthole.y,
                                   this._porthole.width, this._porthole.height);
+            thumbnail.setSnapshotMode(this._snapshotMode);
             this._thumbnails.push(thumbnail);
             this.actor.add_actor(thumbnail.actor);
 
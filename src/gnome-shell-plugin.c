@@ -335,6 +335,8 @@ gnome_shell_plugin_xevent_filter (MetaPlugin *plugin,
   /*
    * Pass the event to shell-global
    */
+  _shell_global_check_pointer_event (shell_plugin->global, xev);
+
   if (_shell_global_check_xdnd_event (shell_plugin->global, xev))
     return TRUE;
 
@@ -32,6 +32,9 @@
 #include "shell-mime-sniffer.h"
 #include "hotplug-mimetypes.h"
 
+#include <math.h>
+#include <string.h>
+
 #include <glib/gi18n.h>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
@@ -45,6 +48,16 @@
 #define DIRECTORY_LOAD_ITEMS_PER_CALLBACK 100
 #define HIGH_SCORE_RATIO 0.10
 
+/* Number of directories enumerated concurrently */
+#define MAX_ACTIVE_LOADERS 4
+
+/* Early termination: stop crawling once the leading content class
+ * holds at least DOMINANT_RATIO of the items with ~99% confidence.
+ */
+#define MIN_CONCLUSIVE_ITEMS 200
+#define DOMINANT_RATIO (1.0 - HIGH_SCORE_RATIO)
+#define CONFIDENCE_Z 2.576
+
 G_DEFINE_TYPE (ShellMimeSniffer, shell_mime_sniffer, G_TYPE_OBJECT);
 
 enum {
@@ -52,19 +65,31 @@ enum {
   NUM_PROPERTIES
 };
 
-static GHashTable *image_type_table = NULL;
-static GHashTable *audio_type_table = NULL;
-static GHashTable *video_type_table = NULL;
-static GHashTable *docs_type_table = NULL;
+typedef enum {
+  CONTENT_CLASS_UNRESOLVED = 0,
+  CONTENT_CLASS_NONE,
+  CONTENT_CLASS_IMAGE,
+  CONTENT_CLASS_VIDEO,
+  CONTENT_CLASS_DOCUMENT,
+  CONTENT_CLASS_AUDIO
+} ContentClass;
+
+/* Maps interned content types to their ContentClass; types that are not
+ * in any of the known lists are resolved through g_content_type_is_a()
+ * the first time they are seen, and the answer is cached here too.
+ */
+static GHashTable *content_class_table = NULL;
+
+/* The content types from the known lists, in lookup priority order */
+static GPtrArray *known_content_types = NULL;
 
 static GParamSpec *properties[NUM_PROPERTIES] = { NULL, };
 
 typedef struct {
   ShellMimeSniffer *self;
 
-  GFile *file;
-  GFileEnumerator *enumerator;
-  GList *deep_count_subdirectories;
+  GQueue deep_count_subdirectories;
+  guint n_active_loaders;
 
   gint audio_count;
   gint image_count;
@@ -74,6 +99,13 @@ typedef struct {
   gint total_items;
 } DeepCountState;
 
+typedef struct {
+  DeepCountState *state;
+
+  GFile *file;
+  GFileEnumerator *enumerator;
+} DirLoader;
+
 struct _ShellMimeSnifferPrivate {
   GFile *file;
 
@@ -87,6 +119,21 @@ struct _ShellMimeSnifferPrivate {
 static void deep_count_load (DeepCountState *state,
                              GFile *file);
 
+static void
+add_known_content_type (const gchar *content_type,
+                        ContentClass content_class)
+{
+  const gchar *interned = g_intern_string (content_type);
+
+  /* the lists overlap in a few places; keep the first class seen */
+  if (g_hash_table_lookup (content_class_table, interned) != NULL)
+    return;
+
+  g_hash_table_insert (content_class_table, (gpointer) interned,
+                       GINT_TO_POINTER (content_class));
+  g_ptr_array_add (known_content_types, (gpointer) interned);
+}
+
 static void
 init_mimetypes (void)
 {
@@ -99,10 +146,8 @@ init_mimetypes (void)
       gchar **types;
       gint idx;
 
-      image_type_table = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
-      video_type_table = g_hash_table_new (g_str_hash, g_str_equal);
-      audio_type_table = g_hash_table_new (g_str_hash, g_str_equal);
-      docs_type_table = g_hash_table_new (g_str_hash, g_str_equal);
+      content_class_table = g_hash_table_new (g_str_hash, g_str_equal);
+      known_content_types = g_ptr_array_new ();
 
       formats = gdk_pixbuf_get_formats ();
 
@@ -112,45 +157,122 @@ init_mimetypes (void)
           types = gdk_pixbuf_format_get_mime_types (format);
 
           for (idx = 0; types[idx] != NULL; idx++)
-            g_hash_table_insert (image_type_table, g_strdup (types[idx]), GINT_TO_POINTER (1));
+            add_known_content_type (types[idx], CONTENT_CLASS_IMAGE);
 
           g_strfreev (types);
         }
 
       g_slist_free (formats);
 
-      for (idx = 0; audio_mimetypes[idx] != NULL; idx++)
-        g_hash_table_insert (audio_type_table, (gpointer) audio_mimetypes[idx], GINT_TO_POINTER (1));
-
       for (idx = 0; video_mimetypes[idx] != NULL; idx++)
-        g_hash_table_insert (video_type_table, (gpointer) video_mimetypes[idx], GINT_TO_POINTER (1));
+        add_known_content_type (video_mimetypes[idx], CONTENT_CLASS_VIDEO);
 
       for (idx = 0; docs_mimetypes[idx] != NULL; idx++)
-        g_hash_table_insert (docs_type_table, (gpointer) docs_mimetypes[idx], GINT_TO_POINTER (1));
+        add_known_content_type (docs_mimetypes[idx], CONTENT_CLASS_DOCUMENT);
+
+      for (idx = 0; audio_mimetypes[idx] != NULL; idx++)
+        add_known_content_type (audio_mimetypes[idx], CONTENT_CLASS_AUDIO);
 
       g_once_init_leave (&once_init, 1);
     }
 }
 
+/* Returns the class of the first known type that @content_type is, or
+ * derives from; if @media_type is not %NULL, only known types of that
+ * media type (like "audio/") are considered.
+ */
+static ContentClass
+find_known_ancestor (const gchar *content_type,
+                     const gchar *media_type)
+{
+  const gchar *known;
+  guint idx;
+
+  for (idx = 0; idx < known_content_types->len; idx++)
+    {
+      known = g_ptr_array_index (known_content_types, idx);
+
+      if (media_type != NULL && !g_str_has_prefix (known, media_type))
+        continue;
+
+      if (g_content_type_is_a (content_type, known))
+        return GPOINTER_TO_INT (g_hash_table_lookup (content_class_table, known));
+    }
+
+  return CONTENT_CLASS_NONE;
+}
+
+static ContentClass
+resolve_content_class (const gchar *content_type)
+{
+  ContentClass content_class;
+  const gchar *slash;
+  gchar *media_type = NULL;
+
+  /* Prefer ancestors of the same media type: audio/x-opus+ogg derives
+   * from audio/ogg, but also from application/ogg, which is in the
+   * video list.
+   */
+  slash = strchr (content_type, '/');
+  if (slash != NULL)
+    media_type = g_strndup (content_type, slash - content_type + 1);
+
+  content_class = CONTENT_CLASS_NONE;
+  if (media_type != NULL)
+    content_class = find_known_ancestor (content_type, media_type);
+
+  /* Audio and video types we don't know of, like audio/webm */
+  if (content_class == CONTENT_CLASS_NONE && g_strcmp0 (media_type, "audio/") == 0)
+    content_class = CONTENT_CLASS_AUDIO;
+  else if (content_class == CONTENT_CLASS_NONE && g_strcmp0 (media_type, "video/") == 0)
+    content_class = CONTENT_CLASS_VIDEO;
+
+  if (content_class == CONTENT_CLASS_NONE)
+    content_class = find_known_ancestor (content_type, NULL);
+
+  g_free (media_type);
+
+  g_hash_table_insert (content_class_table,
+                       (gpointer) g_intern_string (content_type),
+                       GINT_TO_POINTER (content_class));
+
+  return content_class;
+}
+
 static void
 add_content_type_to_cache (DeepCountState *state,
                            const gchar *content_type)
 {
-  gboolean matched = TRUE;
-
-  if (g_hash_table_lookup (image_type_table, content_type))
-    state->image_count++;
-  else if (g_hash_table_lookup (video_type_table, content_type))
-    state->video_count++;
-  else if (g_hash_table_lookup (docs_type_table, content_type))
-    state->document_count++;
-  else if (g_hash_table_lookup (audio_type_table, content_type))
-    state->audio_count++;
-  else
-    matched = FALSE;
+  ContentClass content_class;
+
+  if (content_type == NULL)
+    return;
+
+  content_class =
+    GPOINTER_TO_INT (g_hash_table_lookup (content_class_table, content_type));
+
+  if (content_class == CONTENT_CLASS_UNRESOLVED)
+    content_class = resolve_content_class (content_type);
+
+  switch (content_class)
+    {
+    case CONTENT_CLASS_IMAGE:
+      state->image_count++;
+      break;
+    case CONTENT_CLASS_VIDEO:
+      state->video_count++;
+      break;
+    case CONTENT_CLASS_DOCUMENT:
+      state->document_count++;
+      break;
+    case CONTENT_CLASS_AUDIO:
+      state->audio_count++;
+      break;
+    default:
+      return;
+    }
 
-  if (matched)
-    state->total_items++;
+  state->total_items++;
 }
 
 typedef struct {
@@ -230,7 +352,7 @@ prepare_async_result (DeepCountState *state)
 
 /* adapted from nautilus/libnautilus-private/nautilus-directory-async.c */
 static void
-deep_count_one (DeepCountState *state,
+deep_count_one (DirLoader *loader,
 		GFileInfo *info)
 {
   GFile *subdir;
@@ -239,60 +361,114 @@ deep_count_one (DeepCountState *state,
   if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
     {
       /* record the fact that we have to descend into this directory */
-      subdir = g_file_get_child (state->file, g_file_info_get_name (info));
-      state->deep_count_subdirectories =
-        g_list_append (state->deep_count_subdirectories, subdir);
-    } 
+      subdir = g_file_get_child (loader->file, g_file_info_get_name (info));
+      g_queue_push_tail (&loader->state->deep_count_subdirectories, subdir);
+    }
   else
     {
       content_type = g_file_info_get_content_type (info);
-      add_content_type_to_cache (state, content_type);
+      add_content_type_to_cache (loader->state, content_type);
     }
 }
 
+/* Returns TRUE once the most frequent content class is so dominant that
+ * scanning further cannot plausibly bring any other class above
+ * HIGH_SCORE_RATIO, i.e. when the lower bound of the Wilson score
+ * interval for the leading ratio is above DOMINANT_RATIO.
+ */
+static gboolean
+deep_count_is_conclusive (DeepCountState *state)
+{
+  gdouble n, p, z2, center, spread, lower_bound;
+  gint max_count;
+
+  if (state->total_items < MIN_CONCLUSIVE_ITEMS)
+    return FALSE;
+
+  max_count = MAX (MAX (state->audio_count, state->image_count),
+                   MAX (state->document_count, state->video_count));
+
+  n = state->total_items;
+  p = max_count / n;
+  z2 = CONFIDENCE_Z * CONFIDENCE_Z;
+
+  center = p + z2 / (2 * n);
+  spread = CONFIDENCE_Z * sqrt (p * (1 - p) / n + z2 / (4 * n * n));
+  lower_bound = (center - spread) / (1 + z2 / n);
+
+  return lower_bound >= DOMINANT_RATIO;
+}
+
 static void
 deep_count_finish (DeepCountState *state)
 {
+  ShellMimeSniffer *self = state->self;
+
   prepare_async_result (state);
 
-  if (state->enumerator)
+  if (self->priv->watchdog_id != 0)
     {
-      if (!g_file_enumerator_is_closed (state->enumerator))
-        g_file_enumerator_close_async (state->enumerator,
-                                       0, NULL, NULL, NULL);
-
-      g_object_unref (state->enumerator);
+      g_source_remove (self->priv->watchdog_id);
+      self->priv->watchdog_id = 0;
     }
 
-  g_cancellable_reset (state->self->priv->cancellable);
-  g_clear_object (&state->file);
+  g_cancellable_reset (self->priv->cancellable);
 
-  g_list_free_full (state->deep_count_subdirectories, g_object_unref);
+  while (!g_queue_is_empty (&state->deep_count_subdirectories))
+    g_object_unref (g_queue_pop_head (&state->deep_count_subdirectories));
 
   g_free (state);
 }
 
 static void
-deep_count_next_dir (DeepCountState *state)
+dir_loader_free (DirLoader *loader)
 {
-  GFile *new_file;
+  if (loader->enumerator)
+    {
+      if (!g_file_enumerator_is_closed (loader->enumerator))
+        g_file_enumerator_close_async (loader->enumerator,
+                                       0, NULL, NULL, NULL);
+
+      g_object_unref (loader->enumerator);
+    }
+
+  g_clear_object (&loader->file);
+  g_slice_free (DirLoader, loader);
+}
 
-  g_clear_object (&state->file);
+/* Keeps up to MAX_ACTIVE_LOADERS enumerators in flight, pulling
+ * directories from the queue in breadth-first order, and completes
+ * the operation once the last one is done.
+ */
+static void
+deep_count_schedule (DeepCountState *state)
+{
+  GCancellable *cancellable = state->self->priv->cancellable;
+  GFile *new_file;
 
-  if (state->deep_count_subdirectories != NULL)
+  while (state->n_active_loaders < MAX_ACTIVE_LOADERS &&
+         !g_queue_is_empty (&state->deep_count_subdirectories) &&
+         !g_cancellable_is_cancelled (cancellable))
     {
       /* Work on a new directory. */
-      new_file = state->deep_count_subdirectories->data;
-      state->deep_count_subdirectories =
-        g_list_remove (state->deep_count_subdirectories, new_file);
-
+      new_file = g_queue_pop_head (&state->deep_count_subdirectories);
       deep_count_load (state, new_file);
       g_object_unref (new_file);
     }
-  else
-    {
-      deep_count_finish (state);
-    }
+
+  if (state->n_active_loaders == 0)
+    deep_count_finish (state);
+}
+
+static void
+dir_loader_done (DirLoader *loader)
+{
+  DeepCountState *state = loader->state;
+
+  dir_loader_free (loader);
+  state->n_active_loaders--;
+
+  deep_count_schedule (state);
 }
 
 static void
@@ -300,44 +476,45 @@ deep_count_more_files_callback (GObject *source_object,
 				GAsyncResult *res,
 				gpointer user_data)
 {
-  DeepCountState *state;
+  DirLoader *loader;
+  ShellMimeSniffer *self;
   GList *files, *l;
   GFileInfo *info;
 
-  state = user_data;
+  loader = user_data;
+  self = loader->state->self;
 
-  if (g_cancellable_is_cancelled (state->self->priv->cancellable))
+  if (g_cancellable_is_cancelled (self->priv->cancellable))
     {
-      deep_count_finish (state);
+      dir_loader_done (loader);
       return;
     }
-	
-  files = g_file_enumerator_next_files_finish (state->enumerator,
+
+  files = g_file_enumerator_next_files_finish (loader->enumerator,
                                                res, NULL);
-  
+
   for (l = files; l != NULL; l = l->next)
     {
       info = l->data;
-      deep_count_one (state, info);
+      deep_count_one (loader, info);
       g_object_unref (info);
     }
 
-  if (files == NULL)
-    {
-      g_file_enumerator_close_async (state->enumerator, 0, NULL, NULL, NULL);
-      g_object_unref (state->enumerator);
-      state->enumerator = NULL;
+  if (files != NULL && deep_count_is_conclusive (loader->state))
+    g_cancellable_cancel (self->priv->cancellable);
 
-      deep_count_next_dir (state);
+  if (files == NULL || g_cancellable_is_cancelled (self->priv->cancellable))
+    {
+      dir_loader_done (loader);
     }
   else
     {
-      g_file_enumerator_next_files_async (state->enumerator,
+      g_file_enumerator_next_files_async (loader->enumerator,
                                           DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
                                           G_PRIORITY_LOW,
-                                          state->self->priv->cancellable,
+                                          self->priv->cancellable,
                                           deep_count_more_files_callback,
-                                          state);
+                                          loader);
     }
 
   g_list_free (files);
@@ -348,33 +525,35 @@ deep_count_callback (GObject *source_object,
 		     GAsyncResult *res,
 		     gpointer user_data)
 {
-  DeepCountState *state;
+  DirLoader *loader;
+  ShellMimeSniffer *self;
   GFileEnumerator *enumerator;
 
-  state = user_data;
+  loader = user_data;
+  self = loader->state->self;
 
-  if (g_cancellable_is_cancelled (state->self->priv->cancellable))
+  if (g_cancellable_is_cancelled (self->priv->cancellable))
     {
-      deep_count_finish (state);
+      dir_loader_done (loader);
       return;
     }
 
   enumerator = g_file_enumerate_children_finish (G_FILE (source_object),
                                                  res, NULL);
-	
+
   if (enumerator == NULL)
     {
-      deep_count_next_dir (state);
+      dir_loader_done (loader);
     }
   else
     {
-      state->enumerator = enumerator;
-      g_file_enumerator_next_files_async (state->enumerator,
+      loader->enumerator = enumerator;
+      g_file_enumerator_next_files_async (loader->enumerator,
                                           DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
                                           G_PRIORITY_LOW,
-                                          state->self->priv->cancellable,
+                                          self->priv->cancellable,
                                           deep_count_more_files_callback,
-                                          state);
+                                          loader);
     }
 }
 
@@ -382,15 +561,21 @@ static void
 deep_count_load (DeepCountState *state,
                  GFile *file)
 {
-  state->file = g_object_ref (file);
+  DirLoader *loader;
+
+  loader = g_slice_new0 (DirLoader);
+  loader->state = state;
+  loader->file = g_object_ref (file);
+
+  state->n_active_loaders++;
 
-  g_file_enumerate_children_async (state->file,
+  g_file_enumerate_children_async (loader->file,
                                    LOADER_ATTRS,
                                    G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, /* flags */
                                    G_PRIORITY_LOW, /* prio */
                                    state->self->priv->cancellable,
                                    deep_count_callback,
-                                   state);
+                                   loader);
 }
 
 static void
@@ -400,6 +585,7 @@ deep_count_start (ShellMimeSniffer *self)
 
   state = g_new0 (DeepCountState, 1);
   state->self = self;
+  g_queue_init (&state->deep_count_subdirectories);
 
   deep_count_load (state, self->priv->file);
 }
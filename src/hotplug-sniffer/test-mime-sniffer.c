@@ -0,0 +1,243 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * Benchmark for ShellMimeSniffer: builds a synthetic directory tree
+ * and measures how long it takes to classify it.
+ *
+ * Usage: test-mime-sniffer [N_FILES] [DIRECTORY]
+ *
+ * If DIRECTORY is given, it is sniffed as-is and no tree is created.
+ * Otherwise, a few small trees of a single kind of file are checked
+ * to be classified as expected first.
+ */
+
+#include "shell-mime-sniffer.h"
+
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#define DEFAULT_N_FILES 100000
+#define FILES_PER_DIR 100
+#define DIRS_PER_DIR 10
+
+static GMainLoop *loop = NULL;
+
+/* Mostly pictures, with a sprinkle of other types */
+static const gchar *extensions[] = {
+  "jpg", "jpg", "jpg", "jpg", "jpg", "jpg", "jpg", "jpg", "jpg", "jpg",
+  "jpg", "jpg", "jpg", "jpg", "jpg", "jpg", "jpg", "jpg", "jpg", "mp3",
+  NULL
+};
+
+typedef struct {
+  const gchar *extension;
+  const gchar *expected;
+} Check;
+
+/* Ogg and WebM audio types derive from application/ogg and
+ * video/webm as well as from audio types */
+static const Check checks[] = {
+  { "opus", "x-content/audio" },
+  { "oga", "x-content/audio" },
+  { "weba", "x-content/audio" },
+  { "ogv", "x-content/video" },
+  { "jpg", "x-content/pictures" }
+};
+
+#define CHECK_N_FILES 10
+
+static gchar *
+create_tree (gint          n_files,
+             const gchar **file_extensions)
+{
+  gint n_extensions = g_strv_length ((gchar **) file_extensions);
+  GQueue dirs = G_QUEUE_INIT;
+  gchar *root, *dir, *path;
+  gint n_created = 0, idx;
+
+  root = g_dir_make_tmp ("sniffer-XXXXXX", NULL);
+  g_assert (root != NULL);
+
+  g_queue_push_tail (&dirs, g_strdup (root));
+
+  while (n_created < n_files)
+    {
+      dir = g_queue_pop_head (&dirs);
+
+      for (idx = 0; idx < FILES_PER_DIR && n_created < n_files; idx++, n_created++)
+        {
+          /* Empty files are all application/x-zerosize, so give each
+           * a byte of content and let the extension decide.
+           */
+          path = g_strdup_printf ("%s/file-%d.%s", dir, idx,
+                                  file_extensions[n_created % n_extensions]);
+          g_file_set_contents (path, "\n", 1, NULL);
+          g_free (path);
+        }
+
+      for (idx = 0; idx < DIRS_PER_DIR; idx++)
+        {
+          path = g_strdup_printf ("%s/dir-%d", dir, idx);
+          g_mkdir (path, 0700);
+          g_queue_push_tail (&dirs, path);
+        }
+
+      g_free (dir);
+    }
+
+  while (!g_queue_is_empty (&dirs))
+    g_free (g_queue_pop_head (&dirs));
+
+  return root;
+}
+
+static void
+remove_tree (GFile *file)
+{
+  GFileEnumerator *enumerator;
+  GFileInfo *info;
+  GFile *child;
+
+  enumerator = g_file_enumerate_children (file,
+                                          G_FILE_ATTRIBUTE_STANDARD_NAME,
+                                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                          NULL, NULL);
+
+  if (enumerator != NULL)
+    {
+      while ((info = g_file_enumerator_next_file (enumerator, NULL, NULL)) != NULL)
+        {
+          child = g_file_get_child (file, g_file_info_get_name (info));
+          remove_tree (child);
+          g_object_unref (child);
+          g_object_unref (info);
+        }
+
+      g_object_unref (enumerator);
+    }
+
+  g_file_delete (file, NULL, NULL);
+}
+
+static void
+sniff_async_ready_cb (GObject *source,
+                      GAsyncResult *res,
+                      gpointer user_data)
+{
+  gchar ***types = user_data;
+  GError *error = NULL;
+
+  *types = shell_mime_sniffer_sniff_finish (SHELL_MIME_SNIFFER (source),
+                                            res, &error);
+
+  if (error != NULL)
+    {
+      g_print ("Failed to sniff: %s\n", error->message);
+      g_error_free (error);
+    }
+
+  g_main_loop_quit (loop);
+}
+
+static gchar **
+sniff (GFile *file)
+{
+  ShellMimeSniffer *sniffer;
+  gchar **types = NULL;
+
+  sniffer = shell_mime_sniffer_new (file);
+  shell_mime_sniffer_sniff_async (sniffer, sniff_async_ready_cb, &types);
+  g_main_loop_run (loop);
+  g_object_unref (sniffer);
+
+  return types;
+}
+
+static gboolean
+run_checks (void)
+{
+  gboolean success = TRUE;
+  guint idx;
+
+  for (idx = 0; idx < G_N_ELEMENTS (checks); idx++)
+    {
+      const gchar *file_extensions[] = { checks[idx].extension, NULL };
+      gchar *root;
+      GFile *file;
+      gchar **types;
+
+      root = create_tree (CHECK_N_FILES, file_extensions);
+      file = g_file_new_for_path (root);
+
+      types = sniff (file);
+      if (types == NULL || types[0] == NULL ||
+          strcmp (types[0], checks[idx].expected) != 0)
+        {
+          g_print ("FAIL: .%s files sniffed as %s, expected %s\n",
+                   checks[idx].extension,
+                   types && types[0] ? types[0] : "nothing",
+                   checks[idx].expected);
+          success = FALSE;
+        }
+
+      g_strfreev (types);
+      remove_tree (file);
+      g_object_unref (file);
+      g_free (root);
+    }
+
+  return success;
+}
+
+int
+main (int argc, char **argv)
+{
+  GFile *file;
+  gchar *root = NULL;
+  gchar **types;
+  gint n_files = DEFAULT_N_FILES;
+  gint64 create_time, start_time;
+  gint idx;
+
+  loop = g_main_loop_new (NULL, FALSE);
+
+  if (argc > 1)
+    n_files = g_ascii_strtoll (argv[1], NULL, 10);
+
+  if (argc > 2)
+    {
+      file = g_file_new_for_commandline_arg (argv[2]);
+    }
+  else
+    {
+      if (!run_checks ())
+        return 1;
+
+      create_time = g_get_monotonic_time ();
+      root = create_tree (n_files, extensions);
+      g_print ("Created %d files in %s in %.1f ms\n", n_files, root,
+               (g_get_monotonic_time () - create_time) / 1000.);
+
+      file = g_file_new_for_path (root);
+    }
+
+  start_time = g_get_monotonic_time ();
+  types = sniff (file);
+
+  g_print ("Sniffed in %.1f ms:",
+           (g_get_monotonic_time () - start_time) / 1000.);
+  for (idx = 0; types != NULL && types[idx] != NULL; idx++)
+    g_print (" %s", types[idx]);
+  g_print ("\n");
+
+  g_strfreev (types);
+  g_main_loop_unref (loop);
+
+  if (root != NULL)
+    remove_tree (file);
+
+  g_object_unref (file);
+  g_free (root);
+
+  return 0;
+}
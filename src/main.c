@@ -213,6 +213,64 @@ malloc_statistics_callback (ShellPerfLog *perf_log,
 #endif
 }
 
+static void
+st_statistics_callback (ShellPerfLog *perf_log,
+                        gpointer      data)
+{
+  static guint last_prerenders = 0;
+  static guint last_recomputes = 0;
+  static guint last_hovers = 0;
+  static gint64 last_time = 0;
+  guint prerenders = st_statistics_get (ST_STATISTIC_PRERENDERS);
+  guint recomputes = st_statistics_get (ST_STATISTIC_THEME_NODES_RECOMPUTED);
+  guint hovers = st_statistics_get (ST_STATISTIC_HOVER_CHANGES);
+  gint64 now = g_get_monotonic_time ();
+
+  if (last_time != 0 && now > last_time)
+    shell_perf_log_update_statistic_i (perf_log,
+                                       "st.prerendersPerSecond",
+                                       (gint64) (prerenders - last_prerenders) * G_USEC_PER_SEC / (now - last_time));
+
+  /* Hover changes are the most common cause of restyling, so this
+   * tells how far a restyle spreads on average */
+  if (hovers != last_hovers)
+    shell_perf_log_update_statistic_i (perf_log,
+                                       "st.themeNodesPerHover",
+                                       (recomputes - last_recomputes) / (hovers - last_hovers));
+
+  last_prerenders = prerenders;
+  last_recomputes = recomputes;
+  last_hovers = hovers;
+  last_time = now;
+
+  shell_perf_log_update_statistic_i (perf_log,
+                                     "st.offscreenAllocations",
+                                     st_statistics_get (ST_STATISTIC_OFFSCREEN_ALLOCATIONS));
+  shell_perf_log_update_statistic_i (perf_log,
+                                     "st.offscreenReuses",
+                                     st_statistics_get (ST_STATISTIC_OFFSCREEN_REUSES));
+  shell_perf_log_update_statistic_i (perf_log,
+                                     "st.textShadowsCreated",
+                                     st_statistics_get (ST_STATISTIC_TEXT_SHADOWS_CREATED));
+  shell_perf_log_update_statistic_i (perf_log,
+                                     "st.textShadowCacheHits",
+                                     st_statistics_get (ST_STATISTIC_TEXT_SHADOW_CACHE_HITS));
+  shell_perf_log_update_statistic_i (perf_log,
+                                     "st.textureBytes",
+                                     st_statistics_get_texture_bytes ());
+}
+
+static void
+st_statistics_event_func (StStatistic statistic,
+                          gint64      value,
+                          gpointer    data)
+{
+  ShellPerfLog *perf_log = data;
+
+  if (statistic == ST_STATISTIC_SHADER_COMPILES)
+    shell_perf_log_event_x (perf_log, "st.shaderCompile", value);
+}
+
 static void
 shell_perf_log_init (void)
 {
@@ -234,10 +292,47 @@ shell_perf_log_init (void)
                                    "malloc.usedSize",
                                    "Amount of malloc'ed memory currently in use",
                                    "i");
+  shell_perf_log_define_statistic (perf_log,
+                                   "st.prerendersPerSecond",
+                                   "Number of theme node backgrounds rendered with cairo per second",
+                                   "i");
+  shell_perf_log_define_statistic (perf_log,
+                                   "st.themeNodesPerHover",
+                                   "Number of theme nodes recomputed per hover change",
+                                   "i");
+  shell_perf_log_define_statistic (perf_log,
+                                   "st.offscreenAllocations",
+                                   "Number of textures allocated for transitions and offscreen effects",
+                                   "i");
+  shell_perf_log_define_statistic (perf_log,
+                                   "st.offscreenReuses",
+                                   "Number of times a pooled texture was reused instead of allocated",
+                                   "i");
+  shell_perf_log_define_statistic (perf_log,
+                                   "st.textShadowsCreated",
+                                   "Number of label text shadows rendered and blurred",
+                                   "i");
+  shell_perf_log_define_statistic (perf_log,
+                                   "st.textShadowCacheHits",
+                                   "Number of label text shadows reused from the cache",
+                                   "i");
+  shell_perf_log_define_statistic (perf_log,
+                                   "st.textureBytes",
+                                   "Memory used by textures in the St texture cache and offscreen pool, in bytes",
+                                   "i");
+  shell_perf_log_define_event (perf_log,
+                               "st.shaderCompile",
+                               "GLSL shader created for an effect; time spent in Cogl in microseconds, not including the deferred GL compile",
+                               "x");
 
   shell_perf_log_add_statistics_callback (perf_log,
                                           malloc_statistics_callback,
                                           NULL, NULL);
+  shell_perf_log_add_statistics_callback (perf_log,
+                                          st_statistics_callback,
+                                          NULL, NULL);
+
+  st_statistics_set_event_func (st_statistics_event_func, perf_log);
 }
 
 static void
@@ -0,0 +1,546 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+#include "config.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <meta/boxes.h>
+#include <meta/screen.h>
+#include <meta/workspace.h>
+
+#include "shell-chrome-regions.h"
+#include "shell-global.h"
+#include "shell-perf-log.h"
+
+struct _ShellChromeRegionsClass
+{
+  GObjectClass parent_class;
+};
+
+struct _ShellChromeRegions
+{
+  GObject parent_instance;
+
+  ShellGenericContainer *ui_group;
+  MetaScreen *screen;
+
+  /* Tracked actors in the order they were added */
+  GPtrArray *actors;
+
+  /* What was last sent to the X server and to mutter */
+  GArray *input_rects;
+  GArray *struts;
+  gboolean input_region_set;
+  gboolean struts_set;
+};
+
+typedef struct {
+  ShellChromeRegions *regions;
+  ClutterActor *actor;
+
+  guint affects_input_region : 1;
+  guint affects_struts : 1;
+} TrackedActor;
+
+enum {
+  CHANGED,
+
+  LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+
+/* Counted across all instances; see chrome_statistics_callback() */
+static guint input_region_updates = 0;
+static guint strut_updates = 0;
+
+G_DEFINE_TYPE (ShellChromeRegions, shell_chrome_regions, G_TYPE_OBJECT);
+
+static void on_actor_allocation_changed (ClutterActor *actor,
+                                         GParamSpec   *pspec,
+                                         TrackedActor *tracked);
+static void on_actor_visible_changed    (ClutterActor *actor,
+                                         GParamSpec   *pspec,
+                                         TrackedActor *tracked);
+static void on_actor_destroy            (ClutterActor *actor,
+                                         TrackedActor *tracked);
+
+static void
+tracked_actor_free (TrackedActor *tracked)
+{
+  g_signal_handlers_disconnect_by_func (tracked->actor,
+                                        on_actor_allocation_changed, tracked);
+  g_signal_handlers_disconnect_by_func (tracked->actor,
+                                        on_actor_visible_changed, tracked);
+  g_signal_handlers_disconnect_by_func (tracked->actor,
+                                        on_actor_destroy, tracked);
+
+  g_slice_free (TrackedActor, tracked);
+}
+
+static void
+on_actor_allocation_changed (ClutterActor *actor,
+                             GParamSpec   *pspec,
+                             TrackedActor *tracked)
+{
+  g_signal_emit (tracked->regions, signals[CHANGED], 0);
+}
+
+static void
+on_actor_visible_changed (ClutterActor *actor,
+                          GParamSpec   *pspec,
+                          TrackedActor *tracked)
+{
+  g_signal_emit (tracked->regions, signals[CHANGED], 0);
+}
+
+static void
+on_actor_destroy (ClutterActor *actor,
+                  TrackedActor *tracked)
+{
+  shell_chrome_regions_untrack_actor (tracked->regions, actor);
+}
+
+static void
+on_n_workspaces_changed (MetaScreen         *screen,
+                         GParamSpec         *pspec,
+                         ShellChromeRegions *regions)
+{
+  /* New workspaces have no struts yet */
+  regions->struts_set = FALSE;
+  g_signal_emit (regions, signals[CHANGED], 0);
+}
+
+static void
+chrome_statistics_callback (ShellPerfLog *perf_log,
+                            gpointer      data)
+{
+  static guint last_input_region_updates = 0;
+  static guint last_strut_updates = 0;
+  static gint64 last_time = 0;
+  gint64 now = g_get_monotonic_time ();
+
+  if (last_time != 0 && now > last_time)
+    {
+      shell_perf_log_update_statistic_i (perf_log,
+                                         "chrome.inputRegionUpdatesPerSecond",
+                                         (gint64) (input_region_updates - last_input_region_updates) * G_USEC_PER_SEC / (now - last_time));
+      shell_perf_log_update_statistic_i (perf_log,
+                                         "chrome.strutUpdatesPerSecond",
+                                         (gint64) (strut_updates - last_strut_updates) * G_USEC_PER_SEC / (now - last_time));
+    }
+
+  last_input_region_updates = input_region_updates;
+  last_strut_updates = strut_updates;
+  last_time = now;
+}
+
+static void
+shell_chrome_regions_init (ShellChromeRegions *regions)
+{
+  regions->actors = g_ptr_array_new_with_free_func ((GDestroyNotify) tracked_actor_free);
+  regions->input_rects = g_array_new (FALSE, FALSE, sizeof (MetaRectangle));
+  regions->struts = g_array_new (FALSE, FALSE, sizeof (MetaStrut));
+
+  regions->screen = shell_global_get_screen (shell_global_get ());
+  g_signal_connect (regions->screen, "notify::n-workspaces",
+                    G_CALLBACK (on_n_workspaces_changed), regions);
+}
+
+static void
+shell_chrome_regions_finalize (GObject *object)
+{
+  ShellChromeRegions *regions = SHELL_CHROME_REGIONS (object);
+
+  g_signal_handlers_disconnect_by_func (regions->screen,
+                                        on_n_workspaces_changed, regions);
+
+  g_ptr_array_free (regions->actors, TRUE);
+  g_array_free (regions->input_rects, TRUE);
+  g_array_free (regions->struts, TRUE);
+
+  G_OBJECT_CLASS (shell_chrome_regions_parent_class)->finalize (object);
+}
+
+static void
+shell_chrome_regions_class_init (ShellChromeRegionsClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  ShellPerfLog *perf_log = shell_perf_log_get_default ();
+
+  gobject_class->finalize = shell_chrome_regions_finalize;
+
+  /**
+   * ShellChromeRegions::changed:
+   * @regions: the #ShellChromeRegions
+   *
+   * Emitted when a tracked actor is reallocated or shown or hidden,
+   * or when workspaces are added, so that the owner can schedule a
+   * call to shell_chrome_regions_update().
+   */
+  signals[CHANGED] =
+    g_signal_new ("changed",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 0);
+
+  shell_perf_log_define_statistic (perf_log,
+                                   "chrome.inputRegionUpdatesPerSecond",
+                                   "Number of times the stage input region was sent to the X server per second",
+                                   "i");
+  shell_perf_log_define_statistic (perf_log,
+                                   "chrome.strutUpdatesPerSecond",
+                                   "Number of times the workspace struts were changed per second",
+                                   "i");
+  shell_perf_log_add_statistics_callback (perf_log,
+                                          chrome_statistics_callback,
+                                          NULL, NULL);
+}
+
+/**
+ * shell_chrome_regions_new:
+ * @ui_group: the container holding the chrome; actors it skips when
+ *   painting don't take input
+ *
+ * Return value: (transfer full): a new #ShellChromeRegions
+ */
+ShellChromeRegions *
+shell_chrome_regions_new (ShellGenericContainer *ui_group)
+{
+  ShellChromeRegions *regions;
+
+  g_return_val_if_fail (SHELL_IS_GENERIC_CONTAINER (ui_group), NULL);
+
+  regions = g_object_new (SHELL_TYPE_CHROME_REGIONS, NULL);
+  regions->ui_group = ui_group;
+
+  return regions;
+}
+
+static int
+find_actor (ShellChromeRegions *regions,
+            ClutterActor       *actor)
+{
+  guint i;
+
+  for (i = 0; i < regions->actors->len; i++)
+    {
+      TrackedActor *tracked = g_ptr_array_index (regions->actors, i);
+
+      if (tracked->actor == actor)
+        return i;
+    }
+
+  return -1;
+}
+
+/**
+ * shell_chrome_regions_track_actor:
+ * @regions: the #ShellChromeRegions
+ * @actor: a chrome actor
+ * @affects_input_region: whether @actor takes input while visible
+ * @affects_struts: whether @actor reserves space at a screen edge
+ *
+ * Starts including @actor in the input region and struts. The actor
+ * is untracked automatically when it is destroyed.
+ */
+void
+shell_chrome_regions_track_actor (ShellChromeRegions *regions,
+                                  ClutterActor       *actor,
+                                  gboolean            affects_input_region,
+                                  gboolean            affects_struts)
+{
+  TrackedActor *tracked;
+
+  g_return_if_fail (SHELL_IS_CHROME_REGIONS (regions));
+  g_return_if_fail (CLUTTER_IS_ACTOR (actor));
+  g_return_if_fail (find_actor (regions, actor) == -1);
+
+  tracked = g_slice_new0 (TrackedActor);
+  tracked->regions = regions;
+  tracked->actor = actor;
+  tracked->affects_input_region = affects_input_region != FALSE;
+  tracked->affects_struts = affects_struts != FALSE;
+
+  g_signal_connect (actor, "notify::allocation",
+                    G_CALLBACK (on_actor_allocation_changed), tracked);
+  g_signal_connect (actor, "notify::visible",
+                    G_CALLBACK (on_actor_visible_changed), tracked);
+  g_signal_connect (actor, "destroy",
+                    G_CALLBACK (on_actor_destroy), tracked);
+
+  g_ptr_array_add (regions->actors, tracked);
+
+  g_signal_emit (regions, signals[CHANGED], 0);
+}
+
+/**
+ * shell_chrome_regions_untrack_actor:
+ * @regions: the #ShellChromeRegions
+ * @actor: a chrome actor
+ *
+ * Stops including @actor in the input region and struts.
+ */
+void
+shell_chrome_regions_untrack_actor (ShellChromeRegions *regions,
+                                    ClutterActor       *actor)
+{
+  int i;
+
+  g_return_if_fail (SHELL_IS_CHROME_REGIONS (regions));
+
+  i = find_actor (regions, actor);
+  if (i == -1)
+    return;
+
+  g_ptr_array_remove_index (regions->actors, i);
+
+  g_signal_emit (regions, signals[CHANGED], 0);
+}
+
+/* Boxes aren't cached: an actor also moves on screen when one of its
+ * ancestors is moved or shown, without being reallocated itself. */
+static void
+get_actor_rect (ClutterActor  *actor,
+                MetaRectangle *rect)
+{
+  gfloat x, y, width, height;
+
+  clutter_actor_get_transformed_position (actor, &x, &y);
+  clutter_actor_get_transformed_size (actor, &width, &height);
+
+  rect->x = (int) floorf (x + 0.5);
+  rect->y = (int) floorf (y + 0.5);
+  rect->width = (int) floorf (width + 0.5);
+  rect->height = (int) floorf (height + 0.5);
+}
+
+/* NetWM struts are not really powerful enought to handle a
+ * multi-monitor scenario, they only describe what happens around the
+ * outer sides of the full display region. However it can describe a
+ * partial region along each side, so we can support having the struts
+ * only affect the primary monitor. This should be enough as we only
+ * have chrome affecting the struts on the primary monitor so far.
+ *
+ * Metacity wants to know what side of the screen the strut is
+ * considered to be attached to. If the actor is only touching one
+ * edge, or is touching the entire border of the primary monitor, then
+ * it's obvious which side to call it. If it's in a corner, we pick a
+ * side arbitrarily. If it doesn't touch any edges, or it spans the
+ * width/height across the middle of the screen, then we don't create
+ * a strut for it at all.
+ */
+static gboolean
+compute_strut (const MetaRectangle *rect,
+               const MetaRectangle *primary,
+               int                  screen_width,
+               int                  screen_height,
+               MetaStrut           *strut)
+{
+  int x1, x2, y1, y2;
+  MetaSide side;
+
+  /* Limit struts to the size of the screen */
+  x1 = MAX (rect->x, 0);
+  x2 = MIN (rect->x + rect->width, screen_width);
+  y1 = MAX (rect->y, 0);
+  y2 = MIN (rect->y + rect->height, screen_height);
+
+  if (x1 <= primary->x && x2 >= primary->x + primary->width)
+    {
+      if (y1 <= primary->y)
+        side = META_SIDE_TOP;
+      else if (y2 >= primary->y + primary->height)
+        side = META_SIDE_BOTTOM;
+      else
+        return FALSE;
+    }
+  else if (y1 <= primary->y && y2 >= primary->y + primary->height)
+    {
+      if (x1 <= 0)
+        side = META_SIDE_LEFT;
+      else if (x2 >= screen_width)
+        side = META_SIDE_RIGHT;
+      else
+        return FALSE;
+    }
+  else if (x1 <= 0)
+    side = META_SIDE_LEFT;
+  else if (y1 <= 0)
+    side = META_SIDE_TOP;
+  else if (x2 >= screen_width)
+    side = META_SIDE_RIGHT;
+  else if (y2 >= screen_height)
+    side = META_SIDE_BOTTOM;
+  else
+    return FALSE;
+
+  /* Ensure that the strut rects goes all the way to the screen edge,
+   * as this really what mutter expects.
+   */
+  switch (side)
+    {
+    case META_SIDE_TOP:
+      y1 = 0;
+      break;
+    case META_SIDE_BOTTOM:
+      y2 = screen_height;
+      break;
+    case META_SIDE_LEFT:
+      x1 = 0;
+      break;
+    case META_SIDE_RIGHT:
+      x2 = screen_width;
+      break;
+    }
+
+  strut->rect.x = x1;
+  strut->rect.y = y1;
+  strut->rect.width = x2 - x1;
+  strut->rect.height = y2 - y1;
+  strut->side = side;
+
+  return TRUE;
+}
+
+static gboolean
+rects_equal (GArray *a,
+             GArray *b)
+{
+  guint i;
+
+  if (a->len != b->len)
+    return FALSE;
+
+  for (i = 0; i < a->len; i++)
+    if (!meta_rectangle_equal (&g_array_index (a, MetaRectangle, i),
+                               &g_array_index (b, MetaRectangle, i)))
+      return FALSE;
+
+  return TRUE;
+}
+
+static gboolean
+struts_equal (GArray *a,
+              GArray *b)
+{
+  guint i;
+
+  if (a->len != b->len)
+    return FALSE;
+
+  for (i = 0; i < a->len; i++)
+    {
+      MetaStrut *strut_a = &g_array_index (a, MetaStrut, i);
+      MetaStrut *strut_b = &g_array_index (b, MetaStrut, i);
+
+      if (strut_a->side != strut_b->side ||
+          !meta_rectangle_equal (&strut_a->rect, &strut_b->rect))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static GSList *
+array_to_slist (GArray *array,
+                gsize   element_size)
+{
+  GSList *list = NULL;
+  int i;
+
+  for (i = array->len - 1; i >= 0; i--)
+    list = g_slist_prepend (list, array->data + i * element_size);
+
+  return list;
+}
+
+/**
+ * shell_chrome_regions_update:
+ * @regions: the #ShellChromeRegions
+ *
+ * Computes the input region and struts from the tracked actors and
+ * applies them if they changed since the last update.
+ */
+void
+shell_chrome_regions_update (ShellChromeRegions *regions)
+{
+  MetaRectangle primary;
+  int screen_width, screen_height;
+  GArray *input_rects, *struts;
+  GSList *list;
+  guint i;
+
+  g_return_if_fail (SHELL_IS_CHROME_REGIONS (regions));
+
+  meta_screen_get_size (regions->screen, &screen_width, &screen_height);
+  meta_screen_get_monitor_geometry (regions->screen,
+                                    meta_screen_get_primary_monitor (regions->screen),
+                                    &primary);
+
+  input_rects = g_array_new (FALSE, FALSE, sizeof (MetaRectangle));
+  struts = g_array_new (FALSE, FALSE, sizeof (MetaStrut));
+
+  for (i = 0; i < regions->actors->len; i++)
+    {
+      TrackedActor *tracked = g_ptr_array_index (regions->actors, i);
+      MetaRectangle rect;
+      MetaStrut strut;
+
+      if (!tracked->affects_input_region && !tracked->affects_struts)
+        continue;
+
+      get_actor_rect (tracked->actor, &rect);
+
+      if (tracked->affects_input_region &&
+          clutter_actor_get_paint_visibility (tracked->actor) &&
+          !shell_generic_container_get_skip_paint (regions->ui_group, tracked->actor))
+        g_array_append_val (input_rects, rect);
+
+      if (tracked->affects_struts &&
+          compute_strut (&rect, &primary,
+                         screen_width, screen_height, &strut))
+        g_array_append_val (struts, strut);
+    }
+
+  if (!regions->input_region_set || !rects_equal (input_rects, regions->input_rects))
+    {
+      list = array_to_slist (input_rects, sizeof (MetaRectangle));
+      shell_global_set_stage_input_region (shell_global_get (), list);
+      g_slist_free (list);
+
+      g_array_free (regions->input_rects, TRUE);
+      regions->input_rects = input_rects;
+      regions->input_region_set = TRUE;
+      input_region_updates++;
+    }
+  else
+    {
+      g_array_free (input_rects, TRUE);
+    }
+
+  /* Setting struts makes mutter recompute the work area of every
+   * window, so this is the expensive part.
+   */
+  if (!regions->struts_set || !struts_equal (struts, regions->struts))
+    {
+      GList *l;
+
+      list = array_to_slist (struts, sizeof (MetaStrut));
+      for (l = meta_screen_get_workspaces (regions->screen); l; l = l->next)
+        meta_workspace_set_builtin_struts (l->data, list);
+      g_slist_free (list);
+
+      g_array_free (regions->struts, TRUE);
+      regions->struts = struts;
+      regions->struts_set = TRUE;
+      strut_updates++;
+    }
+  else
+    {
+      g_array_free (struts, TRUE);
+    }
+}
@@ -0,0 +1,42 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+#ifndef __SHELL_CHROME_REGIONS_H__
+#define __SHELL_CHROME_REGIONS_H__
+
+#include <clutter/clutter.h>
+
+#include "shell-generic-container.h"
+
+/**
+ * SECTION:shell-chrome-regions
+ * @short_description: Input region and struts of the shell chrome
+ *
+ * #ShellChromeRegions keeps track of the chrome actors that take input
+ * or reserve screen space, and turns them into the stage input region
+ * and the workspace struts. Nothing is sent to the X server or to
+ * mutter unless the result changed since the last update.
+ */
+
+typedef struct _ShellChromeRegions      ShellChromeRegions;
+typedef struct _ShellChromeRegionsClass ShellChromeRegionsClass;
+
+#define SHELL_TYPE_CHROME_REGIONS              (shell_chrome_regions_get_type ())
+#define SHELL_CHROME_REGIONS(object)           (G_TYPE_CHECK_INSTANCE_CAST ((object), SHELL_TYPE_CHROME_REGIONS, ShellChromeRegions))
+#define SHELL_CHROME_REGIONS_CLASS(klass)      (G_TYPE_CHECK_CLASS_CAST ((klass), SHELL_TYPE_CHROME_REGIONS, ShellChromeRegionsClass))
+#define SHELL_IS_CHROME_REGIONS(object)        (G_TYPE_CHECK_INSTANCE_TYPE ((object), SHELL_TYPE_CHROME_REGIONS))
+#define SHELL_IS_CHROME_REGIONS_CLASS(klass)   (G_TYPE_CHECK_CLASS_TYPE ((klass), SHELL_TYPE_CHROME_REGIONS))
+#define SHELL_CHROME_REGIONS_GET_CLASS(obj)    (G_TYPE_INSTANCE_GET_CLASS ((obj), SHELL_TYPE_CHROME_REGIONS, ShellChromeRegionsClass))
+
+GType shell_chrome_regions_get_type (void) G_GNUC_CONST;
+
+ShellChromeRegions *shell_chrome_regions_new           (ShellGenericContainer *ui_group);
+
+void                shell_chrome_regions_track_actor   (ShellChromeRegions    *regions,
+                                                        ClutterActor          *actor,
+                                                        gboolean               affects_input_region,
+                                                        gboolean               affects_struts);
+void                shell_chrome_regions_untrack_actor (ShellChromeRegions    *regions,
+                                                        ClutterActor          *actor);
+
+void                shell_chrome_regions_update        (ShellChromeRegions    *regions);
+
+#endif /* __SHELL_CHROME_REGIONS_H__ */
@@ -15,5 +15,7 @@ GjsContext *_shell_global_get_gjs_context (ShellGlobal  *global);
 
 gboolean _shell_global_check_xdnd_event (ShellGlobal  *global,
                                          XEvent       *xev);
+void _shell_global_check_pointer_event (ShellGlobal  *global,
+                                        XEvent       *xev);
 
 #endif /* __SHELL_GLOBAL_PRIVATE_H__ */
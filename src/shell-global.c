@@ -15,6 +15,7 @@
 #endif
 
 #include <X11/extensions/Xfixes.h>
+#include <X11/extensions/XInput2.h>
 #include <cogl-pango/cogl-pango.h>
 #include <canberra.h>
 #include <clutter/glx/clutter-glx.h>
@@ -43,8 +44,14 @@
 static ShellGlobal *the_object = NULL;
 
 static void grab_notify (GtkWidget *widget, gboolean is_grab, gpointer user_data);
+static JSGCCallback previous_gc_callback = NULL;
+
 static void shell_global_on_gc (GjsContext   *context,
                                 ShellGlobal  *global);
+static JSBool shell_global_gc_callback (JSContext    *context,
+                                        JSGCStatus    status);
+static void gc_statistics_callback (ShellPerfLog *perf_log,
+                                    gpointer      data);
 
 struct _ShellGlobal {
   GObject parent;
@@ -91,7 +98,16 @@ struct _ShellGlobal {
 
   guint32 xdnd_timestamp;
 
+  /* XInput 2 opcode, or 0 if raw events aren't available */
+  int xi2_opcode;
+  gboolean pointer_tracking;
+  int pointer_x;
+  int pointer_y;
+  guint pointer_update_id;
+
   gint64 last_gc_end_time;
+  gint64 gc_start_time;
+  guint n_gcs;
 };
 
 enum {
@@ -122,6 +138,7 @@ enum
  XDND_POSITION_CHANGED,
  XDND_LEAVE,
  XDND_ENTER,
+ POINTER_MOVED,
  NOTIFY_ERROR,
  LAST_SIGNAL
 };
@@ -236,6 +253,7 @@ shell_global_init (ShellGlobal *global)
   const char *datadir = g_getenv ("GNOME_SHELL_DATADIR");
   const char *shell_js = g_getenv("GNOME_SHELL_JS");
   char *imagedir, **search_path;
+  ShellPerfLog *perf_log;
 
   if (!datadir)
     datadir = GNOME_SHELL_DATADIR;
@@ -280,6 +298,24 @@ shell_global_init (ShellGlobal *global)
                                      NULL);
   g_signal_connect (global->js_context, "gc", G_CALLBACK (shell_global_on_gc), global);
 
+  /* The "gc" signal only tells when a collection is over; to time them
+   * we put our own callback in front of the one gjs installed */
+  previous_gc_callback = JS_SetGCCallback (gjs_context_get_native_context (global->js_context),
+                                           shell_global_gc_callback);
+
+  perf_log = shell_perf_log_get_default ();
+  shell_perf_log_define_event (perf_log,
+                               "gc.pause",
+                               "JavaScript garbage collection; duration in microseconds",
+                               "x");
+  shell_perf_log_define_statistic (perf_log,
+                                   "gc.collections",
+                                   "Number of JavaScript garbage collections since startup",
+                                   "i");
+  shell_perf_log_add_statistics_callback (perf_log,
+                                          gc_statistics_callback,
+                                          global, NULL);
+
   g_strfreev (search_path);
 }
 
@@ -292,6 +328,9 @@ shell_global_finalize (GObject *object)
   gtk_widget_destroy (GTK_WIDGET (global->grab_notifier));
   g_object_unref (global->settings);
 
+  if (global->pointer_update_id != 0)
+    g_source_remove (global->pointer_update_id);
+
   the_object = NULL;
 
   G_OBJECT_CLASS(shell_global_parent_class)->finalize (object);
@@ -333,6 +372,23 @@ shell_global_class_init (ShellGlobalClass *klass)
                     NULL, NULL, NULL,
                     G_TYPE_NONE, 0);
 
+  /**
+   * ShellGlobal::pointer-moved:
+   * @global: the #ShellGlobal
+   * @x: the new X coordinate of the pointer
+   * @y: the new Y coordinate of the pointer
+   *
+   * Emitted at most once per frame while pointer tracking is enabled
+   * and the pointer moves; see shell_global_set_pointer_tracking().
+   */
+  shell_global_signals[POINTER_MOVED] =
+      g_signal_new ("pointer-moved",
+                    G_TYPE_FROM_CLASS (klass),
+                    G_SIGNAL_RUN_LAST,
+                    0,
+                    NULL, NULL, NULL,
+                    G_TYPE_NONE, 2, G_TYPE_INT, G_TYPE_INT);
+
   shell_global_signals[NOTIFY_ERROR] =
       g_signal_new ("notify-error",
                     G_TYPE_FROM_CLASS (klass),
@@ -930,6 +986,18 @@ _shell_global_set_plugin (ShellGlobal *global,
   global->gdk_screen = gdk_display_get_screen (global->gdk_display,
                                                meta_screen_get_screen_number (global->meta_screen));
 
+  /* Raw motion events are only used if GDK already negotiated XInput 2
+   * on this connection; asking for another version would fail.
+   */
+  if (GDK_IS_X11_DEVICE_MANAGER_XI2 (gdk_display_get_device_manager (global->gdk_display)))
+    {
+      int event_base, error_base;
+
+      if (!XQueryExtension (global->xdisplay, "XInputExtension",
+                            &global->xi2_opcode, &event_base, &error_base))
+        global->xi2_opcode = 0;
+    }
+
   global->stage = CLUTTER_STAGE (meta_get_stage_for_screen (global->meta_screen));
   global->stage_xwindow = clutter_x11_get_stage_window (global->stage);
   global->stage_gdk_window = gdk_x11_window_foreign_new_for_display (global->gdk_display,
@@ -1198,6 +1266,42 @@ shell_global_on_gc (GjsContext   *context,
   global->last_gc_end_time = g_get_monotonic_time ();
 }
 
+/* Called by SpiderMonkey at the phases of each collection; this
+ * must not call into JavaScript */
+static JSBool
+shell_global_gc_callback (JSContext  *context,
+                          JSGCStatus  status)
+{
+  ShellGlobal *global = the_object;
+
+  if (global != NULL && status == JSGC_BEGIN)
+    {
+      global->gc_start_time = g_get_monotonic_time ();
+    }
+  else if (global != NULL && status == JSGC_END && global->gc_start_time != 0)
+    {
+      shell_perf_log_event_x (shell_perf_log_get_default (),
+                              "gc.pause",
+                              g_get_monotonic_time () - global->gc_start_time);
+      global->gc_start_time = 0;
+      global->n_gcs++;
+    }
+
+  if (previous_gc_callback)
+    return previous_gc_callback (context, status);
+
+  return JS_TRUE;
+}
+
+static void
+gc_statistics_callback (ShellPerfLog *perf_log,
+                        gpointer      data)
+{
+  ShellGlobal *global = data;
+
+  shell_perf_log_update_statistic_i (perf_log, "gc.collections", global->n_gcs);
+}
+
 /**
  * shell_global_get_memory_info:
  * @global:
@@ -1230,6 +1334,8 @@ shell_global_get_memory_info (ShellGlobal        *global,
   meminfo->gjs_function = (unsigned int) gjs_counter_function.value;
   meminfo->gjs_closure = (unsigned int) gjs_counter_closure.value;
 
+  meminfo->texture_bytes = st_statistics_get_texture_bytes ();
+
   now = g_get_monotonic_time ();
 
   meminfo->last_gc_seconds_ago = (now - global->last_gc_end_time) / G_TIME_SPAN_SECOND;
@@ -1377,6 +1483,105 @@ shell_global_sync_pointer (ShellGlobal *global)
   clutter_event_put ((ClutterEvent *)&event);
 }
 
+static void
+select_raw_motion (ShellGlobal *global,
+                   gboolean     select)
+{
+  Window root = DefaultRootWindow (global->xdisplay);
+  unsigned char mask_bits[XIMaskLen (XI_LASTEVENT)] = { 0 };
+  XIEventMask mask = { XIAllMasterDevices, sizeof (mask_bits), mask_bits };
+  XIEventMask *selected;
+  int n_selected, i;
+
+  /* Other code on this connection may have selected events on the root
+   * window too, so merge with, rather than replace, the existing mask.
+   */
+  selected = XIGetSelectedEvents (global->xdisplay, root, &n_selected);
+  for (i = 0; i < n_selected; i++)
+    {
+      if (selected[i].deviceid == XIAllMasterDevices)
+        memcpy (mask_bits, selected[i].mask,
+                MIN (selected[i].mask_len, (int) sizeof (mask_bits)));
+    }
+  if (selected)
+    XFree (selected);
+
+  if (select)
+    XISetMask (mask_bits, XI_RawMotion);
+  else
+    XIClearMask (mask_bits, XI_RawMotion);
+
+  XISelectEvents (global->xdisplay, root, &mask, 1);
+}
+
+static gboolean
+update_pointer_position (gpointer data)
+{
+  ShellGlobal *global = data;
+  Window root, child;
+  int x, y, win_x, win_y;
+  unsigned int mask;
+
+  global->pointer_update_id = 0;
+
+  XQueryPointer (global->xdisplay, DefaultRootWindow (global->xdisplay),
+                 &root, &child, &x, &y, &win_x, &win_y, &mask);
+
+  if (x != global->pointer_x || y != global->pointer_y)
+    {
+      global->pointer_x = x;
+      global->pointer_y = y;
+      g_signal_emit (global, shell_global_signals[POINTER_MOVED], 0, x, y);
+    }
+
+  return FALSE;
+}
+
+/**
+ * shell_global_set_pointer_tracking:
+ * @global: the #ShellGlobal
+ * @tracking: whether to track the pointer
+ *
+ * Turns on or off emission of #ShellGlobal::pointer-moved. While
+ * tracking, the X server notifies us of raw pointer motion and the
+ * position is read back once per frame that the pointer moved in, so
+ * nothing is done while the pointer is still.
+ *
+ * Return value: %FALSE if the X server can't report pointer motion
+ *   this way, in which case callers have to poll
+ *   shell_global_get_pointer() instead.
+ */
+gboolean
+shell_global_set_pointer_tracking (ShellGlobal *global,
+                                   gboolean     tracking)
+{
+  g_return_val_if_fail (SHELL_IS_GLOBAL (global), FALSE);
+
+  if (global->xi2_opcode == 0)
+    return FALSE;
+
+  tracking = tracking != FALSE;
+  if (global->pointer_tracking == tracking)
+    return TRUE;
+
+  global->pointer_tracking = tracking;
+  select_raw_motion (global, tracking);
+
+  if (tracking)
+    {
+      /* The pointer may have moved anywhere since we last looked */
+      global->pointer_x = -1;
+      global->pointer_y = -1;
+    }
+  else if (global->pointer_update_id != 0)
+    {
+      g_source_remove (global->pointer_update_id);
+      global->pointer_update_id = 0;
+    }
+
+  return TRUE;
+}
+
 /**
  * shell_global_get_settings:
  * @global: A #ShellGlobal
@@ -1686,6 +1891,31 @@ gboolean _shell_global_check_xdnd_event (ShellGlobal  *global,
     return FALSE;
 }
 
+/*
+ * Process XInput 2 raw motion events
+ *
+ * These arrive for every motion of every pointing device, so rather
+ * than reacting to each one we only make sure the pointer position is
+ * read back and reported at the next frame.
+ */
+void
+_shell_global_check_pointer_event (ShellGlobal *global,
+                                   XEvent      *xev)
+{
+  if (!global->pointer_tracking)
+    return;
+
+  if (xev->xany.type != GenericEvent ||
+      xev->xcookie.extension != global->xi2_opcode ||
+      xev->xcookie.evtype != XI_RawMotion)
+    return;
+
+  if (global->pointer_update_id == 0)
+    global->pointer_update_id =
+      g_timeout_add (1000 / clutter_get_default_frame_rate (),
+                     update_pointer_position, global);
+}
+
 const char *
 shell_global_get_session_mode (ShellGlobal *global)
 {
@@ -83,6 +83,8 @@ void    shell_global_get_pointer             (ShellGlobal         *global,
                                               int                 *x,
                                               int                 *y,
                                               ClutterModifierType *mods);
+gboolean shell_global_set_pointer_tracking   (ShellGlobal         *global,
+                                              gboolean             tracking);
 
 typedef struct {
   guint glibc_uordblks;
@@ -94,6 +96,9 @@ typedef struct {
   guint gjs_function;
   guint gjs_closure;
 
+  /* Textures kept by St, see st_statistics_get_texture_bytes() */
+  guint texture_bytes;
+
   /* 32 bit to avoid js conversion problems with 64 bit */
   guint  last_gc_seconds_ago;
 } ShellMemoryInfo;
@@ -14,6 +14,9 @@
 
 #define BUS_NAME "org.gnome.Shell.PerfHelper"
 
+/* How often animated windows redraw, in milliseconds */
+#define ANIMATION_INTERVAL 16
+
 static void destroy_windows           (void);
 static void finish_wait_windows       (void);
 static void check_finish_wait_windows (void);
@@ -28,6 +31,15 @@ static const gchar introspection_xml[] =
 	  "      <arg type='b' name='alpha' direction='in'/>"
 	  "      <arg type='b' name='maximized' direction='in'/>"
 	  "    </method>"
+	  "    <method name='CreateAnimatedWindow'>"
+	  "      <arg type='i' name='width' direction='in'/>"
+	  "      <arg type='i' name='height' direction='in'/>"
+	  "      <arg type='b' name='alpha' direction='in'/>"
+	  "      <arg type='b' name='maximized' direction='in'/>"
+	  "    </method>"
+	  "    <method name='CreateTrayIcons'>"
+	  "      <arg type='i' name='count' direction='in'/>"
+	  "    </method>"
 	  "    <method name='WaitWindows'/>"
 	  "    <method name='DestroyWindows'/>"
 	  "  </interface>"
@@ -43,8 +55,16 @@ typedef struct {
   guint mapped : 1;
   guint exposed : 1;
   guint pending : 1;
+
+  guint animation_id;
 } WindowInfo;
 
+typedef struct {
+  GtkStatusIcon *icon;
+
+  guint pending : 1;
+} TrayIconInfo;
+
 static int opt_idle_timeout = 30;
 
 static GOptionEntry opt_entries[] =
@@ -61,6 +81,7 @@ static Atom atom_utf8_string;
 
 static guint timeout_id;
 static GList *our_windows;
+static GList *our_tray_icons;
 static GList *wait_windows_invocations;
 
 static gboolean
@@ -91,6 +112,8 @@ destroy_windows (void)
   for (l = our_windows; l; l = l->next)
     {
       WindowInfo *info = l->data;
+      if (info->animation_id != 0)
+        g_source_remove (info->animation_id);
       gtk_widget_destroy (info->window);
       g_free (info);
     }
@@ -98,6 +121,17 @@ destroy_windows (void)
   g_list_free (our_windows);
   our_windows = NULL;
 
+  for (l = our_tray_icons; l; l = l->next)
+    {
+      TrayIconInfo *info = l->data;
+      g_signal_handlers_disconnect_by_data (info->icon, info);
+      g_object_unref (info->icon);
+      g_free (info);
+    }
+
+  g_list_free (our_tray_icons);
+  our_tray_icons = NULL;
+
   check_finish_wait_windows ();
 }
 
@@ -147,6 +181,21 @@ on_window_draw (GtkWidget  *window,
   cairo_line_to (cr, allocation.width - 40, allocation.height);
   cairo_stroke (cr);
 
+  /* Animated windows also draw a square that moves across the window,
+   * so that their content changes each frame */
+  if (info->animation_id != 0)
+    {
+      double size = MIN (allocation.width, allocation.height) / 4;
+      double t = (g_get_monotonic_time () % G_USEC_PER_SEC) / (double) G_USEC_PER_SEC;
+
+      cairo_set_source_rgb (cr, 0, 0, 1);
+      cairo_rectangle (cr,
+                       t * (allocation.width - size),
+                       (allocation.height - size) / 2,
+                       size, size);
+      cairo_fill (cr);
+    }
+
   info->exposed = TRUE;
 
   if (info->exposed && info->mapped && info->pending)
@@ -158,11 +207,22 @@ on_window_draw (GtkWidget  *window,
   return FALSE;
 }
 
+static gboolean
+on_animation_timeout (gpointer data)
+{
+  WindowInfo *info = data;
+
+  gtk_widget_queue_draw (info->window);
+
+  return TRUE;
+}
+
 static void
 create_window (int      width,
 	       int      height,
                gboolean alpha,
-               gboolean maximized)
+               gboolean maximized,
+               gboolean animated)
 {
   WindowInfo *info;
 
@@ -184,9 +244,47 @@ create_window (int      width,
   g_signal_connect (info->window, "draw", G_CALLBACK (on_window_draw), info);
   gtk_widget_show (info->window);
 
+  if (animated)
+    info->animation_id = g_timeout_add (ANIMATION_INTERVAL, on_animation_timeout, info);
+
   our_windows = g_list_prepend (our_windows, info);
 }
 
+static void
+on_tray_icon_embedded_changed (GtkStatusIcon *icon,
+                               GParamSpec    *pspec,
+                               TrayIconInfo  *info)
+{
+  if (info->pending && gtk_status_icon_is_embedded (icon))
+    {
+      info->pending = FALSE;
+      check_finish_wait_windows ();
+    }
+}
+
+/* The icons are embedded by the tray manager of the shell, which shows
+ * them in the message tray */
+static void
+create_tray_icons (int count)
+{
+  int i;
+
+  for (i = 0; i < count; i++)
+    {
+      TrayIconInfo *info;
+
+      info = g_new0 (TrayIconInfo, 1);
+      info->icon = gtk_status_icon_new_from_icon_name ("dialog-information");
+      gtk_status_icon_set_title (info->icon, "Performance test");
+      info->pending = TRUE;
+
+      g_signal_connect (info->icon, "notify::embedded",
+                        G_CALLBACK (on_tray_icon_embedded_changed), info);
+
+      our_tray_icons = g_list_prepend (our_tray_icons, info);
+    }
+}
+
 static void
 finish_wait_windows (void)
 {
@@ -212,6 +310,13 @@ check_finish_wait_windows (void)
         have_pending = TRUE;
     }
 
+  for (l = our_tray_icons; l; l = l->next)
+    {
+      TrayIconInfo *info = l->data;
+      if (info->pending)
+        have_pending = TRUE;
+    }
+
   if (!have_pending)
     finish_wait_windows ();
 }
@@ -245,7 +350,26 @@ handle_method_call (GDBusConnection       *connection,
 
       g_variant_get (parameters, "(iibb)", &width, &height, &alpha, &maximized);
 
-      create_window (width, height, alpha, maximized);
+      create_window (width, height, alpha, maximized, FALSE);
+      g_dbus_method_invocation_return_value (invocation, NULL);
+    }
+  else if (g_strcmp0 (method_name, "CreateAnimatedWindow") == 0)
+    {
+      int width, height;
+      gboolean alpha, maximized;
+
+      g_variant_get (parameters, "(iibb)", &width, &height, &alpha, &maximized);
+
+      create_window (width, height, alpha, maximized, TRUE);
+      g_dbus_method_invocation_return_value (invocation, NULL);
+    }
+  else if (g_strcmp0 (method_name, "CreateTrayIcons") == 0)
+    {
+      int count;
+
+      g_variant_get (parameters, "(i)", &count);
+
+      create_tray_icons (count);
       g_dbus_method_invocation_return_value (invocation, NULL);
     }
   else if (g_strcmp0 (method_name, "WaitWindows") == 0)
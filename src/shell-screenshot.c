@@ -3,18 +3,36 @@
 #define COGL_ENABLE_EXPERIMENTAL_API
 #define CLUTTER_ENABLE_EXPERIMENTAL_API
 
+#include <setjmp.h>
+#include <string.h>
+
 #include <X11/extensions/Xfixes.h>
 #include <clutter/x11/clutter-x11.h>
 #include <clutter/clutter.h>
 #include <cogl/cogl.h>
+#include <gio/gunixoutputstream.h>
 #include <meta/display.h>
 #include <meta/util.h>
 #include <meta/meta-plugin.h>
 #include <meta/meta-shaped-texture.h>
+#include <png.h>
+#include <zlib.h>
 
 #include "shell-global.h"
+#include "shell-perf-log.h"
 #include "shell-screenshot.h"
 
+/* Number of rows read back from the framebuffer at a time; the encoder
+ * thread starts on the first band while the following ones are still
+ * being copied.
+ */
+#define BAND_HEIGHT 128
+
+/* Number of pixel buffers reading bands back at once; once they are
+ * all in use, the oldest one is copied out and reused for the next band.
+ */
+#define N_PIXEL_BUFFERS 4
+
 struct _ShellScreenshotClass
 {
   GObjectClass parent_class;
@@ -25,6 +43,11 @@ struct _ShellScreenshot
   GObject parent_instance;
 
   ShellGlobal *global;
+
+  ShellScreenshotFormat format;
+  int output_fd;
+
+  GSList *buffer_pool;
 };
 
 /* Used for async screenshot grabbing */
@@ -32,27 +55,111 @@ typedef struct _screenshot_data {
   ShellScreenshot  *screenshot;
 
   char *filename;
+  int output_fd;
+  ShellScreenshotFormat format;
 
-  cairo_surface_t *image;
   cairo_rectangle_int_t screenshot_area;
 
   gboolean include_cursor;
+  cairo_surface_t *cursor_surface;
+  int cursor_x;
+  int cursor_y;
+
+  /* Bands of the image (cairo surfaces, top to bottom) travelling from
+   * the grabbing code to the encoder thread, terminated by END_OF_BANDS.
+   */
+  GAsyncQueue *bands;
+  cairo_format_t image_format;
+
+  /* Bands read during the stage paint (PendingBand), top to bottom,
+   * and those of them still waiting in a pixel buffer, oldest first */
+  GQueue pending_bands;
+  GQueue buffered_bands;
+  cairo_region_t *blank_region;
+
+  gint64 grab_start;
+  gint64 grab_time;
+  gint64 blocked_time;
+  gint64 encode_time;
+  gint64 write_time;
 
   ShellScreenshotCallback callback;
 } _screenshot_data;
 
+typedef struct {
+  CoglPixelBuffer *buffer;
+  cairo_surface_t *band;    /* once copied out of @buffer */
+  cairo_rectangle_int_t area;
+  int stride;
+} PendingBand;
+
+static int end_of_bands;
+#define END_OF_BANDS ((gpointer) &end_of_bands)
+
 G_DEFINE_TYPE(ShellScreenshot, shell_screenshot, G_TYPE_OBJECT);
 
+static void pool_buffer_free (gpointer buffer);
+
+static void
+shell_screenshot_finalize (GObject *object)
+{
+  ShellScreenshot *screenshot = SHELL_SCREENSHOT (object);
+
+  g_slist_free_full (screenshot->buffer_pool, pool_buffer_free);
+
+  G_OBJECT_CLASS (shell_screenshot_parent_class)->finalize (object);
+}
+
 static void
 shell_screenshot_class_init (ShellScreenshotClass *screenshot_class)
 {
-  (void) screenshot_class;
+  GObjectClass *gobject_class = G_OBJECT_CLASS (screenshot_class);
+  ShellPerfLog *perf_log = shell_perf_log_get_default ();
+
+  gobject_class->finalize = shell_screenshot_finalize;
+
+  shell_perf_log_define_event (perf_log,
+                               "screenshot.grabTime",
+                               "Time spent reading back screenshot pixels (us)",
+                               "x");
+  shell_perf_log_define_event (perf_log,
+                               "screenshot.blockedTime",
+                               "Time the compositor spent on screenshot readback (us)",
+                               "x");
+  shell_perf_log_define_event (perf_log,
+                               "screenshot.encodeTime",
+                               "Time spent encoding a screenshot (us)",
+                               "x");
+  shell_perf_log_define_event (perf_log,
+                               "screenshot.writeTime",
+                               "Time spent writing out a screenshot (us)",
+                               "x");
 }
 
 static void
 shell_screenshot_init (ShellScreenshot *screenshot)
 {
   screenshot->global = shell_global_get ();
+  screenshot->format = SHELL_SCREENSHOT_FORMAT_PNG;
+  screenshot->output_fd = -1;
+}
+
+static _screenshot_data *
+screenshot_data_new (ShellScreenshot *screenshot,
+                     const char *filename,
+                     ShellScreenshotCallback callback)
+{
+  _screenshot_data *screenshot_data = g_new0 (_screenshot_data, 1);
+
+  screenshot_data->screenshot = g_object_ref (screenshot);
+  screenshot_data->filename = g_strdup (filename);
+  screenshot_data->output_fd = screenshot->output_fd;
+  screenshot_data->format = screenshot->format;
+  screenshot_data->callback = callback;
+  screenshot_data->bands = g_async_queue_new ();
+  screenshot_data->image_format = CAIRO_FORMAT_RGB24;
+
+  return screenshot_data;
 }
 
 static void
@@ -61,75 +168,460 @@ on_screenshot_written (GObject *source,
                        gpointer user_data)
 {
   _screenshot_data *screenshot_data = (_screenshot_data*) user_data;
+  ShellPerfLog *perf_log = shell_perf_log_get_default ();
+
+  shell_perf_log_event_x (perf_log, "screenshot.grabTime",
+                          screenshot_data->grab_time);
+  shell_perf_log_event_x (perf_log, "screenshot.blockedTime",
+                          screenshot_data->blocked_time);
+  shell_perf_log_event_x (perf_log, "screenshot.encodeTime",
+                          screenshot_data->encode_time);
+  shell_perf_log_event_x (perf_log, "screenshot.writeTime",
+                          screenshot_data->write_time);
+
   if (screenshot_data->callback)
     screenshot_data->callback (screenshot_data->screenshot,
                                g_simple_async_result_get_op_res_gboolean (G_SIMPLE_ASYNC_RESULT (result)),
                                &screenshot_data->screenshot_area);
 
-  cairo_surface_destroy (screenshot_data->image);
+  if (screenshot_data->blank_region)
+    cairo_region_destroy (screenshot_data->blank_region);
+  if (screenshot_data->cursor_surface)
+    cairo_surface_destroy (screenshot_data->cursor_surface);
+  g_async_queue_unref (screenshot_data->bands);
   g_object_unref (screenshot_data->screenshot);
   g_free (screenshot_data->filename);
   g_free (screenshot_data);
 }
 
+/* Encoder: runs in a thread, consuming bands as they are pushed */
+
+typedef struct {
+  _screenshot_data *screenshot_data;
+  GOutputStream *stream;
+  GError *error;
+  gboolean finished;
+} EncoderState;
+
+/* Blocks until the next band is available; returns NULL once the
+ * grabbing side signalled the end of the image.
+ */
+static cairo_surface_t *
+pop_band (EncoderState *state)
+{
+  gpointer band;
+
+  if (state->finished)
+    return NULL;
+
+  band = g_async_queue_pop (state->screenshot_data->bands);
+  if (band == END_OF_BANDS)
+    {
+      state->finished = TRUE;
+      return NULL;
+    }
+
+  return band;
+}
+
+static gboolean
+encoder_write (EncoderState *state,
+               const void   *data,
+               gsize         size)
+{
+  gint64 start;
+  gboolean ret;
+
+  if (state->error != NULL)
+    return FALSE;
+
+  start = g_get_monotonic_time ();
+  ret = g_output_stream_write_all (state->stream, data, size,
+                                   NULL, NULL, &state->error);
+  state->screenshot_data->write_time += g_get_monotonic_time () - start;
+
+  return ret;
+}
+
+static void
+png_write_cb (png_structp  png,
+              png_bytep    data,
+              png_size_t   size)
+{
+  EncoderState *state = png_get_io_ptr (png);
+
+  if (!encoder_write (state, data, size))
+    png_error (png, "write failed");
+}
+
+static void
+png_flush_cb (png_structp png)
+{
+}
+
+/* Converts a row of native-endian cairo pixels to the RGB or RGBA
+ * byte layout that PNG wants, unpremultiplying alpha if needed.
+ */
+static void
+convert_row (const guint32 *src,
+             guchar        *dst,
+             int            width,
+             gboolean       has_alpha)
+{
+  int i;
+
+  for (i = 0; i < width; i++)
+    {
+      guint32 pixel = src[i];
+      guint alpha = pixel >> 24;
+      guint red = (pixel >> 16) & 0xff;
+      guint green = (pixel >> 8) & 0xff;
+      guint blue = pixel & 0xff;
+
+      if (has_alpha)
+        {
+          if (alpha == 0)
+            {
+              red = green = blue = 0;
+            }
+          else if (alpha != 0xff)
+            {
+              red = (red * 255 + alpha / 2) / alpha;
+              green = (green * 255 + alpha / 2) / alpha;
+              blue = (blue * 255 + alpha / 2) / alpha;
+            }
+        }
+
+      *(dst++) = red;
+      *(dst++) = green;
+      *(dst++) = blue;
+      if (has_alpha)
+        *(dst++) = alpha;
+    }
+}
+
+static gboolean
+encode_png (EncoderState *state,
+            int           compression_level,
+            int           filter)
+{
+  _screenshot_data *screenshot_data = state->screenshot_data;
+  int width = screenshot_data->screenshot_area.width;
+  int height = screenshot_data->screenshot_area.height;
+  gboolean has_alpha = screenshot_data->image_format == CAIRO_FORMAT_ARGB32;
+  cairo_surface_t *volatile band = NULL;
+  png_structp png;
+  png_infop info;
+  guchar *row = NULL;
+  gboolean success = FALSE;
+  int rows_written = 0;
+
+  png = png_create_write_struct (PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  if (png == NULL)
+    return FALSE;
+
+  info = png_create_info_struct (png);
+  if (info == NULL)
+    {
+      png_destroy_write_struct (&png, NULL);
+      return FALSE;
+    }
+
+  row = g_malloc (width * (has_alpha ? 4 : 3));
+
+  if (setjmp (png_jmpbuf (png)))
+    goto out;
+
+  png_set_write_fn (png, state, png_write_cb, png_flush_cb);
+  png_set_compression_level (png, compression_level);
+  png_set_filter (png, PNG_FILTER_TYPE_BASE, filter);
+
+  png_set_IHDR (png, info, width, height, 8,
+                has_alpha ? PNG_COLOR_TYPE_RGB_ALPHA : PNG_COLOR_TYPE_RGB,
+                PNG_INTERLACE_NONE,
+                PNG_COMPRESSION_TYPE_DEFAULT,
+                PNG_FILTER_TYPE_DEFAULT);
+  png_write_info (png, info);
+
+  while (rows_written < height)
+    {
+      guchar *data;
+      int stride, band_height, i;
+      gint64 start, write_start;
+
+      band = pop_band (state);
+      if (band == NULL)
+        goto out;
+
+      start = g_get_monotonic_time ();
+      write_start = screenshot_data->write_time;
+
+      data = cairo_image_surface_get_data (band);
+      stride = cairo_image_surface_get_stride (band);
+      band_height = MIN (cairo_image_surface_get_height (band),
+                         height - rows_written);
+
+      for (i = 0; i < band_height; i++)
+        {
+          convert_row ((guint32 *) (data + i * stride), row, width, has_alpha);
+          png_write_row (png, row);
+        }
+
+      rows_written += band_height;
+      cairo_surface_destroy (band);
+      band = NULL;
+
+      /* png_write_row() flushes compressed data as it goes, so take
+       * the time spent writing out of the encoding time
+       */
+      screenshot_data->encode_time += g_get_monotonic_time () - start;
+      screenshot_data->encode_time -= screenshot_data->write_time - write_start;
+    }
+
+  png_write_end (png, NULL);
+  success = TRUE;
+
+ out:
+  if (band != NULL)
+    cairo_surface_destroy (band);
+
+  png_destroy_write_struct (&png, &info);
+  g_free (row);
+
+  return success;
+}
+
+static gboolean
+encode_raw (EncoderState *state)
+{
+  _screenshot_data *screenshot_data = state->screenshot_data;
+  int row_size = screenshot_data->screenshot_area.width * 4;
+  int rows_left = screenshot_data->screenshot_area.height;
+  cairo_surface_t *band;
+
+  while (rows_left > 0)
+    {
+      guchar *data;
+      int stride, band_height, i;
+      gboolean ok = TRUE;
+
+      band = pop_band (state);
+      if (band == NULL)
+        return FALSE;
+
+      data = cairo_image_surface_get_data (band);
+      stride = cairo_image_surface_get_stride (band);
+      band_height = MIN (cairo_image_surface_get_height (band), rows_left);
+
+      if (stride == row_size)
+        ok = encoder_write (state, data, row_size * band_height);
+      else
+        for (i = 0; i < band_height && ok; i++)
+          ok = encoder_write (state, data + i * stride, row_size);
+
+      rows_left -= band_height;
+      cairo_surface_destroy (band);
+
+      if (!ok)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static GOutputStream *
+open_output_stream (_screenshot_data *screenshot_data,
+                    GError          **error)
+{
+  GFile *file;
+  GOutputStream *stream;
+
+  if (screenshot_data->output_fd >= 0)
+    return g_unix_output_stream_new (screenshot_data->output_fd, FALSE);
+
+  file = g_file_new_for_path (screenshot_data->filename);
+  stream = G_OUTPUT_STREAM (g_file_replace (file, NULL, FALSE,
+                                            G_FILE_CREATE_NONE,
+                                            NULL, error));
+  g_object_unref (file);
+
+  return stream;
+}
+
 static void
 write_screenshot_thread (GSimpleAsyncResult *result,
                          GObject *object,
                          GCancellable *cancellable)
 {
-  cairo_status_t status;
+  EncoderState state = { NULL, };
+  gboolean success = FALSE;
+  cairo_surface_t *band;
   _screenshot_data *screenshot_data = g_async_result_get_user_data (G_ASYNC_RESULT (result));
   g_assert (screenshot_data != NULL);
 
-  status = cairo_surface_write_to_png (screenshot_data->image, screenshot_data->filename);
-  g_simple_async_result_set_op_res_gboolean (result, status == CAIRO_STATUS_SUCCESS);
+  state.screenshot_data = screenshot_data;
+  state.stream = open_output_stream (screenshot_data, &state.error);
+
+  if (state.stream != NULL)
+    {
+      switch (screenshot_data->format)
+        {
+        case SHELL_SCREENSHOT_FORMAT_PNG:
+          success = encode_png (&state, Z_DEFAULT_COMPRESSION, PNG_ALL_FILTERS);
+          break;
+        case SHELL_SCREENSHOT_FORMAT_PNG_FAST:
+          success = encode_png (&state, Z_BEST_SPEED, PNG_FILTER_SUB);
+          break;
+        case SHELL_SCREENSHOT_FORMAT_PNG_UNCOMPRESSED:
+          success = encode_png (&state, Z_NO_COMPRESSION, PNG_FILTER_NONE);
+          break;
+        case SHELL_SCREENSHOT_FORMAT_RAW:
+          success = encode_raw (&state);
+          break;
+        }
+
+      if (!g_output_stream_close (state.stream, NULL,
+                                  state.error ? NULL : &state.error))
+        success = FALSE;
+
+      g_object_unref (state.stream);
+    }
+
+  if (state.error != NULL)
+    {
+      g_warning ("Failed to write screenshot: %s", state.error->message);
+      g_error_free (state.error);
+    }
+
+  /* Drop whatever the encoder did not consume */
+  while ((band = pop_band (&state)) != NULL)
+    cairo_surface_destroy (band);
+
+  g_simple_async_result_set_op_res_gboolean (result, success);
 }
 
 static void
-do_grab_screenshot (_screenshot_data *screenshot_data,
-                    int               x,
-                    int               y,
-                    int               width,
-                    int               height)
+start_encoder (_screenshot_data *screenshot_data,
+               gpointer          source_tag)
 {
-  CoglBitmap *bitmap;
-  ClutterBackend *backend;
-  CoglContext *context;
-  int stride;
-  guchar *data;
-
-  backend = clutter_get_default_backend ();
-  context = clutter_backend_get_cogl_context (backend);
+  GSimpleAsyncResult *result;
 
-  screenshot_data->image = cairo_image_surface_create (CAIRO_FORMAT_RGB24,
-                                                       width, height);
+  result = g_simple_async_result_new (NULL, on_screenshot_written, (gpointer)screenshot_data, source_tag);
+  g_simple_async_result_run_in_thread (result, write_screenshot_thread, G_PRIORITY_DEFAULT, NULL);
+  g_object_unref (result);
+}
 
+static void
+push_band (_screenshot_data *screenshot_data,
+           cairo_surface_t  *band)
+{
+  g_async_queue_push (screenshot_data->bands, band);
+}
 
-  data = cairo_image_surface_get_data (screenshot_data->image);
-  stride = cairo_image_surface_get_stride (screenshot_data->image);
+static void
+finish_bands (_screenshot_data *screenshot_data)
+{
+  g_async_queue_push (screenshot_data->bands, END_OF_BANDS);
+}
 
-  bitmap = cogl_bitmap_new_for_data (context,
-                                     width,
-                                     height,
-                                     CLUTTER_CAIRO_FORMAT_ARGB32,
-                                     stride,
-                                     data);
+/* Starts an asynchronous read of @band_area into @buffer, or into a
+ * new pixel buffer object if it is %NULL; the data is fetched later,
+ * preferably in finish_grab_idle() after the stage paint is done, so
+ * the paint doesn't wait for the GPU. Takes ownership of @buffer.
+ */
+static PendingBand *
+start_band_read (CoglContext           *context,
+                 CoglPixelBuffer       *buffer,
+                 cairo_rectangle_int_t *band_area)
+{
+  PendingBand *pending;
+  CoglBitmap *bitmap;
+  int stride = band_area->width * 4;
+
+  /* Only buffers of full bands are reused, for the bands below them */
+  if (buffer == NULL)
+    buffer = cogl_pixel_buffer_new (context, stride * band_area->height, NULL);
+
+  pending = g_slice_new (PendingBand);
+  pending->area = *band_area;
+  pending->stride = stride;
+  pending->band = NULL;
+  pending->buffer = buffer;
+
+  bitmap = cogl_bitmap_new_from_buffer (COGL_BUFFER (pending->buffer),
+                                        CLUTTER_CAIRO_FORMAT_ARGB32,
+                                        band_area->width,
+                                        band_area->height,
+                                        stride,
+                                        0);
   cogl_framebuffer_read_pixels_into_bitmap (cogl_get_draw_framebuffer (),
-                                            x, y,
+                                            band_area->x, band_area->y,
                                             COGL_READ_PIXELS_COLOR_BUFFER,
                                             bitmap);
   cogl_object_unref (bitmap);
+
+  return pending;
+}
+
+/* Maps the pixel buffer of @pending and copies it out into a cairo
+ * surface. Mapping waits for the GPU if the read has not completed yet.
+ * Returns the pixel buffer, which @pending no longer holds.
+ */
+static CoglPixelBuffer *
+finish_band_read (PendingBand *pending)
+{
+  CoglPixelBuffer *buffer;
+  cairo_surface_t *band;
+  guchar *src, *dest;
+  int dest_stride, i;
+
+  band = cairo_image_surface_create (CAIRO_FORMAT_RGB24,
+                                     pending->area.width,
+                                     pending->area.height);
+  dest = cairo_image_surface_get_data (band);
+  dest_stride = cairo_image_surface_get_stride (band);
+
+  src = cogl_buffer_map (COGL_BUFFER (pending->buffer),
+                         COGL_BUFFER_ACCESS_READ, 0);
+
+  if (src != NULL)
+    {
+      for (i = 0; i < pending->area.height; i++)
+        memcpy (dest + i * dest_stride, src + i * pending->stride, pending->stride);
+
+      cogl_buffer_unmap (COGL_BUFFER (pending->buffer));
+    }
+  else
+    {
+      g_warning ("Failed to map screenshot pixel buffer");
+    }
+
+  cairo_surface_mark_dirty (band);
+
+  pending->band = band;
+  buffer = pending->buffer;
+  pending->buffer = NULL;
+
+  return buffer;
 }
 
 static void
-_draw_cursor_image (cairo_surface_t *surface,
-                    cairo_rectangle_int_t area)
+pending_band_free (PendingBand *pending)
+{
+  if (pending->buffer != NULL)
+    cogl_object_unref (pending->buffer);
+  if (pending->band != NULL)
+    cairo_surface_destroy (pending->band);
+  g_slice_free (PendingBand, pending);
+}
+
+static cairo_surface_t *
+_get_cursor_image (int *x,
+                   int *y)
 {
   XFixesCursorImage *cursor_image;
 
   cairo_surface_t *cursor_surface;
-  cairo_region_t *screenshot_region;
-  cairo_t *cr;
 
   guchar *data;
   int stride;
@@ -138,16 +630,7 @@ _draw_cursor_image (cairo_surface_t *surface,
   cursor_image = XFixesGetCursorImage (clutter_x11_get_default_display ());
 
   if (!cursor_image)
-    return;
-
-  screenshot_region = cairo_region_create_rectangle (&area);
-
-  if (!cairo_region_contains_point (screenshot_region, cursor_image->x, cursor_image->y))
-    {
-       XFree (cursor_image);
-       cairo_region_destroy (screenshot_region);
-       return;
-    }
+    return NULL;
 
   cursor_surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, cursor_image->width, cursor_image->height);
 
@@ -163,17 +646,165 @@ _draw_cursor_image (cairo_surface_t *surface,
 
   cairo_surface_mark_dirty (cursor_surface);
 
+  *x = cursor_image->x - cursor_image->xhot;
+  *y = cursor_image->y - cursor_image->yhot;
+
+  XFree (cursor_image);
+
+  return cursor_surface;
+}
+
+/* Paints the cursor onto @surface, which holds the contents of @area */
+static void
+_draw_cursor_image (cairo_surface_t      *surface,
+                    cairo_rectangle_int_t area,
+                    cairo_surface_t      *cursor_surface,
+                    int                   cursor_x,
+                    int                   cursor_y)
+{
+  cairo_rectangle_int_t cursor_rect;
+  cairo_region_t *screenshot_region;
+  cairo_t *cr;
+
+  cursor_rect.x = cursor_x;
+  cursor_rect.y = cursor_y;
+  cursor_rect.width = cairo_image_surface_get_width (cursor_surface);
+  cursor_rect.height = cairo_image_surface_get_height (cursor_surface);
+
+  screenshot_region = cairo_region_create_rectangle (&area);
+
+  if (cairo_region_contains_rectangle (screenshot_region, &cursor_rect) == CAIRO_REGION_OVERLAP_OUT)
+    {
+       cairo_region_destroy (screenshot_region);
+       return;
+    }
+
   cr = cairo_create (surface);
   cairo_set_source_surface (cr,
                             cursor_surface,
-                            cursor_image->x - cursor_image->xhot - area.x,
-                            cursor_image->y - cursor_image->yhot - area.y);
+                            cursor_x - area.x,
+                            cursor_y - area.y);
   cairo_paint (cr);
 
   cairo_destroy (cr);
-  cairo_surface_destroy (cursor_surface);
   cairo_region_destroy (screenshot_region);
-  XFree (cursor_image);
+}
+
+static void
+blank_band (cairo_surface_t       *band,
+            cairo_rectangle_int_t *band_area,
+            cairo_region_t        *blank_region)
+{
+  cairo_t *cr;
+  int i;
+
+  if (cairo_region_contains_rectangle (blank_region, band_area) == CAIRO_REGION_OVERLAP_OUT)
+    return;
+
+  cr = cairo_create (band);
+  cairo_translate (cr, -band_area->x, -band_area->y);
+
+  for (i = 0; i < cairo_region_num_rectangles (blank_region); i++)
+    {
+      cairo_rectangle_int_t rect;
+      cairo_region_get_rectangle (blank_region, i, &rect);
+      cairo_rectangle (cr, (double) rect.x, (double) rect.y, (double) rect.width, (double) rect.height);
+    }
+
+  cairo_fill (cr);
+  cairo_destroy (cr);
+}
+
+/* Hands the bands read during the stage paint to the encoder; all the
+ * time spent here, mapping, blanking and drawing the cursor, is added to
+ * @screenshot_data->blocked_time.
+ */
+static gboolean
+finish_grab_idle (gpointer user_data)
+{
+  _screenshot_data *screenshot_data = user_data;
+  PendingBand *pending;
+  gint64 start;
+
+  start = g_get_monotonic_time ();
+
+  /* The cursor is composited into the bands on the CPU, as for window
+   * screenshots; it is fetched here rather than from the paint handler
+   * so the X round trip doesn't hold up the frame.
+   */
+  if (screenshot_data->include_cursor)
+    screenshot_data->cursor_surface = _get_cursor_image (&screenshot_data->cursor_x,
+                                                         &screenshot_data->cursor_y);
+
+  while ((pending = g_queue_pop_head (&screenshot_data->pending_bands)) != NULL)
+    {
+      if (pending->band == NULL)
+        cogl_object_unref (finish_band_read (pending));
+
+      if (screenshot_data->blank_region != NULL)
+        blank_band (pending->band, &pending->area, screenshot_data->blank_region);
+
+      if (screenshot_data->cursor_surface != NULL)
+        _draw_cursor_image (pending->band, pending->area,
+                            screenshot_data->cursor_surface,
+                            screenshot_data->cursor_x,
+                            screenshot_data->cursor_y);
+
+      push_band (screenshot_data, pending->band);
+      pending->band = NULL;
+      pending_band_free (pending);
+    }
+
+  g_queue_clear (&screenshot_data->buffered_bands);
+
+  finish_bands (screenshot_data);
+
+  screenshot_data->blocked_time += g_get_monotonic_time () - start;
+  screenshot_data->grab_time = g_get_monotonic_time () - screenshot_data->grab_start;
+
+  return FALSE;
+}
+
+/* Queues reads of @screenshot_data->screenshot_area into pixel buffers,
+ * band by band; the bands are handed to the encoder from an idle once
+ * the stage paint is over. Only N_PIXEL_BUFFERS pixel buffers are used:
+ * on taller areas, the paint waits for the oldest read to complete to
+ * reuse its buffer. Areas of the stage in
+ * @screenshot_data->blank_region are painted black.
+ */
+static void
+do_grab_screenshot (_screenshot_data *screenshot_data)
+{
+  cairo_rectangle_int_t *area = &screenshot_data->screenshot_area;
+  CoglContext *context;
+  int band_y;
+
+  screenshot_data->grab_start = g_get_monotonic_time ();
+
+  context = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+
+  for (band_y = 0; band_y < area->height; band_y += BAND_HEIGHT)
+    {
+      cairo_rectangle_int_t band_area;
+      CoglPixelBuffer *buffer = NULL;
+      PendingBand *pending;
+
+      band_area.x = area->x;
+      band_area.y = area->y + band_y;
+      band_area.width = area->width;
+      band_area.height = MIN (BAND_HEIGHT, area->height - band_y);
+
+      if (screenshot_data->buffered_bands.length == N_PIXEL_BUFFERS)
+        buffer = finish_band_read (g_queue_pop_head (&screenshot_data->buffered_bands));
+
+      pending = start_band_read (context, buffer, &band_area);
+      g_queue_push_tail (&screenshot_data->pending_bands, pending);
+      g_queue_push_tail (&screenshot_data->buffered_bands, pending);
+    }
+
+  screenshot_data->blocked_time = g_get_monotonic_time () - screenshot_data->grab_start;
+
+  g_idle_add (finish_grab_idle, screenshot_data);
 }
 
 static void
@@ -182,20 +813,20 @@ grab_screenshot (ClutterActor *stage,
 {
   MetaScreen *screen = shell_global_get_screen (screenshot_data->screenshot->global);
   int width, height;
-  GSimpleAsyncResult *result;
 
   meta_screen_get_size (screen, &width, &height);
 
-  do_grab_screenshot (screenshot_data, 0, 0, width, height);
+  screenshot_data->screenshot_area.x = 0;
+  screenshot_data->screenshot_area.y = 0;
+  screenshot_data->screenshot_area.width = width;
+  screenshot_data->screenshot_area.height = height;
 
   if (meta_screen_get_n_monitors (screen) > 1)
     {
       cairo_region_t *screen_region = cairo_region_create ();
-      cairo_region_t *stage_region;
       MetaRectangle monitor_rect;
       cairo_rectangle_int_t stage_rect;
       int i;
-      cairo_t *cr;
 
       for (i = meta_screen_get_n_monitors (screen) - 1; i >= 0; i--)
         {
@@ -208,55 +839,62 @@ grab_screenshot (ClutterActor *stage,
       stage_rect.width = width;
       stage_rect.height = height;
 
-      stage_region = cairo_region_create_rectangle ((const cairo_rectangle_int_t *) &stage_rect);
-      cairo_region_xor (stage_region, screen_region);
+      screenshot_data->blank_region = cairo_region_create_rectangle ((const cairo_rectangle_int_t *) &stage_rect);
+      cairo_region_xor (screenshot_data->blank_region, screen_region);
       cairo_region_destroy (screen_region);
-
-      cr = cairo_create (screenshot_data->image);
-
-      for (i = 0; i < cairo_region_num_rectangles (stage_region); i++)
-        {
-          cairo_rectangle_int_t rect;
-          cairo_region_get_rectangle (stage_region, i, &rect);
-          cairo_rectangle (cr, (double) rect.x, (double) rect.y, (double) rect.width, (double) rect.height);
-          cairo_fill (cr);
-        }
-
-      cairo_destroy (cr);
-      cairo_region_destroy (stage_region);
     }
 
-  screenshot_data->screenshot_area.x = 0;
-  screenshot_data->screenshot_area.y = 0;
-  screenshot_data->screenshot_area.width = width;
-  screenshot_data->screenshot_area.height = height;
-
-  if (screenshot_data->include_cursor)
-    _draw_cursor_image (screenshot_data->image, screenshot_data->screenshot_area);
-
   g_signal_handlers_disconnect_by_func (stage, (void *)grab_screenshot, (gpointer)screenshot_data);
 
-  result = g_simple_async_result_new (NULL, on_screenshot_written, (gpointer)screenshot_data, grab_screenshot);
-  g_simple_async_result_run_in_thread (result, write_screenshot_thread, G_PRIORITY_DEFAULT, NULL);
-  g_object_unref (result);
+  start_encoder (screenshot_data, grab_screenshot);
+  do_grab_screenshot (screenshot_data);
 }
 
 static void
 grab_area_screenshot (ClutterActor *stage,
                       _screenshot_data *screenshot_data)
 {
-  GSimpleAsyncResult *result;
+  g_signal_handlers_disconnect_by_func (stage, (void *)grab_area_screenshot, (gpointer)screenshot_data);
 
-  do_grab_screenshot (screenshot_data,
-                      screenshot_data->screenshot_area.x,
-                      screenshot_data->screenshot_area.y,
-                      screenshot_data->screenshot_area.width,
-                      screenshot_data->screenshot_area.height);
+  start_encoder (screenshot_data, grab_area_screenshot);
+  do_grab_screenshot (screenshot_data);
+}
 
-  g_signal_handlers_disconnect_by_func (stage, (void *)grab_area_screenshot, (gpointer)screenshot_data);
-  result = g_simple_async_result_new (NULL, on_screenshot_written, (gpointer)screenshot_data, grab_area_screenshot);
-  g_simple_async_result_run_in_thread (result, write_screenshot_thread, G_PRIORITY_DEFAULT, NULL);
-  g_object_unref (result);
+/**
+ * shell_screenshot_set_format:
+ * @screenshot: the #ShellScreenshot
+ * @format: the #ShellScreenshotFormat to write screenshots in
+ *
+ * Sets the encoding used for subsequent screenshots taken with
+ * @screenshot. The default is %SHELL_SCREENSHOT_FORMAT_PNG.
+ */
+void
+shell_screenshot_set_format (ShellScreenshot       *screenshot,
+                             ShellScreenshotFormat  format)
+{
+  g_return_if_fail (SHELL_IS_SCREENSHOT (screenshot));
+
+  screenshot->format = format;
+}
+
+/**
+ * shell_screenshot_set_output_fd:
+ * @screenshot: the #ShellScreenshot
+ * @fd: a file descriptor open for writing, or -1
+ *
+ * Makes subsequent screenshots be written to @fd rather than to the
+ * filename passed when taking them. Together with
+ * %SHELL_SCREENSHOT_FORMAT_RAW and a shared memory file descriptor,
+ * this allows handing the pixels to the caller without any encoding.
+ * The file descriptor is not closed by @screenshot.
+ */
+void
+shell_screenshot_set_output_fd (ShellScreenshot *screenshot,
+                                int              fd)
+{
+  g_return_if_fail (SHELL_IS_SCREENSHOT (screenshot));
+
+  screenshot->output_fd = fd;
 }
 
 /**
@@ -278,11 +916,8 @@ shell_screenshot_screenshot (ShellScreenshot *screenshot,
                              ShellScreenshotCallback callback)
 {
   ClutterActor *stage;
-  _screenshot_data *data = g_new0 (_screenshot_data, 1);
+  _screenshot_data *data = screenshot_data_new (screenshot, filename, callback);
 
-  data->screenshot = g_object_ref (screenshot);
-  data->filename = g_strdup (filename);
-  data->callback = callback;
   data->include_cursor = include_cursor;
 
   stage = CLUTTER_ACTOR (shell_global_get_stage (screenshot->global));
@@ -317,15 +952,12 @@ shell_screenshot_screenshot_area (ShellScreenshot *screenshot,
                                   ShellScreenshotCallback callback)
 {
   ClutterActor *stage;
-  _screenshot_data *data = g_new0 (_screenshot_data, 1);
+  _screenshot_data *data = screenshot_data_new (screenshot, filename, callback);
 
-  data->screenshot = g_object_ref (screenshot);
-  data->filename = g_strdup (filename);
   data->screenshot_area.x = x;
   data->screenshot_area.y = y;
   data->screenshot_area.width = width;
   data->screenshot_area.height = height;
-  data->callback = callback;
 
   stage = CLUTTER_ACTOR (shell_global_get_stage (screenshot->global));
 
@@ -354,9 +986,7 @@ shell_screenshot_screenshot_window (ShellScreenshot *screenshot,
                                     const char *filename,
                                     ShellScreenshotCallback callback)
 {
-  GSimpleAsyncResult *result;
-
-  _screenshot_data *screenshot_data = g_new0 (_screenshot_data, 1);
+  _screenshot_data *screenshot_data = screenshot_data_new (screenshot, filename, callback);
 
   MetaScreen *screen = shell_global_get_screen (screenshot->global);
   MetaDisplay *display = meta_screen_get_display (screen);
@@ -366,10 +996,10 @@ shell_screenshot_screenshot_window (ShellScreenshot *screenshot,
   MetaShapedTexture *stex;
   MetaRectangle rect;
   cairo_rectangle_int_t clip;
+  cairo_surface_t *image;
+  gint64 start;
 
-  screenshot_data->screenshot = g_object_ref (screenshot);
-  screenshot_data->filename = g_strdup (filename);
-  screenshot_data->callback = callback;
+  start = g_get_monotonic_time ();
 
   window_actor = CLUTTER_ACTOR (meta_window_get_compositor_private (window));
   clutter_actor_get_position (window_actor, &actor_x, &actor_y);
@@ -399,14 +1029,323 @@ shell_screenshot_screenshot_window (ShellScreenshot *screenshot,
   clip.height = screenshot_data->screenshot_area.height = rect.height;
 
   stex = META_SHAPED_TEXTURE (meta_window_actor_get_texture (META_WINDOW_ACTOR (window_actor)));
-  screenshot_data->image = meta_shaped_texture_get_image (stex, &clip);
+  image = meta_shaped_texture_get_image (stex, &clip);
 
-  if (include_cursor)
-    _draw_cursor_image (screenshot_data->image, screenshot_data->screenshot_area);
+  if (include_cursor && image != NULL)
+    {
+      cairo_surface_t *cursor_surface;
+      int cursor_x, cursor_y;
 
-  result = g_simple_async_result_new (NULL, on_screenshot_written, (gpointer)screenshot_data, shell_screenshot_screenshot_window);
-  g_simple_async_result_run_in_thread (result, write_screenshot_thread, G_PRIORITY_DEFAULT, NULL);
-  g_object_unref (result);
+      cursor_surface = _get_cursor_image (&cursor_x, &cursor_y);
+      if (cursor_surface != NULL)
+        {
+          _draw_cursor_image (image, screenshot_data->screenshot_area,
+                              cursor_surface, cursor_x, cursor_y);
+          cairo_surface_destroy (cursor_surface);
+        }
+    }
+
+  /* The window image is already on the CPU, so it goes to the encoder
+   * as a single band.
+   */
+  if (image != NULL)
+    {
+      screenshot_data->image_format = cairo_image_surface_get_format (image);
+      push_band (screenshot_data, image);
+    }
+  finish_bands (screenshot_data);
+
+  screenshot_data->grab_time = g_get_monotonic_time () - start;
+
+  start_encoder (screenshot_data, shell_screenshot_screenshot_window);
+}
+
+/* Batched grabbing: several areas read back from a single redraw into
+ * one buffer, which is recycled through a small per-object pool once
+ * the batch and all the images pointing into it are gone.
+ */
+
+#define MAX_POOLED_BUFFERS 2
+
+typedef struct {
+  /* Set while the buffer is in use, to return it to the pool */
+  ShellScreenshot *screenshot;
+  guint ref_count;
+
+  guchar *data;
+  gsize size;
+} PoolBuffer;
+
+static cairo_user_data_key_t pool_buffer_key;
+
+typedef struct {
+  ShellScreenshot *screenshot;
+
+  GArray *areas;      /* cairo_rectangle_int_t */
+  PoolBuffer *buffer;
+  GList *images;
+
+  gboolean success;
+
+  ShellScreenshotBatchCallback callback;
+} _batch_data;
+
+static PoolBuffer *
+acquire_pool_buffer (ShellScreenshot *screenshot,
+                     gsize            size)
+{
+  PoolBuffer *buffer = NULL;
+  GSList *l;
+
+  /* Take the first pooled buffer that is large enough, or grow one */
+  for (l = screenshot->buffer_pool; l != NULL; l = l->next)
+    {
+      if (((PoolBuffer *) l->data)->size >= size)
+        break;
+    }
+
+  if (l == NULL)
+    l = screenshot->buffer_pool;
+
+  if (l != NULL)
+    {
+      buffer = l->data;
+      screenshot->buffer_pool = g_slist_delete_link (screenshot->buffer_pool, l);
+    }
+  else
+    {
+      buffer = g_slice_new0 (PoolBuffer);
+    }
+
+  if (buffer->size < size)
+    {
+      g_free (buffer->data);
+      buffer->data = g_malloc (size);
+      buffer->size = size;
+    }
+
+  buffer->screenshot = g_object_ref (screenshot);
+  buffer->ref_count = 1;
+
+  return buffer;
+}
+
+static void
+pool_buffer_free (gpointer data)
+{
+  PoolBuffer *buffer = data;
+
+  g_free (buffer->data);
+  g_slice_free (PoolBuffer, buffer);
+}
+
+static void
+release_pool_buffer (ShellScreenshot *screenshot,
+                     PoolBuffer      *buffer)
+{
+  if (g_slist_length (screenshot->buffer_pool) >= MAX_POOLED_BUFFERS)
+    pool_buffer_free (buffer);
+  else
+    screenshot->buffer_pool = g_slist_prepend (screenshot->buffer_pool, buffer);
+}
+
+static PoolBuffer *
+ref_pool_buffer (PoolBuffer *buffer)
+{
+  buffer->ref_count++;
+
+  return buffer;
+}
+
+static void
+unref_pool_buffer (gpointer data)
+{
+  PoolBuffer *buffer = data;
+  ShellScreenshot *screenshot;
+
+  if (--buffer->ref_count > 0)
+    return;
+
+  screenshot = buffer->screenshot;
+  buffer->screenshot = NULL;
+
+  release_pool_buffer (screenshot, buffer);
+  g_object_unref (screenshot);
+}
+
+static gboolean
+batch_complete_idle (gpointer user_data)
+{
+  _batch_data *batch_data = user_data;
+  ShellScreenshot *screenshot = batch_data->screenshot;
+
+  if (batch_data->callback)
+    batch_data->callback (screenshot,
+                          batch_data->success,
+                          batch_data->images);
+
+  g_list_free_full (batch_data->images, (GDestroyNotify) cairo_surface_destroy);
+
+  if (batch_data->buffer != NULL)
+    unref_pool_buffer (batch_data->buffer);
+
+  g_array_free (batch_data->areas, TRUE);
+  g_object_unref (screenshot);
+  g_slice_free (_batch_data, batch_data);
+
+  return FALSE;
+}
+
+static void
+grab_batch_screenshot (ClutterActor *stage,
+                       _batch_data  *batch_data)
+{
+  ClutterBackend *backend;
+  CoglContext *context;
+  gsize total_size = 0, offset = 0;
+  gint64 start;
+  guint i;
+
+  g_signal_handlers_disconnect_by_func (stage, (void *)grab_batch_screenshot, (gpointer)batch_data);
+
+  start = g_get_monotonic_time ();
+
+  backend = clutter_get_default_backend ();
+  context = clutter_backend_get_cogl_context (backend);
+
+  for (i = 0; i < batch_data->areas->len; i++)
+    {
+      cairo_rectangle_int_t *area = &g_array_index (batch_data->areas, cairo_rectangle_int_t, i);
+      total_size += (gsize) cairo_format_stride_for_width (CAIRO_FORMAT_RGB24, area->width) * area->height;
+    }
+
+  batch_data->buffer = acquire_pool_buffer (batch_data->screenshot, MAX (total_size, 1));
+
+  for (i = 0; i < batch_data->areas->len; i++)
+    {
+      cairo_rectangle_int_t *area = &g_array_index (batch_data->areas, cairo_rectangle_int_t, i);
+      cairo_surface_t *image;
+      int stride = cairo_format_stride_for_width (CAIRO_FORMAT_RGB24, area->width);
+      guchar *data = batch_data->buffer->data + offset;
+
+      if (area->width > 0 && area->height > 0)
+        {
+          CoglBitmap *bitmap;
+
+          bitmap = cogl_bitmap_new_for_data (context,
+                                             area->width,
+                                             area->height,
+                                             CLUTTER_CAIRO_FORMAT_ARGB32,
+                                             stride,
+                                             data);
+          cogl_framebuffer_read_pixels_into_bitmap (cogl_get_draw_framebuffer (),
+                                                    area->x, area->y,
+                                                    COGL_READ_PIXELS_COLOR_BUFFER,
+                                                    bitmap);
+          cogl_object_unref (bitmap);
+        }
+
+      image = cairo_image_surface_create_for_data (data, CAIRO_FORMAT_RGB24,
+                                                   area->width, area->height,
+                                                   stride);
+
+      /* The image may outlive the callback, so it keeps the buffer
+       * out of the pool until it is destroyed */
+      if (cairo_surface_set_user_data (image, &pool_buffer_key,
+                                       ref_pool_buffer (batch_data->buffer),
+                                       unref_pool_buffer) != CAIRO_STATUS_SUCCESS)
+        unref_pool_buffer (batch_data->buffer);
+      batch_data->images = g_list_prepend (batch_data->images, image);
+
+      offset += (gsize) stride * area->height;
+    }
+
+  batch_data->images = g_list_reverse (batch_data->images);
+  batch_data->success = TRUE;
+
+  shell_perf_log_event_x (shell_perf_log_get_default (),
+                          "screenshot.grabTime",
+                          g_get_monotonic_time () - start);
+
+  /* Don't run the callback from inside the paint */
+  g_idle_add (batch_complete_idle, batch_data);
+}
+
+static void
+add_batch_area (_batch_data *batch_data,
+                int          x,
+                int          y,
+                int          width,
+                int          height)
+{
+  MetaScreen *screen = shell_global_get_screen (batch_data->screenshot->global);
+  cairo_rectangle_int_t area;
+  int screen_width, screen_height;
+
+  meta_screen_get_size (screen, &screen_width, &screen_height);
+
+  /* Reading outside of the framebuffer is undefined, so clip */
+  area.x = CLAMP (x, 0, screen_width);
+  area.y = CLAMP (y, 0, screen_height);
+  area.width = MAX (0, MIN (x + width, screen_width) - area.x);
+  area.height = MAX (0, MIN (y + height, screen_height) - area.y);
+
+  g_array_append_val (batch_data->areas, area);
+}
+
+/**
+ * shell_screenshot_screenshot_areas:
+ * @screenshot: the #ShellScreenshot
+ * @coords: (array length=n_coords): x, y, width and height of each
+ *   area to grab, one after another
+ * @n_coords: number of elements in @coords; a multiple of 4
+ * @windows: (element-type Meta.Window): windows to grab, as they
+ *   currently appear on the stage
+ * @callback: (scope async): function to call with the grabbed images
+ *
+ * Grabs all of the passed in areas and windows from a single stage
+ * redraw. The images are passed to @callback in the order in which
+ * they were requested, areas first; areas are clipped to the screen.
+ * The pixel data of all images shares one buffer, which is recycled
+ * once all of them have been destroyed.
+ */
+void
+shell_screenshot_screenshot_areas (ShellScreenshot *screenshot,
+                                   const int *coords,
+                                   int n_coords,
+                                   GList *windows,
+                                   ShellScreenshotBatchCallback callback)
+{
+  ClutterActor *stage;
+  _batch_data *batch_data;
+  GList *l;
+  int i;
+
+  g_return_if_fail (SHELL_IS_SCREENSHOT (screenshot));
+  g_return_if_fail (n_coords % 4 == 0);
+
+  batch_data = g_slice_new0 (_batch_data);
+  batch_data->screenshot = g_object_ref (screenshot);
+  batch_data->callback = callback;
+  batch_data->areas = g_array_new (FALSE, FALSE, sizeof (cairo_rectangle_int_t));
+
+  for (i = 0; i < n_coords; i += 4)
+    add_batch_area (batch_data,
+                    coords[i], coords[i + 1], coords[i + 2], coords[i + 3]);
+
+  for (l = windows; l != NULL; l = l->next)
+    {
+      MetaRectangle rect;
+
+      meta_window_get_outer_rect (l->data, &rect);
+      add_batch_area (batch_data, rect.x, rect.y, rect.width, rect.height);
+    }
+
+  stage = CLUTTER_ACTOR (shell_global_get_stage (screenshot->global));
+
+  g_signal_connect_after (stage, "paint", G_CALLBACK (grab_batch_screenshot), (gpointer)batch_data);
+
+  clutter_actor_queue_redraw (stage);
 }
 
 ShellScreenshot *
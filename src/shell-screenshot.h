@@ -9,6 +9,9 @@
  * The #ShellScreenshot object is used to take screenshots of screen
  * areas or windows and write them out as png files.
  *
+ * Pixels are read back and encoded in bands, so encoding in a
+ * separate thread starts while the rest of the image is still being
+ * copied. The encoding can be chosen with shell_screenshot_set_format().
  */
 
 typedef struct _ShellScreenshot      ShellScreenshot;
@@ -21,14 +24,52 @@ typedef struct _ShellScreenshotClass ShellScreenshotClass;
 #define SHELL_IS_SCREENSHOT_CLASS(klass)   (G_TYPE_CHECK_CLASS_TYPE ((klass), SHELL_TYPE_SCREENSHOT))
 #define SHELL_SCREENSHOT_GET_CLASS(obj)    (G_TYPE_INSTANCE_GET_CLASS ((obj), SHELL_TYPE_SCREENSHOT, ShellScreenshotClass))
 
+/**
+ * ShellScreenshotFormat:
+ * @SHELL_SCREENSHOT_FORMAT_PNG: PNG with the default zlib compression
+ * @SHELL_SCREENSHOT_FORMAT_PNG_FAST: PNG using the fastest deflate level
+ * @SHELL_SCREENSHOT_FORMAT_PNG_UNCOMPRESSED: PNG with stored, uncompressed data
+ * @SHELL_SCREENSHOT_FORMAT_RAW: native-endian 32-bit xRGB pixels, rows
+ *   of width * 4 bytes without any header
+ *
+ * Encodings in which a #ShellScreenshot can write its output.
+ */
+typedef enum {
+  SHELL_SCREENSHOT_FORMAT_PNG,
+  SHELL_SCREENSHOT_FORMAT_PNG_FAST,
+  SHELL_SCREENSHOT_FORMAT_PNG_UNCOMPRESSED,
+  SHELL_SCREENSHOT_FORMAT_RAW
+} ShellScreenshotFormat;
+
 GType shell_screenshot_get_type (void) G_GNUC_CONST;
 
 ShellScreenshot *shell_screenshot_new (void);
 
+void    shell_screenshot_set_format           (ShellScreenshot       *screenshot,
+                                                ShellScreenshotFormat  format);
+void    shell_screenshot_set_output_fd        (ShellScreenshot       *screenshot,
+                                                int                    fd);
+
 typedef void (*ShellScreenshotCallback)  (ShellScreenshot *screenshot,
                                            gboolean success,
                                            cairo_rectangle_int_t *screenshot_area);
 
+/**
+ * ShellScreenshotBatchCallback:
+ * @screenshot: the #ShellScreenshot
+ * @success: whether the areas could be grabbed
+ * @images: (element-type cairo.Surface): the grabbed images
+ */
+typedef void (*ShellScreenshotBatchCallback) (ShellScreenshot *screenshot,
+                                              gboolean success,
+                                              GList *images);
+
+void    shell_screenshot_screenshot_areas     (ShellScreenshot *screenshot,
+                                                const int *coords,
+                                                int n_coords,
+                                                GList *windows,
+                                                ShellScreenshotBatchCallback callback);
+
 void    shell_screenshot_screenshot_area      (ShellScreenshot *screenshot,
                                                 int x,
                                                 int y,
@@ -0,0 +1,262 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * SECTION:shell-snapshot-effect
+ * @short_description: Paints an actor from a cached, throttled snapshot
+ * @see_also: #ClutterOffscreenEffect
+ *
+ * #ShellSnapshotEffect renders its actor into an offscreen texture and
+ * paints that texture until the contents of the actor change. When they
+ * do, the texture is rendered again, but at most once per
+ * #ShellSnapshotEffect:interval milliseconds; damage arriving sooner
+ * keeps showing the previous snapshot and is picked up once the interval
+ * has passed. Changes to the transformation of the actor, such as
+ * during a scale animation, are always rendered right away.
+ *
+ * This is meant for small previews of many windows, like the workspace
+ * thumbnails in the overview, where showing every frame of every window
+ * is not worth repainting all of them each time one changes.
+ */
+
+#include "config.h"
+
+#include "shell-snapshot-effect.h"
+
+#define DEFAULT_INTERVAL 100
+
+struct _ShellSnapshotEffect
+{
+  ClutterOffscreenEffect parent_instance;
+
+  guint interval;
+
+  gint64 last_update_time;
+  guint update_timeout_id;
+};
+
+struct _ShellSnapshotEffectClass
+{
+  ClutterOffscreenEffectClass parent_class;
+};
+
+enum {
+  PROP_0,
+
+  PROP_INTERVAL
+};
+
+G_DEFINE_TYPE (ShellSnapshotEffect,
+               shell_snapshot_effect,
+               CLUTTER_TYPE_OFFSCREEN_EFFECT);
+
+static gboolean
+update_timeout (gpointer data)
+{
+  ShellSnapshotEffect *self = data;
+  ClutterActor *actor;
+
+  self->update_timeout_id = 0;
+
+  /* Make the damage we skipped count again; this marks the actor dirty
+   * so the next paint renders a new snapshot */
+  actor = clutter_actor_meta_get_actor (CLUTTER_ACTOR_META (self));
+  if (actor != NULL)
+    clutter_actor_queue_redraw (actor);
+
+  return FALSE;
+}
+
+static void
+shell_snapshot_effect_paint (ClutterEffect           *effect,
+                             ClutterEffectPaintFlags  flags)
+{
+  ShellSnapshotEffect *self = SHELL_SNAPSHOT_EFFECT (effect);
+  gint64 now = g_get_monotonic_time ();
+
+  if (flags & CLUTTER_EFFECT_PAINT_ACTOR_DIRTY)
+    {
+      gint64 next_update_time = self->last_update_time + self->interval * 1000;
+
+      if (now < next_update_time)
+        {
+          /* Too soon; paint the previous snapshot. ClutterOffscreenEffect
+           * still renders the actor if there is none yet, or if the
+           * transformation of the actor changed. */
+          flags &= ~CLUTTER_EFFECT_PAINT_ACTOR_DIRTY;
+
+          if (self->update_timeout_id == 0)
+            self->update_timeout_id =
+              g_timeout_add (MAX ((next_update_time - now) / 1000, 1),
+                             update_timeout, self);
+        }
+    }
+
+  CLUTTER_EFFECT_CLASS (shell_snapshot_effect_parent_class)->paint (effect, flags);
+}
+
+/* Only called when the snapshot is actually rendered again, whether
+ * because of damage or because the transformation of the actor changed */
+static gboolean
+shell_snapshot_effect_pre_paint (ClutterEffect *effect)
+{
+  ShellSnapshotEffect *self = SHELL_SNAPSHOT_EFFECT (effect);
+
+  if (!CLUTTER_EFFECT_CLASS (shell_snapshot_effect_parent_class)->pre_paint (effect))
+    return FALSE;
+
+  self->last_update_time = g_get_monotonic_time ();
+
+  return TRUE;
+}
+
+static void
+shell_snapshot_effect_set_actor (ClutterActorMeta *meta,
+                                 ClutterActor     *actor)
+{
+  ShellSnapshotEffect *self = SHELL_SNAPSHOT_EFFECT (meta);
+
+  if (self->update_timeout_id != 0)
+    {
+      g_source_remove (self->update_timeout_id);
+      self->update_timeout_id = 0;
+    }
+  self->last_update_time = 0;
+
+  CLUTTER_ACTOR_META_CLASS (shell_snapshot_effect_parent_class)->set_actor (meta, actor);
+}
+
+static void
+shell_snapshot_effect_dispose (GObject *gobject)
+{
+  ShellSnapshotEffect *self = SHELL_SNAPSHOT_EFFECT (gobject);
+
+  if (self->update_timeout_id != 0)
+    {
+      g_source_remove (self->update_timeout_id);
+      self->update_timeout_id = 0;
+    }
+
+  G_OBJECT_CLASS (shell_snapshot_effect_parent_class)->dispose (gobject);
+}
+
+static void
+shell_snapshot_effect_set_property (GObject      *gobject,
+                                    guint         prop_id,
+                                    const GValue *value,
+                                    GParamSpec   *pspec)
+{
+  ShellSnapshotEffect *self = SHELL_SNAPSHOT_EFFECT (gobject);
+
+  switch (prop_id)
+    {
+    case PROP_INTERVAL:
+      shell_snapshot_effect_set_interval (self, g_value_get_uint (value));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+shell_snapshot_effect_get_property (GObject    *gobject,
+                                    guint       prop_id,
+                                    GValue     *value,
+                                    GParamSpec *pspec)
+{
+  ShellSnapshotEffect *self = SHELL_SNAPSHOT_EFFECT (gobject);
+
+  switch (prop_id)
+    {
+    case PROP_INTERVAL:
+      g_value_set_uint (value, self->interval);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+shell_snapshot_effect_class_init (ShellSnapshotEffectClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  ClutterActorMetaClass *meta_class = CLUTTER_ACTOR_META_CLASS (klass);
+  ClutterEffectClass *effect_class = CLUTTER_EFFECT_CLASS (klass);
+
+  gobject_class->dispose = shell_snapshot_effect_dispose;
+  gobject_class->set_property = shell_snapshot_effect_set_property;
+  gobject_class->get_property = shell_snapshot_effect_get_property;
+
+  meta_class->set_actor = shell_snapshot_effect_set_actor;
+
+  effect_class->pre_paint = shell_snapshot_effect_pre_paint;
+  effect_class->paint = shell_snapshot_effect_paint;
+
+  /**
+   * ShellSnapshotEffect:interval:
+   *
+   * The minimum time between two snapshots, in milliseconds.
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_INTERVAL,
+                                   g_param_spec_uint ("interval",
+                                                      "Interval",
+                                                      "Minimum time between snapshots, in milliseconds",
+                                                      0, G_MAXUINT, DEFAULT_INTERVAL,
+                                                      G_PARAM_READWRITE));
+}
+
+static void
+shell_snapshot_effect_init (ShellSnapshotEffect *self)
+{
+  self->interval = DEFAULT_INTERVAL;
+}
+
+/**
+ * shell_snapshot_effect_new:
+ * @interval: minimum time between snapshots, in milliseconds
+ *
+ * Creates a new #ShellSnapshotEffect to be used with
+ * clutter_actor_add_effect()
+ *
+ * Return value: (transfer full): the newly created #ShellSnapshotEffect
+ */
+ClutterEffect *
+shell_snapshot_effect_new (guint interval)
+{
+  return g_object_new (SHELL_TYPE_SNAPSHOT_EFFECT,
+                       "interval", interval,
+                       NULL);
+}
+
+guint
+shell_snapshot_effect_get_interval (ShellSnapshotEffect *effect)
+{
+  g_return_val_if_fail (SHELL_IS_SNAPSHOT_EFFECT (effect), 0);
+
+  return effect->interval;
+}
+
+/**
+ * shell_snapshot_effect_set_interval:
+ * @effect: a #ShellSnapshotEffect
+ * @interval: minimum time between snapshots, in milliseconds
+ *
+ * Sets how often the snapshot may be rendered again while the actor
+ * keeps changing. An interval of 0 renders every change right away.
+ */
+void
+shell_snapshot_effect_set_interval (ShellSnapshotEffect *effect,
+                                    guint                interval)
+{
+  g_return_if_fail (SHELL_IS_SNAPSHOT_EFFECT (effect));
+
+  if (effect->interval == interval)
+    return;
+
+  effect->interval = interval;
+  g_object_notify (G_OBJECT (effect), "interval");
+}
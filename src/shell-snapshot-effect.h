@@ -0,0 +1,26 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+#ifndef __SHELL_SNAPSHOT_EFFECT_H__
+#define __SHELL_SNAPSHOT_EFFECT_H__
+
+#include <clutter/clutter.h>
+
+G_BEGIN_DECLS
+
+#define SHELL_TYPE_SNAPSHOT_EFFECT        (shell_snapshot_effect_get_type ())
+#define SHELL_SNAPSHOT_EFFECT(obj)        (G_TYPE_CHECK_INSTANCE_CAST ((obj), SHELL_TYPE_SNAPSHOT_EFFECT, ShellSnapshotEffect))
+#define SHELL_IS_SNAPSHOT_EFFECT(obj)     (G_TYPE_CHECK_INSTANCE_TYPE ((obj), SHELL_TYPE_SNAPSHOT_EFFECT))
+
+typedef struct _ShellSnapshotEffect        ShellSnapshotEffect;
+typedef struct _ShellSnapshotEffectClass   ShellSnapshotEffectClass;
+
+GType shell_snapshot_effect_get_type (void) G_GNUC_CONST;
+
+ClutterEffect *shell_snapshot_effect_new (guint interval);
+
+guint          shell_snapshot_effect_get_interval (ShellSnapshotEffect *effect);
+void           shell_snapshot_effect_set_interval (ShellSnapshotEffect *effect,
+                                                   guint                interval);
+
+G_END_DECLS
+
+#endif /* __SHELL_SNAPSHOT_EFFECT_H__ */
@@ -0,0 +1,1152 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+#include "config.h"
+
+#include <math.h>
+
+#include <clutter/clutter.h>
+#include <st.h>
+
+#include "shell-global.h"
+#include "shell-tween-engine.h"
+
+typedef double (*EaseFunc) (double t);
+
+typedef struct {
+  GParamSpec *pspec;
+  double start;
+  double end;
+} TweenProperty;
+
+typedef struct {
+  guint id;
+  GObject *target;
+
+  /* Times in microseconds on the engine's clock; start_time is -1 until
+   * the first frame after the tween was added. */
+  gint64 delay;
+  gint64 duration;
+  gint64 start_time;
+  gint64 paused_time;
+
+  EaseFunc ease;
+  guint rounded : 1;
+  guint started : 1;
+  guint paused : 1;
+  guint removed : 1;
+
+  TweenProperty *properties;
+  int n_properties;
+
+  ShellTweenFunc on_start;
+  gpointer start_data;
+  GDestroyNotify start_notify;
+  ShellTweenFunc on_complete;
+  gpointer complete_data;
+  GDestroyNotify complete_notify;
+} Tween;
+
+struct _ShellTweenEngineClass
+{
+  GObjectClass parent_class;
+};
+
+struct _ShellTweenEngine
+{
+  GObject parent_instance;
+
+  /* Tween *, in the order they were added */
+  GQueue tweens;
+  guint last_id;
+
+  /* GObject * => number of tweens on it, including removed ones that
+   * haven't been freed yet; we hold a weak reference while non-zero */
+  GHashTable *targets;
+
+  ClutterTimeline *timeline;
+  gint64 clock_start;
+  gint64 current_time;
+
+  /* While updating, removed tweens are only marked and freed afterwards */
+  gboolean in_update;
+  gboolean have_removed;
+};
+
+G_DEFINE_TYPE (ShellTweenEngine, shell_tween_engine, G_TYPE_OBJECT);
+
+static void on_target_finalized (gpointer  data,
+                                 GObject  *where_the_object_was);
+
+/* Easing equations, after Robert Penner's as used by Tweener, for a
+ * progress @t from 0 to 1 */
+
+static double
+ease_linear (double t)
+{
+  return t;
+}
+
+static double
+ease_in_quad (double t)
+{
+  return t * t;
+}
+
+static double
+ease_out_quad (double t)
+{
+  return - t * (t - 2);
+}
+
+static double
+ease_in_out_quad (double t)
+{
+  t *= 2;
+  if (t < 1)
+    return t * t / 2;
+  t -= 1;
+  return - (t * (t - 2) - 1) / 2;
+}
+
+static double
+ease_in_cubic (double t)
+{
+  return t * t * t;
+}
+
+static double
+ease_out_cubic (double t)
+{
+  t -= 1;
+  return t * t * t + 1;
+}
+
+static double
+ease_in_out_cubic (double t)
+{
+  t *= 2;
+  if (t < 1)
+    return t * t * t / 2;
+  t -= 2;
+  return (t * t * t + 2) / 2;
+}
+
+static double
+ease_in_quart (double t)
+{
+  return t * t * t * t;
+}
+
+static double
+ease_out_quart (double t)
+{
+  t -= 1;
+  return - (t * t * t * t - 1);
+}
+
+static double
+ease_in_out_quart (double t)
+{
+  t *= 2;
+  if (t < 1)
+    return t * t * t * t / 2;
+  t -= 2;
+  return - (t * t * t * t - 2) / 2;
+}
+
+static double
+ease_in_quint (double t)
+{
+  return t * t * t * t * t;
+}
+
+static double
+ease_out_quint (double t)
+{
+  t -= 1;
+  return t * t * t * t * t + 1;
+}
+
+static double
+ease_in_out_quint (double t)
+{
+  t *= 2;
+  if (t < 1)
+    return t * t * t * t * t / 2;
+  t -= 2;
+  return (t * t * t * t * t + 2) / 2;
+}
+
+static double
+ease_in_sine (double t)
+{
+  return - cos (t * G_PI / 2) + 1;
+}
+
+static double
+ease_out_sine (double t)
+{
+  return sin (t * G_PI / 2);
+}
+
+static double
+ease_in_out_sine (double t)
+{
+  return - (cos (G_PI * t) - 1) / 2;
+}
+
+static double
+ease_in_expo (double t)
+{
+  return t == 0 ? 0 : pow (2, 10 * (t - 1)) - 0.001;
+}
+
+static double
+ease_out_expo (double t)
+{
+  return t == 1 ? 1 : 1.001 * (- pow (2, -10 * t) + 1);
+}
+
+static double
+ease_in_out_expo (double t)
+{
+  if (t == 0)
+    return 0;
+  if (t == 1)
+    return 1;
+  t *= 2;
+  if (t < 1)
+    return pow (2, 10 * (t - 1)) / 2 - 0.0005;
+  return 1.0005 * (- pow (2, -10 * (t - 1)) + 2) / 2;
+}
+
+static double
+ease_in_circ (double t)
+{
+  return - (sqrt (1 - t * t) - 1);
+}
+
+static double
+ease_out_circ (double t)
+{
+  t -= 1;
+  return sqrt (1 - t * t);
+}
+
+static double
+ease_in_out_circ (double t)
+{
+  t *= 2;
+  if (t < 1)
+    return - (sqrt (1 - t * t) - 1) / 2;
+  t -= 2;
+  return (sqrt (1 - t * t) + 1) / 2;
+}
+
+static double
+ease_in_elastic (double t)
+{
+  double p = 0.3, s = p / 4;
+
+  if (t == 0 || t == 1)
+    return t;
+  t -= 1;
+  return - (pow (2, 10 * t) * sin ((t - s) * (2 * G_PI) / p));
+}
+
+static double
+ease_out_elastic (double t)
+{
+  double p = 0.3, s = p / 4;
+
+  if (t == 0 || t == 1)
+    return t;
+  return pow (2, -10 * t) * sin ((t - s) * (2 * G_PI) / p) + 1;
+}
+
+static double
+ease_in_out_elastic (double t)
+{
+  double p = 0.3 * 1.5, s = p / 4;
+
+  if (t == 0 || t == 1)
+    return t;
+  t = t * 2 - 1;
+  if (t < 0)
+    return - 0.5 * (pow (2, 10 * t) * sin ((t - s) * (2 * G_PI) / p));
+  return pow (2, -10 * t) * sin ((t - s) * (2 * G_PI) / p) * 0.5 + 1;
+}
+
+static double
+ease_in_back (double t)
+{
+  double s = 1.70158;
+
+  return t * t * ((s + 1) * t - s);
+}
+
+static double
+ease_out_back (double t)
+{
+  double s = 1.70158;
+
+  t -= 1;
+  return t * t * ((s + 1) * t + s) + 1;
+}
+
+static double
+ease_in_out_back (double t)
+{
+  double s = 1.70158 * 1.525;
+
+  t *= 2;
+  if (t < 1)
+    return t * t * ((s + 1) * t - s) / 2;
+  t -= 2;
+  return (t * t * ((s + 1) * t + s) + 2) / 2;
+}
+
+static double
+ease_out_bounce (double t)
+{
+  if (t < 1 / 2.75)
+    return 7.5625 * t * t;
+
+  if (t < 2 / 2.75)
+    {
+      t -= 1.5 / 2.75;
+      return 7.5625 * t * t + 0.75;
+    }
+
+  if (t < 2.5 / 2.75)
+    {
+      t -= 2.25 / 2.75;
+      return 7.5625 * t * t + 0.9375;
+    }
+
+  t -= 2.625 / 2.75;
+  return 7.5625 * t * t + 0.984375;
+}
+
+static double
+ease_in_bounce (double t)
+{
+  return 1 - ease_out_bounce (1 - t);
+}
+
+static double
+ease_in_out_bounce (double t)
+{
+  if (t < 0.5)
+    return ease_in_bounce (t * 2) / 2;
+  return ease_out_bounce (t * 2 - 1) / 2 + 0.5;
+}
+
+/* The easeOutIn* variants are the same for all equations */
+#define DEFINE_EASE_OUT_IN(name)                        \
+static double                                           \
+ease_out_in_##name (double t)                           \
+{                                                       \
+  if (t < 0.5)                                          \
+    return ease_out_##name (t * 2) / 2;                 \
+  return ease_in_##name (t * 2 - 1) / 2 + 0.5;          \
+}
+
+DEFINE_EASE_OUT_IN (quad)
+DEFINE_EASE_OUT_IN (cubic)
+DEFINE_EASE_OUT_IN (quart)
+DEFINE_EASE_OUT_IN (quint)
+DEFINE_EASE_OUT_IN (sine)
+DEFINE_EASE_OUT_IN (expo)
+DEFINE_EASE_OUT_IN (circ)
+DEFINE_EASE_OUT_IN (elastic)
+DEFINE_EASE_OUT_IN (back)
+DEFINE_EASE_OUT_IN (bounce)
+
+#define EASE_FAMILY(Name, name)                         \
+  { "easeIn" Name, ease_in_##name },                    \
+  { "easeOut" Name, ease_out_##name },                  \
+  { "easeInOut" Name, ease_in_out_##name },             \
+  { "easeOutIn" Name, ease_out_in_##name }
+
+static const struct {
+  const char *name;
+  EaseFunc func;
+} transitions[] = {
+  { "linear", ease_linear },
+  EASE_FAMILY ("Quad", quad),
+  EASE_FAMILY ("Cubic", cubic),
+  EASE_FAMILY ("Quart", quart),
+  EASE_FAMILY ("Quint", quint),
+  EASE_FAMILY ("Sine", sine),
+  EASE_FAMILY ("Expo", expo),
+  EASE_FAMILY ("Circ", circ),
+  EASE_FAMILY ("Elastic", elastic),
+  EASE_FAMILY ("Back", back),
+  EASE_FAMILY ("Bounce", bounce),
+};
+
+static EaseFunc
+lookup_transition (const char *name)
+{
+  guint i;
+
+  /* Tweener also accepts the names in lower case */
+  for (i = 0; i < G_N_ELEMENTS (transitions); i++)
+    if (g_ascii_strcasecmp (transitions[i].name, name) == 0)
+      return transitions[i].func;
+
+  return NULL;
+}
+
+static gboolean
+is_animatable (GParamSpec *pspec)
+{
+  if ((pspec->flags & G_PARAM_READWRITE) != G_PARAM_READWRITE ||
+      (pspec->flags & G_PARAM_CONSTRUCT_ONLY) != 0)
+    return FALSE;
+
+  switch (G_TYPE_FUNDAMENTAL (pspec->value_type))
+    {
+    case G_TYPE_DOUBLE:
+    case G_TYPE_FLOAT:
+    case G_TYPE_INT:
+    case G_TYPE_UINT:
+    case G_TYPE_UCHAR:
+      return TRUE;
+    default:
+      return FALSE;
+    }
+}
+
+static double
+get_property (GObject    *target,
+              GParamSpec *pspec)
+{
+  GValue value = G_VALUE_INIT;
+  double result = 0;
+
+  g_value_init (&value, pspec->value_type);
+  g_object_get_property (target, pspec->name, &value);
+
+  switch (G_TYPE_FUNDAMENTAL (pspec->value_type))
+    {
+    case G_TYPE_DOUBLE:
+      result = g_value_get_double (&value);
+      break;
+    case G_TYPE_FLOAT:
+      result = g_value_get_float (&value);
+      break;
+    case G_TYPE_INT:
+      result = g_value_get_int (&value);
+      break;
+    case G_TYPE_UINT:
+      result = g_value_get_uint (&value);
+      break;
+    case G_TYPE_UCHAR:
+      result = g_value_get_uchar (&value);
+      break;
+    default:
+      g_assert_not_reached ();
+    }
+
+  g_value_unset (&value);
+
+  return result;
+}
+
+/* Integer properties are truncated and clamped to the range of the
+ * property type, as when JavaScript sets them */
+static void
+set_property (GObject    *target,
+              GParamSpec *pspec,
+              double      v)
+{
+  GValue value = G_VALUE_INIT;
+
+  g_value_init (&value, pspec->value_type);
+
+  switch (G_TYPE_FUNDAMENTAL (pspec->value_type))
+    {
+    case G_TYPE_DOUBLE:
+      g_value_set_double (&value, v);
+      break;
+    case G_TYPE_FLOAT:
+      g_value_set_float (&value, v);
+      break;
+    case G_TYPE_INT:
+      g_value_set_int (&value, CLAMP (v, G_MININT, G_MAXINT));
+      break;
+    case G_TYPE_UINT:
+      g_value_set_uint (&value, CLAMP (v, 0, G_MAXUINT));
+      break;
+    case G_TYPE_UCHAR:
+      g_value_set_uchar (&value, CLAMP (v, 0, G_MAXUINT8));
+      break;
+    default:
+      g_assert_not_reached ();
+    }
+
+  g_object_set_property (target, pspec->name, &value);
+  g_value_unset (&value);
+}
+
+static void
+ref_target (ShellTweenEngine *engine,
+            GObject          *target)
+{
+  guint count = GPOINTER_TO_UINT (g_hash_table_lookup (engine->targets, target));
+
+  if (count == 0)
+    g_object_weak_ref (target, on_target_finalized, engine);
+
+  g_hash_table_insert (engine->targets, target, GUINT_TO_POINTER (count + 1));
+}
+
+static void
+unref_target (ShellTweenEngine *engine,
+              GObject          *target)
+{
+  guint count = GPOINTER_TO_UINT (g_hash_table_lookup (engine->targets, target));
+
+  if (count == 1)
+    {
+      g_object_weak_unref (target, on_target_finalized, engine);
+      g_hash_table_remove (engine->targets, target);
+    }
+  else
+    g_hash_table_insert (engine->targets, target, GUINT_TO_POINTER (count - 1));
+}
+
+static void
+tween_free (Tween *tween)
+{
+  if (tween->start_notify)
+    tween->start_notify (tween->start_data);
+  if (tween->complete_notify)
+    tween->complete_notify (tween->complete_data);
+
+  g_free (tween->properties);
+  g_slice_free (Tween, tween);
+}
+
+static void
+update_timeline (ShellTweenEngine *engine)
+{
+  gboolean running = clutter_timeline_is_playing (engine->timeline);
+
+  if (!g_queue_is_empty (&engine->tweens) && !running)
+    {
+      engine->clock_start = -1;
+      engine->current_time = -1;
+      clutter_timeline_start (engine->timeline);
+      shell_global_begin_work (shell_global_get ());
+    }
+  else if (g_queue_is_empty (&engine->tweens) && running)
+    {
+      /* Tweens added while idle start on the first frame of the next
+       * session, not at the time the last one ended */
+      engine->clock_start = -1;
+      engine->current_time = -1;
+      clutter_timeline_stop (engine->timeline);
+      shell_global_end_work (shell_global_get ());
+    }
+}
+
+/* Frees tweens marked as removed, once nothing is iterating over them */
+static void
+collect_removed (ShellTweenEngine *engine)
+{
+  GList *l, *next;
+
+  if (engine->in_update || !engine->have_removed)
+    return;
+
+  for (l = engine->tweens.head; l; l = next)
+    {
+      Tween *tween = l->data;
+
+      next = l->next;
+      if (!tween->removed)
+        continue;
+
+      g_queue_delete_link (&engine->tweens, l);
+      if (tween->target)
+        unref_target (engine, tween->target);
+      tween_free (tween);
+    }
+
+  engine->have_removed = FALSE;
+
+  update_timeline (engine);
+}
+
+static void
+remove_tween (ShellTweenEngine *engine,
+              Tween            *tween)
+{
+  tween->removed = TRUE;
+  engine->have_removed = TRUE;
+}
+
+static void
+on_target_finalized (gpointer  data,
+                     GObject  *where_the_object_was)
+{
+  ShellTweenEngine *engine = data;
+  GList *l;
+
+  g_hash_table_remove (engine->targets, where_the_object_was);
+
+  for (l = engine->tweens.head; l; l = l->next)
+    {
+      Tween *tween = l->data;
+
+      if (tween->target == where_the_object_was)
+        {
+          tween->target = NULL;
+          remove_tween (engine, tween);
+        }
+    }
+
+  collect_removed (engine);
+}
+
+/* Removes the properties in @pspecs from the tweens on @target. Tweens
+ * left without properties are removed, without calling their
+ * on_complete; @pspecs %NULL means all properties. */
+static gboolean
+remove_properties (ShellTweenEngine  *engine,
+                   GObject           *target,
+                   GParamSpec       **pspecs,
+                   int                n_pspecs)
+{
+  gboolean removed = FALSE;
+  GList *l;
+
+  for (l = engine->tweens.head; l; l = l->next)
+    {
+      Tween *tween = l->data;
+      int i, j;
+
+      if (tween->target != target || tween->removed)
+        continue;
+
+      if (pspecs == NULL)
+        {
+          remove_tween (engine, tween);
+          removed = TRUE;
+          continue;
+        }
+
+      for (i = 0; i < tween->n_properties; )
+        {
+          for (j = 0; j < n_pspecs; j++)
+            if (tween->properties[i].pspec == pspecs[j])
+              break;
+
+          if (j < n_pspecs)
+            {
+              tween->properties[i] = tween->properties[tween->n_properties - 1];
+              tween->n_properties--;
+              removed = TRUE;
+            }
+          else
+            i++;
+        }
+
+      if (tween->n_properties == 0)
+        remove_tween (engine, tween);
+    }
+
+  return removed;
+}
+
+/* Looks up @properties on @target; unknown names are skipped. Returns
+ * %NULL for all properties if @properties is %NULL or empty. */
+static GParamSpec **
+lookup_properties (GObject     *target,
+                   const char **properties,
+                   int         *n_pspecs)
+{
+  GObjectClass *klass = G_OBJECT_GET_CLASS (target);
+  GParamSpec **pspecs;
+  int i, n = 0;
+
+  *n_pspecs = 0;
+  if (properties == NULL || properties[0] == NULL)
+    return NULL;
+
+  pspecs = g_new (GParamSpec *, g_strv_length ((char **) properties));
+  for (i = 0; properties[i]; i++)
+    {
+      GParamSpec *pspec = g_object_class_find_property (klass, properties[i]);
+
+      if (pspec)
+        pspecs[n++] = pspec;
+    }
+
+  *n_pspecs = n;
+  return pspecs;
+}
+
+/* Advances @tween to @now; returns %TRUE if it completed */
+static gboolean
+update_tween (Tween  *tween,
+              gint64  now)
+{
+  gint64 elapsed;
+  double t;
+  int i;
+
+  if (tween->paused)
+    return FALSE;
+
+  if (tween->start_time < 0)
+    tween->start_time = now + tween->delay;
+
+  elapsed = now - tween->start_time;
+  if (elapsed < 0)
+    return FALSE;
+
+  if (!tween->started)
+    {
+      tween->started = TRUE;
+
+      for (i = 0; i < tween->n_properties; i++)
+        tween->properties[i].start = get_property (tween->target,
+                                                   tween->properties[i].pspec);
+
+      if (tween->on_start)
+        tween->on_start (tween->start_data);
+
+      /* on_start may have removed the tween */
+      if (tween->removed)
+        return FALSE;
+    }
+
+  if (elapsed >= tween->duration)
+    t = 1;
+  else
+    t = tween->ease ((double) elapsed / tween->duration);
+
+  g_object_freeze_notify (tween->target);
+
+  for (i = 0; i < tween->n_properties; i++)
+    {
+      TweenProperty *property = &tween->properties[i];
+      double value;
+
+      if (elapsed >= tween->duration)
+        value = property->end;
+      else
+        value = property->start + t * (property->end - property->start);
+
+      if (tween->rounded)
+        value = floor (value + 0.5);
+
+      set_property (tween->target, property->pspec, value);
+    }
+
+  g_object_thaw_notify (tween->target);
+
+  return elapsed >= tween->duration;
+}
+
+static void
+complete_tween (ShellTweenEngine *engine,
+                Tween            *tween)
+{
+  remove_tween (engine, tween);
+
+  if (tween->on_complete)
+    tween->on_complete (tween->complete_data);
+}
+
+static void
+on_new_frame (ClutterTimeline  *timeline,
+              gint              msecs,
+              ShellTweenEngine *engine)
+{
+  gint64 now = g_get_monotonic_time ();
+  GList *l;
+
+  /* If there was a lot of setup before the animation, the first frame
+   * comes late; start the clock there rather than dropping frames
+   * right away. */
+  if (engine->clock_start < 0)
+    engine->clock_start = now;
+  engine->current_time = now - engine->clock_start;
+
+  engine->in_update = TRUE;
+
+  /* Tweens added by callbacks are appended, and updated in this frame */
+  for (l = engine->tweens.head; l; l = l->next)
+    {
+      Tween *tween = l->data;
+
+      if (tween->removed)
+        continue;
+
+      if (update_tween (tween, engine->current_time) && !tween->removed)
+        complete_tween (engine, tween);
+    }
+
+  engine->in_update = FALSE;
+
+  collect_removed (engine);
+}
+
+static void
+shell_tween_engine_init (ShellTweenEngine *engine)
+{
+  g_queue_init (&engine->tweens);
+  engine->targets = g_hash_table_new (NULL, NULL);
+
+  /* We don't have a finite duration, so use 1000 seconds as "infinity"
+   * and loop; we keep track of time ourselves. */
+  engine->timeline = clutter_timeline_new (1000 * 1000);
+  clutter_timeline_set_loop (engine->timeline, TRUE);
+  g_signal_connect (engine->timeline, "new-frame",
+                    G_CALLBACK (on_new_frame), engine);
+
+  engine->clock_start = -1;
+  engine->current_time = -1;
+}
+
+static void
+shell_tween_engine_finalize (GObject *object)
+{
+  ShellTweenEngine *engine = SHELL_TWEEN_ENGINE (object);
+  GList *l;
+
+  for (l = engine->tweens.head; l; l = l->next)
+    remove_tween (engine, l->data);
+  collect_removed (engine);
+
+  g_hash_table_destroy (engine->targets);
+  g_object_unref (engine->timeline);
+
+  G_OBJECT_CLASS (shell_tween_engine_parent_class)->finalize (object);
+}
+
+static void
+shell_tween_engine_class_init (ShellTweenEngineClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->finalize = shell_tween_engine_finalize;
+}
+
+/**
+ * shell_tween_engine_get_default:
+ *
+ * Return Value: (transfer none): The global #ShellTweenEngine singleton
+ */
+ShellTweenEngine *
+shell_tween_engine_get_default (void)
+{
+  static ShellTweenEngine *instance = NULL;
+
+  if (instance == NULL)
+    instance = g_object_new (SHELL_TYPE_TWEEN_ENGINE, NULL);
+
+  return instance;
+}
+
+/**
+ * shell_tween_engine_add_tween:
+ * @engine: the #ShellTweenEngine
+ * @target: the object to animate
+ * @properties: (array length=n_properties): names of the properties to animate
+ * @values: (array length=n_properties): values to animate the properties to
+ * @n_properties: the number of properties
+ * @time: duration of the tween, in seconds
+ * @delay: time to wait before starting, in seconds
+ * @transition: name of a Tweener easing equation, like "easeOutQuad"
+ * @rounded: whether to round values to integers
+ * @on_start: (scope notified) (allow-none) (closure start_data) (destroy start_notify):
+ *   function to call when the tween starts
+ * @start_data: data to pass to @on_start
+ * @start_notify: function to free @start_data
+ * @on_complete: (scope notified) (allow-none) (closure complete_data) (destroy complete_notify):
+ *   function to call when the tween completes
+ * @complete_data: data to pass to @on_complete
+ * @complete_notify: function to free @complete_data
+ *
+ * Animates @properties of @target from their values when the tween
+ * starts to @values. Existing tweens of the same properties are
+ * overwritten. As with Tweener, a tween without time or delay is
+ * applied, and its callbacks called, right away.
+ *
+ * Nothing is done if @transition isn't known, or one of the properties
+ * doesn't exist or isn't a readable and writable number.
+ *
+ * Return value: an id for the tween, or 0 if it couldn't be added
+ */
+guint
+shell_tween_engine_add_tween (ShellTweenEngine  *engine,
+                              GObject           *target,
+                              const char       **properties,
+                              const double      *values,
+                              int                n_properties,
+                              double             time,
+                              double             delay,
+                              const char        *transition,
+                              gboolean           rounded,
+                              ShellTweenFunc     on_start,
+                              gpointer           start_data,
+                              GDestroyNotify     start_notify,
+                              ShellTweenFunc     on_complete,
+                              gpointer           complete_data,
+                              GDestroyNotify     complete_notify)
+{
+  GObjectClass *klass;
+  GParamSpec **pspecs;
+  EaseFunc ease;
+  Tween *tween;
+  guint id;
+  double slow_down_factor;
+  int i;
+
+  g_return_val_if_fail (SHELL_IS_TWEEN_ENGINE (engine), 0);
+  g_return_val_if_fail (G_IS_OBJECT (target), 0);
+  g_return_val_if_fail (n_properties > 0, 0);
+
+  ease = lookup_transition (transition ? transition : "easeOutExpo");
+  if (ease == NULL)
+    return 0;
+
+  klass = G_OBJECT_GET_CLASS (target);
+  pspecs = g_newa (GParamSpec *, n_properties);
+  for (i = 0; i < n_properties; i++)
+    {
+      pspecs[i] = g_object_class_find_property (klass, properties[i]);
+      if (pspecs[i] == NULL || !is_animatable (pspecs[i]))
+        return 0;
+    }
+
+  remove_properties (engine, target, pspecs, n_properties);
+
+  slow_down_factor = st_get_slow_down_factor ();
+
+  tween = g_slice_new0 (Tween);
+  tween->id = ++engine->last_id;
+  tween->target = target;
+  tween->delay = delay * slow_down_factor * G_USEC_PER_SEC;
+  tween->duration = time * slow_down_factor * G_USEC_PER_SEC;
+  tween->ease = ease;
+  tween->rounded = rounded != FALSE;
+  tween->on_start = on_start;
+  tween->start_data = start_data;
+  tween->start_notify = start_notify;
+  tween->on_complete = on_complete;
+  tween->complete_data = complete_data;
+  tween->complete_notify = complete_notify;
+
+  tween->properties = g_new (TweenProperty, n_properties);
+  tween->n_properties = n_properties;
+  for (i = 0; i < n_properties; i++)
+    {
+      tween->properties[i].pspec = pspecs[i];
+      tween->properties[i].end = values[i];
+    }
+
+  /* Tweens added between frames start from the last frame, like with
+   * Tweener; before the first frame, they start with it. */
+  tween->start_time = engine->current_time < 0 ? -1 : engine->current_time + tween->delay;
+
+  g_queue_push_tail (&engine->tweens, tween);
+  ref_target (engine, target);
+
+  /* A tween applied right away is freed by collect_removed() below */
+  id = tween->id;
+
+  if (tween->duration <= 0 && tween->delay <= 0)
+    {
+      gboolean was_in_update = engine->in_update;
+
+      engine->in_update = TRUE;
+      tween->start_time = 0;
+      if (update_tween (tween, 0) && !tween->removed)
+        complete_tween (engine, tween);
+      engine->in_update = was_in_update;
+    }
+
+  collect_removed (engine);
+  update_timeline (engine);
+
+  return id;
+}
+
+/**
+ * shell_tween_engine_remove_tweens:
+ * @engine: the #ShellTweenEngine
+ * @target: the animated object
+ * @properties: (array zero-terminated=1) (allow-none): properties to stop animating,
+ *   or %NULL for all
+ *
+ * Stops animating @properties of @target, leaving them at their current
+ * values. Completion callbacks aren't called.
+ *
+ * Return value: %TRUE if any tween was affected
+ */
+gboolean
+shell_tween_engine_remove_tweens (ShellTweenEngine  *engine,
+                                  GObject           *target,
+                                  const char       **properties)
+{
+  GParamSpec **pspecs;
+  int n_pspecs;
+  gboolean removed;
+
+  g_return_val_if_fail (SHELL_IS_TWEEN_ENGINE (engine), FALSE);
+  g_return_val_if_fail (G_IS_OBJECT (target), FALSE);
+
+  if (!g_hash_table_lookup (engine->targets, target))
+    return FALSE;
+
+  pspecs = lookup_properties (target, properties, &n_pspecs);
+
+  removed = remove_properties (engine, target, pspecs, n_pspecs);
+  g_free (pspecs);
+
+  collect_removed (engine);
+
+  return removed;
+}
+
+static gboolean
+tween_has_property (Tween       *tween,
+                    GParamSpec **pspecs,
+                    int          n_pspecs)
+{
+  int i, j;
+
+  if (pspecs == NULL)
+    return TRUE;
+
+  for (i = 0; i < tween->n_properties; i++)
+    for (j = 0; j < n_pspecs; j++)
+      if (tween->properties[i].pspec == pspecs[j])
+        return TRUE;
+
+  return FALSE;
+}
+
+static gboolean
+set_paused (ShellTweenEngine  *engine,
+            GObject           *target,
+            const char       **properties,
+            gboolean           paused)
+{
+  GParamSpec **pspecs;
+  int n_pspecs;
+  gboolean changed = FALSE;
+  GList *l;
+
+  if (!g_hash_table_lookup (engine->targets, target))
+    return FALSE;
+
+  pspecs = lookup_properties (target, properties, &n_pspecs);
+
+  for (l = engine->tweens.head; l; l = l->next)
+    {
+      Tween *tween = l->data;
+
+      if (tween->target != target || tween->removed ||
+          tween->paused == paused || !tween_has_property (tween, pspecs, n_pspecs))
+        continue;
+
+      tween->paused = paused;
+      changed = TRUE;
+
+      if (tween->start_time < 0)
+        continue;
+
+      /* Resumed tweens continue where they were paused */
+      if (paused)
+        tween->paused_time = engine->current_time;
+      else
+        tween->start_time += engine->current_time - tween->paused_time;
+    }
+
+  g_free (pspecs);
+
+  return changed;
+}
+
+/**
+ * shell_tween_engine_pause_tweens:
+ * @engine: the #ShellTweenEngine
+ * @target: the animated object
+ * @properties: (array zero-terminated=1) (allow-none): properties to pause, or
+ *   %NULL for all
+ *
+ * Pauses the tweens of @target animating any of @properties.
+ *
+ * Return value: %TRUE if any tween was affected
+ */
+gboolean
+shell_tween_engine_pause_tweens (ShellTweenEngine  *engine,
+                                 GObject           *target,
+                                 const char       **properties)
+{
+  g_return_val_if_fail (SHELL_IS_TWEEN_ENGINE (engine), FALSE);
+  g_return_val_if_fail (G_IS_OBJECT (target), FALSE);
+
+  return set_paused (engine, target, properties, TRUE);
+}
+
+/**
+ * shell_tween_engine_resume_tweens:
+ * @engine: the #ShellTweenEngine
+ * @target: the animated object
+ * @properties: (array zero-terminated=1) (allow-none): properties to resume, or
+ *   %NULL for all
+ *
+ * Resumes tweens paused with shell_tween_engine_pause_tweens().
+ *
+ * Return value: %TRUE if any tween was affected
+ */
+gboolean
+shell_tween_engine_resume_tweens (ShellTweenEngine  *engine,
+                                  GObject           *target,
+                                  const char       **properties)
+{
+  g_return_val_if_fail (SHELL_IS_TWEEN_ENGINE (engine), FALSE);
+  g_return_val_if_fail (G_IS_OBJECT (target), FALSE);
+
+  return set_paused (engine, target, properties, FALSE);
+}
+
+/**
+ * shell_tween_engine_get_tween_count:
+ * @engine: the #ShellTweenEngine
+ * @target: an object
+ *
+ * Return value: the number of tweens animating @target
+ */
+int
+shell_tween_engine_get_tween_count (ShellTweenEngine *engine,
+                                    GObject          *target)
+{
+  GList *l;
+  int count = 0;
+
+  g_return_val_if_fail (SHELL_IS_TWEEN_ENGINE (engine), 0);
+  g_return_val_if_fail (G_IS_OBJECT (target), 0);
+
+  if (!g_hash_table_lookup (engine->targets, target))
+    return 0;
+
+  for (l = engine->tweens.head; l; l = l->next)
+    {
+      Tween *tween = l->data;
+
+      if (tween->target == target && !tween->removed)
+        count++;
+    }
+
+  return count;
+}
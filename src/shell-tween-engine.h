@@ -0,0 +1,70 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+#ifndef __SHELL_TWEEN_ENGINE_H__
+#define __SHELL_TWEEN_ENGINE_H__
+
+#include <glib-object.h>
+
+/**
+ * SECTION:shell-tween-engine
+ * @short_description: Animates numeric object properties
+ *
+ * #ShellTweenEngine runs the tweens of numeric #GObject properties
+ * that js/ui/tweener.js hands it. All of them are advanced from a
+ * single #ClutterTimeline, so each frame interpolates and sets every
+ * animated property in one pass, without calling into JavaScript
+ * except to report that a tween started or completed. Timing, easing
+ * equations and the order of callbacks follow the Tweener library.
+ */
+
+typedef struct _ShellTweenEngine      ShellTweenEngine;
+typedef struct _ShellTweenEngineClass ShellTweenEngineClass;
+
+#define SHELL_TYPE_TWEEN_ENGINE              (shell_tween_engine_get_type ())
+#define SHELL_TWEEN_ENGINE(object)           (G_TYPE_CHECK_INSTANCE_CAST ((object), SHELL_TYPE_TWEEN_ENGINE, ShellTweenEngine))
+#define SHELL_TWEEN_ENGINE_CLASS(klass)      (G_TYPE_CHECK_CLASS_CAST ((klass), SHELL_TYPE_TWEEN_ENGINE, ShellTweenEngineClass))
+#define SHELL_IS_TWEEN_ENGINE(object)        (G_TYPE_CHECK_INSTANCE_TYPE ((object), SHELL_TYPE_TWEEN_ENGINE))
+#define SHELL_IS_TWEEN_ENGINE_CLASS(klass)   (G_TYPE_CHECK_CLASS_TYPE ((klass), SHELL_TYPE_TWEEN_ENGINE))
+#define SHELL_TWEEN_ENGINE_GET_CLASS(obj)    (G_TYPE_INSTANCE_GET_CLASS ((obj), SHELL_TYPE_TWEEN_ENGINE, ShellTweenEngineClass))
+
+/**
+ * ShellTweenFunc:
+ * @user_data: data passed to shell_tween_engine_add_tween()
+ *
+ * Called when a tween starts, after its delay, or completes.
+ */
+typedef void (*ShellTweenFunc) (gpointer user_data);
+
+GType shell_tween_engine_get_type (void) G_GNUC_CONST;
+
+ShellTweenEngine *shell_tween_engine_get_default (void);
+
+guint             shell_tween_engine_add_tween       (ShellTweenEngine  *engine,
+                                                      GObject           *target,
+                                                      const char       **properties,
+                                                      const double      *values,
+                                                      int                n_properties,
+                                                      double             time,
+                                                      double             delay,
+                                                      const char        *transition,
+                                                      gboolean           rounded,
+                                                      ShellTweenFunc     on_start,
+                                                      gpointer           start_data,
+                                                      GDestroyNotify     start_notify,
+                                                      ShellTweenFunc     on_complete,
+                                                      gpointer           complete_data,
+                                                      GDestroyNotify     complete_notify);
+
+gboolean          shell_tween_engine_remove_tweens   (ShellTweenEngine  *engine,
+                                                      GObject           *target,
+                                                      const char       **properties);
+gboolean          shell_tween_engine_pause_tweens    (ShellTweenEngine  *engine,
+                                                      GObject           *target,
+                                                      const char       **properties);
+gboolean          shell_tween_engine_resume_tweens   (ShellTweenEngine  *engine,
+                                                      GObject           *target,
+                                                      const char       **properties);
+
+int               shell_tween_engine_get_tween_count (ShellTweenEngine  *engine,
+                                                      GObject           *target);
+
+#endif /* __SHELL_TWEEN_ENGINE_H__ */
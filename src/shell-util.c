@@ -2,10 +2,12 @@
 
 #include "config.h"
 
+#include <math.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
 #include "shell-util.h"
+#include "shell-generic-container.h"
 #include <glib/gi18n-lib.h>
 #include <gtk/gtk.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
@@ -19,6 +21,10 @@
 #include <systemd/sd-login.h>
 #endif
 
+typedef struct _PickIndex PickIndex;
+static PickIndex *pick_index_get (ClutterStage *stage,
+                                  gboolean      create);
+
 static void
 stop_pick (ClutterActor       *actor,
            const ClutterColor *color)
@@ -39,6 +45,7 @@ shell_util_set_hidden_from_pick (ClutterActor *actor,
                                  gboolean      hidden)
 {
   gpointer existing_handler_data;
+  ClutterActor *stage;
 
   existing_handler_data = g_object_get_data (G_OBJECT (actor),
                                              "shell-stop-pick");
@@ -57,6 +64,451 @@ shell_util_set_hidden_from_pick (ClutterActor *actor,
       g_signal_handlers_disconnect_by_func (actor, stop_pick, NULL);
       g_object_set_data (G_OBJECT (actor), "shell-stop-pick", NULL);
     }
+
+  stage = clutter_actor_get_stage (actor);
+  if (stage != NULL)
+    {
+      PickIndex *index = pick_index_get (CLUTTER_STAGE (stage), FALSE);
+      if (index != NULL)
+        index->valid = FALSE;
+    }
+}
+
+/* Geometric picking
+ *
+ * Clutter picks by painting the scene with a unique color per actor
+ * and reading back the pixel under the pointer, which is a roundtrip
+ * to the GPU for every pick. Most of our actors pick as their
+ * (transformed) allocation, so we instead keep a flat list of the
+ * pickable rectangles of the stage, in paint order, and search it
+ * from the top. The list is rebuilt lazily after anything queues a
+ * redraw or gets a new allocation, so all the picks between two
+ * frames share it. Clutter only emits queue-redraw on the stage when
+ * the next frame starts, so before using the list, we get any
+ * pending relayout done; actors moved since the last frame then
+ * invalidate it through allocation-changed. While
+ * something is animating, a redraw is queued every frame and the list
+ * would have to be rebuilt for nearly every pick; when it is
+ * invalidated soon after being built, we use the color-buffer pick
+ * instead until it has been valid for a while again.
+ *
+ * Actors whose pick we don't understand (custom pick implementations,
+ * textures picked by alpha, rotated actors) are recorded with their
+ * paint box and hand over to the color-buffer pick when hit.
+ */
+
+typedef struct {
+  ClutterActor    *actor;
+  ClutterActorBox  box;     /* stage coordinates, clipped */
+  guint            fallback : 1;
+} PickEntry;
+
+/* An index invalidated sooner than this after being built is not
+ * rebuilt until this much time has passed */
+#define PICK_INDEX_MIN_LIFETIME_US (100 * 1000)
+
+struct _PickIndex {
+  ClutterStage *stage;
+  GArray       *entries;
+  gboolean      valid;
+  gint64        build_time;
+};
+
+static GQuark pick_index_quark;
+
+static gboolean
+is_hidden_from_pick (ClutterActor *actor)
+{
+  return g_object_get_data (G_OBJECT (actor), "shell-stop-pick") != NULL;
+}
+
+static gboolean
+pick_is_geometric (ClutterActor *actor)
+{
+  static GHashTable *geometric_picks = NULL;
+  gpointer pick = CLUTTER_ACTOR_GET_CLASS (actor)->pick;
+
+  if (G_UNLIKELY (geometric_picks == NULL))
+    {
+      /* Classes that pick their allocation and then their children;
+       * the special cases among them are handled when adding children
+       */
+      GType types[] = { CLUTTER_TYPE_ACTOR, CLUTTER_TYPE_GROUP, ST_TYPE_BOX_LAYOUT,
+                        ST_TYPE_GRID_VIEW, ST_TYPE_SCROLL_VIEW, SHELL_TYPE_GENERIC_CONTAINER };
+      guint i;
+
+      geometric_picks = g_hash_table_new (NULL, NULL);
+      for (i = 0; i < G_N_ELEMENTS (types); i++)
+        {
+          ClutterActorClass *klass = g_type_class_ref (types[i]);
+          g_hash_table_add (geometric_picks, klass->pick);
+        }
+    }
+
+  if (CLUTTER_IS_TEXTURE (actor))
+    return !clutter_texture_get_pick_with_alpha (CLUTTER_TEXTURE (actor));
+
+  return g_hash_table_contains (geometric_picks, pick);
+}
+
+/* Maps @local, in the coordinates of @actor's children, to the stage;
+ * returns %FALSE if the result isn't an axis-aligned rectangle.
+ */
+static gboolean
+local_box_to_stage (ClutterActor          *actor,
+                    const ClutterActorBox *local,
+                    ClutterActorBox       *box)
+{
+  ClutterVertex in, top_left, top_right, bottom_left, bottom_right;
+
+  in.z = 0;
+
+  in.x = local->x1; in.y = local->y1;
+  clutter_actor_apply_transform_to_point (actor, &in, &top_left);
+  in.x = local->x2; in.y = local->y1;
+  clutter_actor_apply_transform_to_point (actor, &in, &top_right);
+  in.x = local->x1; in.y = local->y2;
+  clutter_actor_apply_transform_to_point (actor, &in, &bottom_left);
+  in.x = local->x2; in.y = local->y2;
+  clutter_actor_apply_transform_to_point (actor, &in, &bottom_right);
+
+  box->x1 = MIN (top_left.x, bottom_right.x);
+  box->y1 = MIN (top_left.y, bottom_right.y);
+  box->x2 = MAX (top_left.x, bottom_right.x);
+  box->y2 = MAX (top_left.y, bottom_right.y);
+
+  return (fabsf (top_left.y - top_right.y) < 0.5 &&
+          fabsf (top_left.x - bottom_left.x) < 0.5);
+}
+
+static void
+intersect_box (ClutterActorBox       *box,
+               const ClutterActorBox *clip)
+{
+  box->x1 = MAX (box->x1, clip->x1);
+  box->y1 = MAX (box->y1, clip->y1);
+  box->x2 = MIN (box->x2, clip->x2);
+  box->y2 = MIN (box->y2, clip->y2);
+}
+
+static gboolean
+box_is_empty (const ClutterActorBox *box)
+{
+  return box->x1 >= box->x2 || box->y1 >= box->y2;
+}
+
+/* Scrollable St containers paint their own box untranslated, but
+ * clip their (translated) children to their content box.
+ */
+static gboolean
+get_scroll_offset (ClutterActor *actor,
+                   gfloat       *x,
+                   gfloat       *y)
+{
+  StAdjustment *hadjustment, *vadjustment;
+
+  *x = *y = 0;
+
+  if (!ST_IS_SCROLLABLE (actor))
+    return FALSE;
+
+  st_scrollable_get_adjustments (ST_SCROLLABLE (actor), &hadjustment, &vadjustment);
+  if (hadjustment == NULL && vadjustment == NULL)
+    return FALSE;
+
+  /* StGridView only ever scrolls vertically */
+  if (hadjustment && !ST_IS_GRID_VIEW (actor))
+    *x = (int) st_adjustment_get_value (hadjustment);
+  if (vadjustment)
+    *y = (int) st_adjustment_get_value (vadjustment);
+
+  return TRUE;
+}
+
+static gboolean
+child_is_picked (ClutterActor *actor,
+                 ClutterActor *child)
+{
+  if (SHELL_IS_GENERIC_CONTAINER (actor))
+    return !shell_generic_container_get_skip_paint (SHELL_GENERIC_CONTAINER (actor), child);
+
+  if (ST_IS_SCROLL_VIEW (actor))
+    {
+      StScrollView *scroll = ST_SCROLL_VIEW (actor);
+      gboolean visible;
+
+      if (child == st_scroll_view_get_hscroll_bar (scroll))
+        g_object_get (scroll, "hscrollbar-visible", &visible, NULL);
+      else if (child == st_scroll_view_get_vscroll_bar (scroll))
+        g_object_get (scroll, "vscrollbar-visible", &visible, NULL);
+      else
+        visible = TRUE;
+
+      return visible;
+    }
+
+  return TRUE;
+}
+
+static void
+pick_index_add_actor (PickIndex             *index,
+                      ClutterActor          *actor,
+                      const ClutterActorBox *clip)
+{
+  ClutterActorBox local, box, child_clip;
+  ClutterActor *child;
+  PickEntry entry;
+  gfloat width, height, scroll_x, scroll_y;
+  gboolean scrolled, aligned;
+
+  if (!CLUTTER_ACTOR_IS_MAPPED (actor) ||
+      !clutter_actor_has_allocation (actor) ||
+      is_hidden_from_pick (actor))
+    return;
+
+  clutter_actor_get_size (actor, &width, &height);
+  scrolled = get_scroll_offset (actor, &scroll_x, &scroll_y);
+
+  local.x1 = scroll_x;
+  local.y1 = scroll_y;
+  local.x2 = scroll_x + width;
+  local.y2 = scroll_y + height;
+  aligned = local_box_to_stage (actor, &local, &box);
+
+  entry.actor = actor;
+  entry.fallback = !aligned || !pick_is_geometric (actor);
+
+  if (entry.fallback)
+    {
+      /* Let the color-buffer pick sort out the whole painted area */
+      if (!clutter_actor_get_paint_box (actor, &entry.box))
+        entry.box = box;
+
+      intersect_box (&entry.box, clip);
+      if (!box_is_empty (&entry.box))
+        g_array_append_val (index->entries, entry);
+
+      return;
+    }
+
+  entry.box = box;
+  intersect_box (&entry.box, clip);
+  if (!box_is_empty (&entry.box))
+    g_array_append_val (index->entries, entry);
+
+  if (clutter_actor_get_n_children (actor) == 0)
+    return;
+
+  child_clip = *clip;
+
+  if (clutter_actor_get_clip_to_allocation (actor))
+    intersect_box (&child_clip, &box);
+
+  if (clutter_actor_has_clip (actor))
+    {
+      ClutterActorBox clip_box;
+      gfloat x, y, w, h;
+
+      clutter_actor_get_clip (actor, &x, &y, &w, &h);
+      clutter_actor_box_set_origin (&local, x, y);
+      clutter_actor_box_set_size (&local, w, h);
+      local_box_to_stage (actor, &local, &clip_box);
+      intersect_box (&child_clip, &clip_box);
+    }
+
+  if (scrolled)
+    {
+      ClutterActorBox allocation, content_box, clip_box;
+      StThemeNode *theme_node = st_widget_get_theme_node (ST_WIDGET (actor));
+
+      clutter_actor_get_allocation_box (actor, &allocation);
+      st_theme_node_get_content_box (theme_node, &allocation, &content_box);
+      content_box.x1 += scroll_x;
+      content_box.y1 += scroll_y;
+      content_box.x2 += scroll_x;
+      content_box.y2 += scroll_y;
+      local_box_to_stage (actor, &content_box, &clip_box);
+      intersect_box (&child_clip, &clip_box);
+    }
+
+  if (box_is_empty (&child_clip))
+    return;
+
+  for (child = clutter_actor_get_first_child (actor);
+       child != NULL;
+       child = clutter_actor_get_next_sibling (child))
+    {
+      if (child_is_picked (actor, child))
+        pick_index_add_actor (index, child, &child_clip);
+    }
+}
+
+static void
+pick_index_ensure (PickIndex *index)
+{
+  ClutterActorBox clip;
+
+  if (index->valid)
+    return;
+
+  g_array_set_size (index->entries, 0);
+
+  clip.x1 = clip.y1 = -G_MAXFLOAT;
+  clip.x2 = clip.y2 = G_MAXFLOAT;
+  pick_index_add_actor (index, CLUTTER_ACTOR (index->stage), &clip);
+
+  index->valid = TRUE;
+  index->build_time = g_get_monotonic_time ();
+}
+
+static gboolean
+is_pick_visible (ClutterActor *actor)
+{
+  for (; actor != NULL; actor = clutter_actor_get_parent (actor))
+    if (is_hidden_from_pick (actor))
+      return FALSE;
+
+  return TRUE;
+}
+
+static gboolean
+allocation_changed_hook (GSignalInvocationHint *ihint,
+                         guint                  n_param_values,
+                         const GValue          *param_values,
+                         gpointer               data)
+{
+  ClutterActor *actor = g_value_get_object (&param_values[0]);
+  ClutterActor *stage;
+  PickIndex *index;
+
+  stage = clutter_actor_get_stage (actor);
+  if (stage == NULL)
+    return TRUE;
+
+  index = pick_index_get (CLUTTER_STAGE (stage), FALSE);
+  if (index != NULL && index->valid && is_pick_visible (actor))
+    index->valid = FALSE;
+
+  return TRUE;
+}
+
+static void
+on_stage_queue_redraw (ClutterStage *stage,
+                       ClutterActor *origin,
+                       PickIndex    *index)
+{
+  /* Moving an actor that is hidden from pick, like a drag actor,
+   * doesn't change what is picked
+   */
+  if (is_pick_visible (origin))
+    index->valid = FALSE;
+}
+
+static void
+pick_index_free (gpointer data)
+{
+  PickIndex *index = data;
+
+  g_array_free (index->entries, TRUE);
+  g_slice_free (PickIndex, index);
+}
+
+static PickIndex *
+pick_index_get (ClutterStage *stage,
+                gboolean      create)
+{
+  PickIndex *index;
+
+  if (G_UNLIKELY (pick_index_quark == 0))
+    pick_index_quark = g_quark_from_static_string ("shell-pick-index");
+
+  index = g_object_get_qdata (G_OBJECT (stage), pick_index_quark);
+  if (index == NULL && create)
+    {
+      static gboolean hook_added = FALSE;
+
+      if (!hook_added)
+        {
+          g_signal_add_emission_hook (g_signal_lookup ("allocation-changed",
+                                                       CLUTTER_TYPE_ACTOR),
+                                      0, allocation_changed_hook,
+                                      NULL, NULL);
+          hook_added = TRUE;
+        }
+
+      index = g_slice_new0 (PickIndex);
+      index->stage = stage;
+      index->entries = g_array_new (FALSE, FALSE, sizeof (PickEntry));
+
+      g_signal_connect (stage, "queue-redraw",
+                        G_CALLBACK (on_stage_queue_redraw), index);
+      g_object_set_qdata_full (G_OBJECT (stage), pick_index_quark,
+                               index, pick_index_free);
+    }
+
+  return index;
+}
+
+/**
+ * shell_util_get_actor_at_pos:
+ * @stage: a #ClutterStage
+ * @pick_mode: how the scene graph should be painted
+ * @x: X coordinate to check
+ * @y: Y coordinate to check
+ *
+ * Like clutter_stage_get_actor_at_pos(), but answers from the geometry
+ * of the actors where possible, rather than by painting the stage.
+ * This is much cheaper for repeated picks, such as on every motion
+ * event during a drag.
+ *
+ * Return value: (transfer none): the actor at the specified coordinates
+ */
+ClutterActor *
+shell_util_get_actor_at_pos (ClutterStage    *stage,
+                             ClutterPickMode  pick_mode,
+                             gint             x,
+                             gint             y)
+{
+  ClutterActorBox stage_box;
+  PickIndex *index;
+  gint i;
+
+  g_return_val_if_fail (CLUTTER_IS_STAGE (stage), NULL);
+
+  if (pick_mode == CLUTTER_PICK_NONE)
+    return clutter_stage_get_actor_at_pos (stage, pick_mode, x, y);
+
+  index = pick_index_get (stage, TRUE);
+
+  /* Lays out the stage if anything moved since the last frame, which
+   * invalidates the index if any pickable allocation changed
+   */
+  clutter_actor_get_allocation_box (CLUTTER_ACTOR (stage), &stage_box);
+
+  /* The stage is changing every frame; don't rebuild for every pick */
+  if (!index->valid &&
+      g_get_monotonic_time () - index->build_time < PICK_INDEX_MIN_LIFETIME_US)
+    return clutter_stage_get_actor_at_pos (stage, pick_mode, x, y);
+
+  pick_index_ensure (index);
+
+  /* Clutter picks the center of the pixel */
+  for (i = index->entries->len - 1; i >= 0; i--)
+    {
+      PickEntry *entry = &g_array_index (index->entries, PickEntry, i);
+
+      if (x + 0.5 < entry->box.x1 || x + 0.5 >= entry->box.x2 ||
+          y + 0.5 < entry->box.y1 || y + 0.5 >= entry->box.y2)
+        continue;
+
+      if (entry->fallback)
+        return clutter_stage_get_actor_at_pos (stage, pick_mode, x, y);
+
+      if (pick_mode == CLUTTER_PICK_ALL || clutter_actor_get_reactive (entry->actor))
+        return entry->actor;
+    }
+
+  return CLUTTER_ACTOR (stage);
 }
 
 /**
@@ -13,6 +13,11 @@ G_BEGIN_DECLS
 void     shell_util_set_hidden_from_pick       (ClutterActor     *actor,
                                                 gboolean          hidden);
 
+ClutterActor *shell_util_get_actor_at_pos     (ClutterStage     *stage,
+                                                ClutterPickMode   pick_mode,
+                                                gint              x,
+                                                gint              y);
+
 void     shell_util_get_transformed_allocation (ClutterActor     *actor,
                                                 ClutterActorBox  *box);
 
@@ -0,0 +1,650 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+#include "config.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "shell-window-layout.h"
+
+/* Thumbnails should be less than 70% of the original size */
+#define WINDOW_CLONE_MAXIMUM_SCALE 0.7
+
+/* When calculating a layout, we calculate the scale of windows and the
+ * percent of the available area the new layout uses. If the values for
+ * the new layout, when weighted with the values as below, are worse
+ * than the previous layout's, we stop looking for a new layout and use
+ * the previous layout. Otherwise, we keep looking for a new layout.
+ */
+#define LAYOUT_SCALE_WEIGHT 1.0
+#define LAYOUT_SPACE_WEIGHT 0.1
+
+/* Number of arrangements remembered per workspace */
+#define MAX_CACHED_ARRANGEMENTS 8
+
+typedef struct {
+  double width;
+  double height;
+} WindowSize;
+
+/* Windows are placed in rows, in order. Rows with 3 or more windows
+ * are laid out as a grid of equal cells; with fewer rows each window
+ * keeps its own width.
+ */
+typedef struct {
+  /* What the arrangement was chosen for */
+  int n_windows;
+  WindowSize *sizes;
+  double search_width;
+  double search_height;
+
+  gboolean grid;
+  int n_rows;
+  int max_columns;
+
+  /* Per row: number of windows, and unscaled, unspaced size */
+  int *row_lengths;
+  double *row_full_widths;
+  double *row_full_heights;
+
+  double grid_width;
+  double grid_height;
+  double max_window_width;
+  double max_window_height;
+
+  /* The area scale and space were last computed for */
+  double area_width;
+  double area_height;
+
+  /* The base, non-fancy scale of each window, and the fraction of the
+   * area used by the layout */
+  double scale;
+  double space;
+} Arrangement;
+
+struct _ShellWindowLayoutClass
+{
+  GObjectClass parent_class;
+};
+
+struct _ShellWindowLayout
+{
+  GObject parent_instance;
+
+  double monitor_width;
+  double monitor_height;
+  double row_spacing;
+  double column_spacing;
+  double bottom_padding;
+
+  /* Arrangement *, most recently used first */
+  GQueue arrangements;
+  Arrangement *current;
+};
+
+G_DEFINE_TYPE (ShellWindowLayout, shell_window_layout, G_TYPE_OBJECT);
+
+static Arrangement *
+arrangement_new (const WindowSize *sizes,
+                 int               n_windows,
+                 int               n_rows)
+{
+  Arrangement *arrangement = g_slice_new0 (Arrangement);
+
+  arrangement->n_windows = n_windows;
+  arrangement->sizes = g_memdup (sizes, n_windows * sizeof (WindowSize));
+  arrangement->n_rows = n_rows;
+  arrangement->row_lengths = g_new0 (int, n_rows);
+  arrangement->row_full_widths = g_new0 (double, n_rows);
+  arrangement->row_full_heights = g_new0 (double, n_rows);
+
+  return arrangement;
+}
+
+static void
+arrangement_free (Arrangement *arrangement)
+{
+  g_free (arrangement->sizes);
+  g_free (arrangement->row_lengths);
+  g_free (arrangement->row_full_widths);
+  g_free (arrangement->row_full_heights);
+  g_slice_free (Arrangement, arrangement);
+}
+
+static void
+shell_window_layout_clear (ShellWindowLayout *layout)
+{
+  Arrangement *arrangement;
+
+  while ((arrangement = g_queue_pop_head (&layout->arrangements)))
+    arrangement_free (arrangement);
+
+  layout->current = NULL;
+}
+
+static void
+shell_window_layout_init (ShellWindowLayout *layout)
+{
+  g_queue_init (&layout->arrangements);
+}
+
+static void
+shell_window_layout_finalize (GObject *object)
+{
+  shell_window_layout_clear (SHELL_WINDOW_LAYOUT (object));
+
+  G_OBJECT_CLASS (shell_window_layout_parent_class)->finalize (object);
+}
+
+static void
+shell_window_layout_class_init (ShellWindowLayoutClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->finalize = shell_window_layout_finalize;
+}
+
+/**
+ * shell_window_layout_new:
+ *
+ * Return value: (transfer full): a new #ShellWindowLayout
+ */
+ShellWindowLayout *
+shell_window_layout_new (void)
+{
+  return g_object_new (SHELL_TYPE_WINDOW_LAYOUT, NULL);
+}
+
+/**
+ * shell_window_layout_set_monitor_size:
+ * @layout: the #ShellWindowLayout
+ * @width: width of the monitor the workspace is on
+ * @height: height of the monitor the workspace is on
+ *
+ * Windows that are small relative to the monitor are shown a bit
+ * larger than large ones; this sets the size they are compared to.
+ */
+void
+shell_window_layout_set_monitor_size (ShellWindowLayout *layout,
+                                      double             width,
+                                      double             height)
+{
+  g_return_if_fail (SHELL_IS_WINDOW_LAYOUT (layout));
+
+  if (layout->monitor_width == width && layout->monitor_height == height)
+    return;
+
+  layout->monitor_width = width;
+  layout->monitor_height = height;
+  shell_window_layout_clear (layout);
+}
+
+/**
+ * shell_window_layout_set_spacing:
+ * @layout: the #ShellWindowLayout
+ * @row_spacing: vertical space between rows
+ * @column_spacing: horizontal space between windows in a row
+ * @bottom_padding: space to leave below the last row
+ */
+void
+shell_window_layout_set_spacing (ShellWindowLayout *layout,
+                                 double             row_spacing,
+                                 double             column_spacing,
+                                 double             bottom_padding)
+{
+  g_return_if_fail (SHELL_IS_WINDOW_LAYOUT (layout));
+
+  if (layout->row_spacing == row_spacing &&
+      layout->column_spacing == column_spacing &&
+      layout->bottom_padding == bottom_padding)
+    return;
+
+  layout->row_spacing = row_spacing;
+  layout->column_spacing = column_spacing;
+  layout->bottom_padding = bottom_padding;
+  shell_window_layout_clear (layout);
+}
+
+/**
+ * shell_window_layout_invalidate:
+ * @layout: the #ShellWindowLayout
+ *
+ * As long as the window sizes stay the same, the arrangement chosen
+ * by shell_window_layout_compute_slots() is kept even if the area
+ * changes, so that windows don't jump between rows while the area is
+ * animated. This makes the next call pick the best arrangement for
+ * its area again.
+ */
+void
+shell_window_layout_invalidate (ShellWindowLayout *layout)
+{
+  g_return_if_fail (SHELL_IS_WINDOW_LAYOUT (layout));
+
+  layout->current = NULL;
+}
+
+/* Compute the size and fancy scale for a window using the base scale,
+ * @scale. The returned width and height are the window's, scaled by
+ * the fancy scale for convenience.
+ */
+static double
+compute_window_size_and_scale (ShellWindowLayout *layout,
+                               const WindowSize  *size,
+                               double             scale,
+                               double            *width,
+                               double            *height)
+{
+  double ratio, fancy_scale;
+
+  if (size->width > size->height)
+    ratio = size->width / layout->monitor_width;
+  else
+    ratio = size->height / layout->monitor_height;
+
+  fancy_scale = (2 / (1 + ratio)) * scale;
+
+  *width = size->width * fancy_scale;
+  *height = size->height * fancy_scale;
+
+  return fancy_scale;
+}
+
+static gboolean
+keep_same_row (double row_full_width,
+               double width,
+               double ideal_row_width)
+{
+  double old_ratio, new_ratio;
+
+  if (row_full_width + width <= ideal_row_width)
+    return TRUE;
+
+  old_ratio = row_full_width / ideal_row_width;
+  new_ratio = (row_full_width + width) / ideal_row_width;
+
+  return fabs (1 - new_ratio) < fabs (1 - old_ratio);
+}
+
+static Arrangement *
+compute_unaligned_arrangement (ShellWindowLayout *layout,
+                               const WindowSize  *sizes,
+                               int                n_windows,
+                               int                n_rows)
+{
+  Arrangement *arrangement = arrangement_new (sizes, n_windows, n_rows);
+  double total_width = 0, ideal_row_width;
+  int window_idx = 0, max_row = 0;
+  int i;
+
+  for (i = 0; i < n_windows; i++)
+    total_width += sizes[i].width;
+
+  ideal_row_width = total_width / n_rows;
+
+  for (i = 0; i < n_rows; i++)
+    {
+      for (; window_idx < n_windows; window_idx++)
+        {
+          double width, height;
+
+          compute_window_size_and_scale (layout, &sizes[window_idx], 1,
+                                         &width, &height);
+          arrangement->row_full_heights[i] = MAX (arrangement->row_full_heights[i], height);
+
+          /* either new width is < idealWidth or new width is nearer
+           * from idealWidth then oldWidth */
+          if (keep_same_row (arrangement->row_full_widths[i], width, ideal_row_width) ||
+              i == n_rows - 1)
+            {
+              arrangement->row_lengths[i]++;
+              arrangement->row_full_widths[i] += width;
+            }
+          else
+            break;
+        }
+    }
+
+  for (i = 0; i < n_rows; i++)
+    {
+      if (arrangement->row_full_widths[i] > arrangement->row_full_widths[max_row])
+        max_row = i;
+      arrangement->grid_height += arrangement->row_full_heights[i];
+    }
+
+  arrangement->grid = FALSE;
+  arrangement->max_columns = arrangement->row_lengths[max_row];
+  arrangement->grid_width = arrangement->row_full_widths[max_row];
+
+  return arrangement;
+}
+
+static Arrangement *
+compute_grid_arrangement (ShellWindowLayout *layout,
+                          const WindowSize  *sizes,
+                          int                n_windows,
+                          int                n_rows,
+                          int                n_columns)
+{
+  Arrangement *arrangement = arrangement_new (sizes, n_windows, n_rows);
+  int window_idx = 0;
+  int i;
+
+  for (i = 0; i < n_rows; i++)
+    {
+      for (; window_idx < n_windows; window_idx++)
+        {
+          double width, height;
+
+          if (arrangement->row_lengths[i] >= n_columns)
+            break;
+
+          arrangement->row_lengths[i]++;
+
+          compute_window_size_and_scale (layout, &sizes[window_idx], 1,
+                                         &width, &height);
+          arrangement->max_window_width = MAX (arrangement->max_window_width, width);
+          arrangement->max_window_height = MAX (arrangement->max_window_height, height);
+        }
+    }
+
+  arrangement->grid = TRUE;
+  arrangement->max_columns = n_columns;
+  arrangement->grid_width = n_columns * arrangement->max_window_width;
+  arrangement->grid_height = n_rows * arrangement->max_window_height;
+
+  return arrangement;
+}
+
+/* Computes the overall scale and space of the arrangement in the given
+ * area. The scale is the individual, non-fancy scale of each window,
+ * and the space is the fraction of the area used by the layout.
+ */
+static void
+compute_scale_and_space (ShellWindowLayout *layout,
+                         Arrangement       *arrangement,
+                         double             area_width,
+                         double             area_height)
+{
+  double hspacing, vspacing;
+  double horizontal_scale, vertical_scale, scale;
+  double scaled_width, scaled_height;
+
+  hspacing = (arrangement->max_columns - 1) * layout->column_spacing;
+  vspacing = (arrangement->n_rows - 1) * layout->row_spacing + layout->bottom_padding;
+
+  horizontal_scale = (area_width - hspacing) / arrangement->grid_width;
+  vertical_scale = (area_height - vspacing) / arrangement->grid_height;
+
+  scale = MIN (MIN (horizontal_scale, vertical_scale), WINDOW_CLONE_MAXIMUM_SCALE);
+
+  scaled_width = arrangement->grid_width * scale + hspacing;
+  scaled_height = arrangement->grid_height * scale + vspacing;
+
+  arrangement->area_width = area_width;
+  arrangement->area_height = area_height;
+  arrangement->scale = scale;
+  arrangement->space = (scaled_width * scaled_height) / (area_width * area_height);
+}
+
+static gboolean
+is_better_arrangement (Arrangement *old_arrangement,
+                       Arrangement *new_arrangement)
+{
+  double space_power, scale_power;
+
+  if (old_arrangement == NULL)
+    return TRUE;
+
+  space_power = (new_arrangement->space - old_arrangement->space) * LAYOUT_SPACE_WEIGHT;
+  scale_power = (new_arrangement->scale - old_arrangement->scale) * LAYOUT_SCALE_WEIGHT;
+
+  if (new_arrangement->scale > old_arrangement->scale &&
+      new_arrangement->space > old_arrangement->space)
+    {
+      /* Win win -- better scale and better space */
+      return TRUE;
+    }
+  else if (new_arrangement->scale > old_arrangement->scale &&
+           new_arrangement->space <= old_arrangement->space)
+    {
+      /* Keep new layout only if scale gain outweights aspect space loss */
+      return scale_power > space_power;
+    }
+  else if (new_arrangement->scale <= old_arrangement->scale &&
+           new_arrangement->space > old_arrangement->space)
+    {
+      /* Keep new layout only if aspect space gain outweights scale loss */
+      return space_power > scale_power;
+    }
+  else
+    {
+      /* Lose -- worse scale and space */
+      return FALSE;
+    }
+}
+
+/* We look for the largest scale that allows us to fit the largest
+ * row/tallest column on the workspace.
+ */
+static Arrangement *
+find_best_arrangement (ShellWindowLayout *layout,
+                       const WindowSize  *sizes,
+                       int                n_windows,
+                       double             area_width,
+                       double             area_height)
+{
+  Arrangement *best = NULL;
+  int last_n_columns = -1;
+  int n_rows;
+
+  for (n_rows = 1; ; n_rows++)
+    {
+      Arrangement *arrangement;
+      int n_columns = (n_windows + n_rows - 1) / n_rows;
+
+      /* If adding a new row does not change column count just stop
+       * (for instance: 9 windows, with 3 rows -> 3 columns, 4 rows ->
+       * 3 columns as well => just use 3 rows then)
+       */
+      if (n_columns == last_n_columns)
+        break;
+
+      if (n_rows > 2)
+        arrangement = compute_grid_arrangement (layout, sizes, n_windows,
+                                                n_rows, n_columns);
+      else
+        arrangement = compute_unaligned_arrangement (layout, sizes, n_windows,
+                                                     n_rows);
+
+      compute_scale_and_space (layout, arrangement, area_width, area_height);
+
+      if (!is_better_arrangement (best, arrangement))
+        {
+          arrangement_free (arrangement);
+          break;
+        }
+
+      if (best)
+        arrangement_free (best);
+      best = arrangement;
+      last_n_columns = n_columns;
+    }
+
+  best->search_width = area_width;
+  best->search_height = area_height;
+
+  return best;
+}
+
+static gboolean
+arrangement_has_sizes (Arrangement      *arrangement,
+                       const WindowSize *sizes,
+                       int               n_windows)
+{
+  return (arrangement->n_windows == n_windows &&
+          memcmp (arrangement->sizes, sizes, n_windows * sizeof (WindowSize)) == 0);
+}
+
+static Arrangement *
+get_arrangement (ShellWindowLayout *layout,
+                 const WindowSize  *sizes,
+                 int                n_windows,
+                 double             area_width,
+                 double             area_height)
+{
+  Arrangement *arrangement;
+  GList *l;
+
+  if (layout->current && arrangement_has_sizes (layout->current, sizes, n_windows))
+    return layout->current;
+
+  for (l = layout->arrangements.head; l; l = l->next)
+    {
+      arrangement = l->data;
+
+      if (arrangement->search_width == area_width &&
+          arrangement->search_height == area_height &&
+          arrangement_has_sizes (arrangement, sizes, n_windows))
+        {
+          g_queue_unlink (&layout->arrangements, l);
+          g_queue_push_head_link (&layout->arrangements, l);
+          layout->current = arrangement;
+          return arrangement;
+        }
+    }
+
+  arrangement = find_best_arrangement (layout, sizes, n_windows,
+                                       area_width, area_height);
+
+  g_queue_push_head (&layout->arrangements, arrangement);
+  if (g_queue_get_length (&layout->arrangements) > MAX_CACHED_ARRANGEMENTS)
+    arrangement_free (g_queue_pop_tail (&layout->arrangements));
+
+  layout->current = arrangement;
+
+  return arrangement;
+}
+
+/**
+ * shell_window_layout_compute_slots:
+ * @layout: the #ShellWindowLayout
+ * @windows: (element-type Clutter.Actor): the window clones to place,
+ *   in order
+ * @x: left edge of the area to place them in
+ * @y: top edge of the area to place them in
+ * @width: width of the area
+ * @height: height of the area
+ * @n_values: (out): the number of values returned
+ *
+ * Computes where each of @windows should go. Only the size of the
+ * actors is used; nothing is changed on them.
+ *
+ * Return value: (array length=n_values) (transfer full): the x, y and
+ *   scale of each window, one after another, in the order of @windows
+ */
+double *
+shell_window_layout_compute_slots (ShellWindowLayout *layout,
+                                   GList             *windows,
+                                   double             x,
+                                   double             y,
+                                   double             width,
+                                   double             height,
+                                   int               *n_values)
+{
+  Arrangement *arrangement;
+  WindowSize *sizes;
+  double *slots;
+  double row_y, total_height, base_y;
+  int n_windows, window_idx, value_idx;
+  GList *l;
+  int i, j;
+
+  g_return_val_if_fail (SHELL_IS_WINDOW_LAYOUT (layout), NULL);
+
+  n_windows = g_list_length (windows);
+  *n_values = 3 * n_windows;
+  if (n_windows == 0)
+    return NULL;
+
+  sizes = g_new (WindowSize, n_windows);
+  for (l = windows, i = 0; l; l = l->next, i++)
+    {
+      gfloat actor_width, actor_height;
+
+      clutter_actor_get_size (l->data, &actor_width, &actor_height);
+      sizes[i].width = actor_width;
+      sizes[i].height = actor_height;
+    }
+
+  arrangement = get_arrangement (layout, sizes, n_windows, width, height);
+  if (arrangement->area_width != width || arrangement->area_height != height)
+    compute_scale_and_space (layout, arrangement, width, height);
+
+  slots = g_new (double, *n_values);
+
+  /* First pass: row heights, to center the rows vertically */
+  total_height = 0;
+  for (i = 0; i < arrangement->n_rows; i++)
+    {
+      if (arrangement->grid)
+        total_height += arrangement->max_window_height * arrangement->scale;
+      else
+        total_height += arrangement->row_full_heights[i] * arrangement->scale;
+      total_height += layout->row_spacing;
+    }
+  total_height = total_height - layout->row_spacing + layout->bottom_padding;
+  base_y = (height - total_height) / 2;
+
+  row_y = y + base_y;
+  window_idx = 0;
+  value_idx = 0;
+  for (i = 0; i < arrangement->n_rows; i++)
+    {
+      double row_width, row_height, cell_width, window_x;
+
+      if (arrangement->grid)
+        {
+          row_width = arrangement->grid_width * arrangement->scale +
+                      (arrangement->max_columns - 1) * layout->column_spacing;
+          row_height = arrangement->max_window_height * arrangement->scale;
+          cell_width = arrangement->max_window_width * arrangement->scale;
+        }
+      else
+        {
+          row_width = arrangement->row_full_widths[i] * arrangement->scale +
+                      (arrangement->row_lengths[i] - 1) * layout->column_spacing;
+          row_height = arrangement->row_full_heights[i] * arrangement->scale;
+          cell_width = 0;
+        }
+
+      window_x = x + (width - row_width) / 2;
+
+      for (j = 0; j < arrangement->row_lengths[i]; j++, window_idx++)
+        {
+          double window_width, window_height, scale;
+          double slot_x = window_x;
+
+          scale = compute_window_size_and_scale (layout, &sizes[window_idx],
+                                                 arrangement->scale,
+                                                 &window_width, &window_height);
+
+          if (cell_width)
+            {
+              slot_x += (cell_width - window_width) / 2;
+              window_width = cell_width;
+            }
+
+          slots[value_idx++] = slot_x;
+          slots[value_idx++] = row_y + row_height - window_height;
+          slots[value_idx++] = scale;
+
+          window_x += window_width + layout->column_spacing;
+        }
+
+      row_y += row_height + layout->row_spacing;
+    }
+
+  g_free (sizes);
+
+  return slots;
+}
@@ -0,0 +1,51 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+#ifndef __SHELL_WINDOW_LAYOUT_H__
+#define __SHELL_WINDOW_LAYOUT_H__
+
+#include <clutter/clutter.h>
+
+/**
+ * SECTION:shell-window-layout
+ * @short_description: Arranges windows in the overview
+ *
+ * #ShellWindowLayout finds the arrangement of window clones in rows
+ * that best uses a workspace in the overview, and computes the
+ * position and scale of each clone. Arrangements are remembered for
+ * recently seen sets of window sizes, so that windows coming and
+ * going (or a drag hovering over the workspace) doesn't repeat the
+ * search.
+ */
+
+typedef struct _ShellWindowLayout      ShellWindowLayout;
+typedef struct _ShellWindowLayoutClass ShellWindowLayoutClass;
+
+#define SHELL_TYPE_WINDOW_LAYOUT              (shell_window_layout_get_type ())
+#define SHELL_WINDOW_LAYOUT(object)           (G_TYPE_CHECK_INSTANCE_CAST ((object), SHELL_TYPE_WINDOW_LAYOUT, ShellWindowLayout))
+#define SHELL_WINDOW_LAYOUT_CLASS(klass)      (G_TYPE_CHECK_CLASS_CAST ((klass), SHELL_TYPE_WINDOW_LAYOUT, ShellWindowLayoutClass))
+#define SHELL_IS_WINDOW_LAYOUT(object)        (G_TYPE_CHECK_INSTANCE_TYPE ((object), SHELL_TYPE_WINDOW_LAYOUT))
+#define SHELL_IS_WINDOW_LAYOUT_CLASS(klass)   (G_TYPE_CHECK_CLASS_TYPE ((klass), SHELL_TYPE_WINDOW_LAYOUT))
+#define SHELL_WINDOW_LAYOUT_GET_CLASS(obj)    (G_TYPE_INSTANCE_GET_CLASS ((obj), SHELL_TYPE_WINDOW_LAYOUT, ShellWindowLayoutClass))
+
+GType shell_window_layout_get_type (void) G_GNUC_CONST;
+
+ShellWindowLayout *shell_window_layout_new              (void);
+
+void               shell_window_layout_set_monitor_size (ShellWindowLayout *layout,
+                                                         double             width,
+                                                         double             height);
+void               shell_window_layout_set_spacing      (ShellWindowLayout *layout,
+                                                         double             row_spacing,
+                                                         double             column_spacing,
+                                                         double             bottom_padding);
+
+void               shell_window_layout_invalidate       (ShellWindowLayout *layout);
+
+double            *shell_window_layout_compute_slots    (ShellWindowLayout *layout,
+                                                         GList             *windows,
+                                                         double             x,
+                                                         double             y,
+                                                         double             width,
+                                                         double             height,
+                                                         int               *n_values);
+
+#endif /* __SHELL_WINDOW_LAYOUT_H__ */
@@ -0,0 +1,701 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * SECTION:shell-window-thumbnailer
+ * @short_description: Downscaled copies of window contents
+ *
+ * The overview shows every window at a fraction of its real size, but
+ * a #ClutterClone of the window texture still samples the full-size
+ * pixmap each frame. #ShellWindowThumbnailer keeps a small texture per
+ * window and size class instead, rendered from the window contents and
+ * refreshed at a limited rate when the window is damaged.
+ *
+ * The window contents are downscaled by halving them repeatedly with
+ * bilinear filtering, which averages each 2x2 block of pixels, rather
+ * than by sampling mipmaps of the window texture: for a
+ * texture-from-pixmap texture, generating mipmaps means reading the
+ * whole pixmap back from the X server each time. Shaped windows are
+ * always cloned, since the thumbnail doesn't apply the shape mask;
+ * whether a window is shaped is queried once and then only again
+ * after a ShapeNotify event for it.
+ */
+
+#include "config.h"
+
+#include <gdk/gdk.h>
+#include <clutter/x11/clutter-x11.h>
+#include <X11/extensions/Xfixes.h>
+#include <X11/extensions/shape.h>
+#include <meta/meta-shaped-texture.h>
+
+#include "shell-window-thumbnailer.h"
+
+/* Thumbnails are kept at a few fixed sizes so that clones of the same
+ * window at similar scales share a texture.
+ */
+static const int thumbnail_sizes[] = { 128, 256, 512, 1024 };
+#define N_THUMBNAIL_SIZES G_N_ELEMENTS (thumbnail_sizes)
+
+/* Damaged thumbnails are rendered again at most this often */
+#define UPDATE_INTERVAL_MS 100
+
+struct _ShellWindowThumbnailerClass
+{
+  GObjectClass parent_class;
+};
+
+struct _ShellWindowThumbnailer
+{
+  GObject parent_instance;
+
+  /* MetaWindowActor => WindowData */
+  GHashTable *windows;
+
+  /* MetaWindowActor => ShapeState */
+  GHashTable *shapes;
+  gboolean have_shape;
+  int shape_event_base;
+
+  guint update_id;
+};
+
+typedef enum {
+  SHAPE_UNKNOWN,
+  SHAPE_RECTANGULAR,
+  SHAPE_SHAPED
+} ShapeState;
+
+typedef struct _WindowData WindowData;
+
+typedef struct {
+  CoglHandle texture;
+  CoglHandle offscreen;
+} Level;
+
+typedef struct {
+  WindowData *window;
+  int max_size;
+
+  CoglHandle texture;
+  CoglHandle offscreen;
+  int width;
+  int height;
+
+  /* Intermediate Level at each halving from the window size down to
+   * within twice the thumbnail size */
+  GArray *levels;
+  int source_width;
+  int source_height;
+
+  /* ClutterTexture actors showing this thumbnail */
+  GSList *actors;
+
+  guint dirty : 1;
+} Thumbnail;
+
+struct _WindowData {
+  ShellWindowThumbnailer *thumbnailer;
+  MetaWindowActor *window_actor;
+  ClutterActor *shaped_texture;
+
+  guint queue_redraw_id;
+
+  Thumbnail *thumbnails[N_THUMBNAIL_SIZES];
+};
+
+G_DEFINE_TYPE (ShellWindowThumbnailer, shell_window_thumbnailer, G_TYPE_OBJECT);
+
+static void on_window_actor_destroy (ClutterActor *actor,
+                                     WindowData   *window);
+static void on_thumbnail_actor_destroy (ClutterActor *actor,
+                                        Thumbnail    *thumbnail);
+
+/* Allocates a texture along with an offscreen framebuffer rendering to
+ * it; on failure, both are left invalid.
+ */
+static gboolean
+level_init (Level *level,
+            int    width,
+            int    height)
+{
+  level->offscreen = COGL_INVALID_HANDLE;
+  level->texture = cogl_texture_new_with_size (width, height,
+                                               COGL_TEXTURE_NO_SLICING,
+                                               COGL_PIXEL_FORMAT_RGBA_8888_PRE);
+  if (level->texture == COGL_INVALID_HANDLE)
+    return FALSE;
+
+  level->offscreen = cogl_offscreen_new_to_texture (level->texture);
+  if (level->offscreen == COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (level->texture);
+      level->texture = COGL_INVALID_HANDLE;
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+level_clear (Level *level)
+{
+  if (level->offscreen != COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (level->offscreen);
+      level->offscreen = COGL_INVALID_HANDLE;
+    }
+
+  if (level->texture != COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (level->texture);
+      level->texture = COGL_INVALID_HANDLE;
+    }
+}
+
+static void
+thumbnail_release_texture (Thumbnail *thumbnail)
+{
+  guint i;
+
+  if (thumbnail->offscreen != COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (thumbnail->offscreen);
+      thumbnail->offscreen = COGL_INVALID_HANDLE;
+    }
+
+  if (thumbnail->texture != COGL_INVALID_HANDLE)
+    {
+      cogl_handle_unref (thumbnail->texture);
+      thumbnail->texture = COGL_INVALID_HANDLE;
+    }
+
+  if (thumbnail->levels != NULL)
+    {
+      for (i = 0; i < thumbnail->levels->len; i++)
+        level_clear (&g_array_index (thumbnail->levels, Level, i));
+      g_array_free (thumbnail->levels, TRUE);
+      thumbnail->levels = NULL;
+    }
+}
+
+static void
+thumbnail_free (Thumbnail *thumbnail)
+{
+  GSList *l;
+
+  for (l = thumbnail->actors; l; l = l->next)
+    g_signal_handlers_disconnect_by_func (l->data,
+                                          on_thumbnail_actor_destroy,
+                                          thumbnail);
+  g_slist_free (thumbnail->actors);
+
+  thumbnail_release_texture (thumbnail);
+  g_slice_free (Thumbnail, thumbnail);
+}
+
+static void
+window_data_free (WindowData *window)
+{
+  guint i;
+
+  for (i = 0; i < N_THUMBNAIL_SIZES; i++)
+    if (window->thumbnails[i] != NULL)
+      thumbnail_free (window->thumbnails[i]);
+
+  if (window->queue_redraw_id != 0)
+    g_signal_handler_disconnect (window->shaped_texture, window->queue_redraw_id);
+  g_signal_handlers_disconnect_by_func (window->window_actor,
+                                        on_window_actor_destroy,
+                                        window);
+
+  g_slice_free (WindowData, window);
+}
+
+static void
+window_data_maybe_free (WindowData *window)
+{
+  guint i;
+
+  for (i = 0; i < N_THUMBNAIL_SIZES; i++)
+    if (window->thumbnails[i] != NULL)
+      return;
+
+  g_hash_table_remove (window->thumbnailer->windows, window->window_actor);
+}
+
+static CoglHandle
+get_window_texture (WindowData *window)
+{
+  return meta_shaped_texture_get_texture (META_SHAPED_TEXTURE (window->shaped_texture));
+}
+
+/* Whether the bounding shape of the window is anything other than its
+ * full rectangle; this takes a few round trips to the X server */
+static gboolean
+query_window_shaped (MetaWindowActor *window_actor)
+{
+  Display *xdisplay = clutter_x11_get_default_display ();
+  Window xwindow = meta_window_actor_get_x_window (window_actor);
+  XserverRegion region;
+  XRectangle *rects;
+  Window root;
+  int x, y;
+  unsigned int width, height, border_width, depth;
+  int n_rects = 0;
+  gboolean shaped;
+
+  gdk_error_trap_push ();
+
+  /* Mutter already selects this for the windows it composites, on the
+   * same connection; this only makes sure we get told of changes */
+  XShapeSelectInput (xdisplay, xwindow, ShapeNotifyMask);
+
+  if (!XGetGeometry (xdisplay, xwindow, &root, &x, &y,
+                     &width, &height, &border_width, &depth))
+    {
+      gdk_error_trap_pop_ignored ();
+      return FALSE;
+    }
+
+  region = XFixesCreateRegionFromWindow (xdisplay, xwindow, WindowRegionBounding);
+  rects = XFixesFetchRegion (xdisplay, region, &n_rects);
+  XFixesDestroyRegion (xdisplay, region);
+
+  gdk_error_trap_pop_ignored ();
+
+  /* The bounding region is relative to the window origin and includes
+   * the border */
+  shaped = !(n_rects == 1 &&
+             rects[0].x <= 0 && rects[0].y <= 0 &&
+             rects[0].x + rects[0].width >= (int) width &&
+             rects[0].y + rects[0].height >= (int) height);
+
+  if (rects != NULL)
+    XFree (rects);
+
+  return shaped;
+}
+
+static void
+on_shape_window_destroy (ClutterActor           *actor,
+                         ShellWindowThumbnailer *thumbnailer)
+{
+  g_hash_table_remove (thumbnailer->shapes, actor);
+}
+
+static gboolean
+window_is_shaped (ShellWindowThumbnailer *thumbnailer,
+                  MetaWindowActor        *window_actor)
+{
+  gpointer value = NULL;
+  ShapeState state;
+
+  if (!thumbnailer->have_shape)
+    return FALSE;
+
+  if (!g_hash_table_lookup_extended (thumbnailer->shapes, window_actor, NULL, &value))
+    g_signal_connect (window_actor, "destroy",
+                      G_CALLBACK (on_shape_window_destroy), thumbnailer);
+
+  state = GPOINTER_TO_INT (value);
+  if (state == SHAPE_UNKNOWN)
+    {
+      state = query_window_shaped (window_actor) ? SHAPE_SHAPED : SHAPE_RECTANGULAR;
+      g_hash_table_insert (thumbnailer->shapes, window_actor, GINT_TO_POINTER (state));
+    }
+
+  return state == SHAPE_SHAPED;
+}
+
+static ClutterX11FilterReturn
+thumbnailer_event_filter (XEvent       *xev,
+                          ClutterEvent *cev,
+                          gpointer      data)
+{
+  ShellWindowThumbnailer *thumbnailer = data;
+  XShapeEvent *shape_event;
+  GHashTableIter iter;
+  gpointer window_actor;
+
+  if (xev->xany.type != thumbnailer->shape_event_base + ShapeNotify)
+    return CLUTTER_X11_FILTER_CONTINUE;
+
+  shape_event = (XShapeEvent *) xev;
+  if (shape_event->kind != ShapeBounding)
+    return CLUTTER_X11_FILTER_CONTINUE;
+
+  g_hash_table_iter_init (&iter, thumbnailer->shapes);
+  while (g_hash_table_iter_next (&iter, &window_actor, NULL))
+    {
+      if (meta_window_actor_get_x_window (window_actor) == shape_event->window)
+        {
+          g_hash_table_iter_replace (&iter, GINT_TO_POINTER (SHAPE_UNKNOWN));
+          break;
+        }
+    }
+
+  return CLUTTER_X11_FILTER_CONTINUE;
+}
+
+/* Draws all of @source into @offscreen, of size @width x @height, with
+ * bilinear filtering */
+static void
+draw_scaled (CoglHandle source,
+             CoglHandle offscreen,
+             int        width,
+             int        height)
+{
+  CoglHandle material;
+  CoglColor clear_color;
+
+  material = cogl_material_new ();
+  cogl_material_set_layer (material, 0, source);
+  cogl_material_set_layer_filters (material, 0,
+                                   COGL_MATERIAL_FILTER_LINEAR,
+                                   COGL_MATERIAL_FILTER_LINEAR);
+  cogl_material_set_layer_wrap_mode (material, 0,
+                                     COGL_MATERIAL_WRAP_MODE_CLAMP_TO_EDGE);
+
+  cogl_color_set_from_4ub (&clear_color, 0, 0, 0, 0);
+
+  cogl_push_framebuffer (offscreen);
+  cogl_clear (&clear_color, COGL_BUFFER_BIT_COLOR);
+  cogl_set_viewport (0, 0, width, height);
+  cogl_ortho (0, width, height, 0, 0.0, 1.0);
+  cogl_set_source (material);
+  cogl_rectangle (0, 0, width, height);
+  cogl_pop_framebuffer ();
+
+  cogl_handle_unref (material);
+}
+
+/* Renders the current window contents into the thumbnail texture,
+ * reallocating it if the window changed size. Returns %FALSE if the
+ * window has no contents yet.
+ */
+static gboolean
+thumbnail_update (Thumbnail *thumbnail)
+{
+  CoglHandle source;
+  int source_width, source_height;
+  int width, height;
+  int level_width, level_height;
+  double scale;
+  GSList *l;
+  guint i;
+
+  source = get_window_texture (thumbnail->window);
+  if (source == COGL_INVALID_HANDLE)
+    return FALSE;
+
+  source_width = cogl_texture_get_width (source);
+  source_height = cogl_texture_get_height (source);
+  if (source_width == 0 || source_height == 0)
+    return FALSE;
+
+  scale = (double) thumbnail->max_size / MAX (source_width, source_height);
+  width = MAX (1, (int) (source_width * scale + 0.5));
+  height = MAX (1, (int) (source_height * scale + 0.5));
+
+  if (thumbnail->texture == COGL_INVALID_HANDLE ||
+      source_width != thumbnail->source_width ||
+      source_height != thumbnail->source_height)
+    {
+      Level level;
+
+      thumbnail_release_texture (thumbnail);
+
+      if (!level_init (&level, width, height))
+        return FALSE;
+
+      thumbnail->texture = level.texture;
+      thumbnail->offscreen = level.offscreen;
+      thumbnail->width = width;
+      thumbnail->height = height;
+
+      /* Each intermediate level is half the size of the previous one,
+       * so that a single bilinear sample averages a 2x2 block of it;
+       * the last one is less than twice the thumbnail size.
+       */
+      thumbnail->levels = g_array_new (FALSE, FALSE, sizeof (Level));
+      level_width = source_width;
+      level_height = source_height;
+      while (level_width > 2 * width || level_height > 2 * height)
+        {
+          level_width = MAX (width, (level_width + 1) / 2);
+          level_height = MAX (height, (level_height + 1) / 2);
+
+          if (!level_init (&level, level_width, level_height))
+            {
+              thumbnail_release_texture (thumbnail);
+              return FALSE;
+            }
+          g_array_append_val (thumbnail->levels, level);
+        }
+
+      thumbnail->source_width = source_width;
+      thumbnail->source_height = source_height;
+
+      for (l = thumbnail->actors; l; l = l->next)
+        clutter_texture_set_cogl_texture (l->data, thumbnail->texture);
+    }
+
+  for (i = 0; i < thumbnail->levels->len; i++)
+    {
+      Level *level = &g_array_index (thumbnail->levels, Level, i);
+
+      draw_scaled (source, level->offscreen,
+                   cogl_texture_get_width (level->texture),
+                   cogl_texture_get_height (level->texture));
+      source = level->texture;
+    }
+
+  draw_scaled (source, thumbnail->offscreen, width, height);
+
+  thumbnail->dirty = FALSE;
+
+  /* Keep the natural size of the actors at the size of the window so
+   * that callers can position and scale them like a clone.
+   */
+  for (l = thumbnail->actors; l; l = l->next)
+    {
+      clutter_actor_set_size (l->data, source_width, source_height);
+      clutter_actor_queue_redraw (l->data);
+    }
+
+  return TRUE;
+}
+
+static gboolean
+update_thumbnails (gpointer data)
+{
+  ShellWindowThumbnailer *thumbnailer = data;
+  GHashTableIter iter;
+  WindowData *window;
+  guint i;
+
+  thumbnailer->update_id = 0;
+
+  g_hash_table_iter_init (&iter, thumbnailer->windows);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&window))
+    {
+      for (i = 0; i < N_THUMBNAIL_SIZES; i++)
+        if (window->thumbnails[i] != NULL && window->thumbnails[i]->dirty)
+          thumbnail_update (window->thumbnails[i]);
+    }
+
+  return FALSE;
+}
+
+static void
+on_shaped_texture_queue_redraw (ClutterActor *actor,
+                                ClutterActor *origin,
+                                WindowData   *window)
+{
+  ShellWindowThumbnailer *thumbnailer = window->thumbnailer;
+  guint i;
+
+  for (i = 0; i < N_THUMBNAIL_SIZES; i++)
+    if (window->thumbnails[i] != NULL)
+      window->thumbnails[i]->dirty = TRUE;
+
+  if (thumbnailer->update_id == 0)
+    thumbnailer->update_id = g_timeout_add (UPDATE_INTERVAL_MS,
+                                            update_thumbnails,
+                                            thumbnailer);
+}
+
+static void
+on_window_actor_destroy (ClutterActor *actor,
+                         WindowData   *window)
+{
+  g_hash_table_remove (window->thumbnailer->windows, actor);
+}
+
+static void
+on_thumbnail_actor_destroy (ClutterActor *actor,
+                            Thumbnail    *thumbnail)
+{
+  WindowData *window = thumbnail->window;
+  guint i;
+
+  thumbnail->actors = g_slist_remove (thumbnail->actors, actor);
+  if (thumbnail->actors != NULL)
+    return;
+
+  for (i = 0; i < N_THUMBNAIL_SIZES; i++)
+    if (window->thumbnails[i] == thumbnail)
+      window->thumbnails[i] = NULL;
+
+  thumbnail_free (thumbnail);
+  window_data_maybe_free (window);
+}
+
+static WindowData *
+get_window_data (ShellWindowThumbnailer *thumbnailer,
+                 MetaWindowActor        *window_actor)
+{
+  WindowData *window;
+
+  window = g_hash_table_lookup (thumbnailer->windows, window_actor);
+  if (window != NULL)
+    return window;
+
+  window = g_slice_new0 (WindowData);
+  window->thumbnailer = thumbnailer;
+  window->window_actor = window_actor;
+  window->shaped_texture = meta_window_actor_get_texture (window_actor);
+
+  window->queue_redraw_id =
+    g_signal_connect (window->shaped_texture, "queue-redraw",
+                      G_CALLBACK (on_shaped_texture_queue_redraw), window);
+  g_signal_connect (window_actor, "destroy",
+                    G_CALLBACK (on_window_actor_destroy), window);
+
+  g_hash_table_insert (thumbnailer->windows, window_actor, window);
+
+  return window;
+}
+
+static void
+shell_window_thumbnailer_init (ShellWindowThumbnailer *thumbnailer)
+{
+  int shape_error_base;
+
+  thumbnailer->windows = g_hash_table_new_full (NULL, NULL, NULL,
+                                                (GDestroyNotify) window_data_free);
+  thumbnailer->shapes = g_hash_table_new (NULL, NULL);
+
+  thumbnailer->have_shape = XShapeQueryExtension (clutter_x11_get_default_display (),
+                                                  &thumbnailer->shape_event_base,
+                                                  &shape_error_base);
+  if (thumbnailer->have_shape)
+    clutter_x11_add_filter (thumbnailer_event_filter, thumbnailer);
+}
+
+static void
+shell_window_thumbnailer_finalize (GObject *object)
+{
+  ShellWindowThumbnailer *thumbnailer = SHELL_WINDOW_THUMBNAILER (object);
+  GHashTableIter iter;
+  gpointer window_actor;
+
+  if (thumbnailer->update_id != 0)
+    g_source_remove (thumbnailer->update_id);
+
+  if (thumbnailer->have_shape)
+    clutter_x11_remove_filter (thumbnailer_event_filter, thumbnailer);
+
+  g_hash_table_iter_init (&iter, thumbnailer->shapes);
+  while (g_hash_table_iter_next (&iter, &window_actor, NULL))
+    g_signal_handlers_disconnect_by_func (window_actor,
+                                          on_shape_window_destroy,
+                                          thumbnailer);
+  g_hash_table_destroy (thumbnailer->shapes);
+
+  g_hash_table_destroy (thumbnailer->windows);
+
+  G_OBJECT_CLASS (shell_window_thumbnailer_parent_class)->finalize (object);
+}
+
+static void
+shell_window_thumbnailer_class_init (ShellWindowThumbnailerClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->finalize = shell_window_thumbnailer_finalize;
+}
+
+/**
+ * shell_window_thumbnailer_get_default:
+ *
+ * Return Value: (transfer none): The global #ShellWindowThumbnailer singleton
+ */
+ShellWindowThumbnailer *
+shell_window_thumbnailer_get_default (void)
+{
+  static ShellWindowThumbnailer *instance = NULL;
+
+  if (instance == NULL)
+    instance = g_object_new (SHELL_TYPE_WINDOW_THUMBNAILER, NULL);
+
+  return instance;
+}
+
+/**
+ * shell_window_thumbnailer_get_thumbnail:
+ * @thumbnailer: the #ShellWindowThumbnailer
+ * @window_actor: the window to show
+ * @max_size: the largest width or height the thumbnail will be shown at
+ *
+ * Creates an actor showing the contents of @window_actor, which can be
+ * used in place of a #ClutterClone of its texture. The actor's size
+ * follows the size of the window, but when the window is larger than
+ * @max_size it is backed by a downscaled copy that is only refreshed a
+ * few times per second.
+ *
+ * Return value: (transfer floating): a new #ClutterActor
+ */
+ClutterActor *
+shell_window_thumbnailer_get_thumbnail (ShellWindowThumbnailer *thumbnailer,
+                                        MetaWindowActor        *window_actor,
+                                        int                     max_size)
+{
+  WindowData *window;
+  Thumbnail *thumbnail;
+  ClutterActor *actor;
+  CoglHandle source;
+  guint i;
+
+  g_return_val_if_fail (SHELL_IS_WINDOW_THUMBNAILER (thumbnailer), NULL);
+  g_return_val_if_fail (META_IS_WINDOW_ACTOR (window_actor), NULL);
+
+  for (i = 0; i < N_THUMBNAIL_SIZES - 1; i++)
+    if (thumbnail_sizes[i] >= max_size)
+      break;
+
+  /* Windows that already fit, or that have no contents yet, are cheap
+   * enough to clone directly. Shaped windows are cloned so that their
+   * shape mask applies.
+   */
+  source = meta_shaped_texture_get_texture (META_SHAPED_TEXTURE (meta_window_actor_get_texture (window_actor)));
+  if (source == COGL_INVALID_HANDLE ||
+      MAX (cogl_texture_get_width (source),
+           cogl_texture_get_height (source)) <= thumbnail_sizes[i] ||
+      window_is_shaped (thumbnailer, window_actor))
+    return clutter_clone_new (meta_window_actor_get_texture (window_actor));
+
+  window = get_window_data (thumbnailer, window_actor);
+
+  thumbnail = window->thumbnails[i];
+  if (thumbnail == NULL)
+    {
+      thumbnail = g_slice_new0 (Thumbnail);
+      thumbnail->window = window;
+      thumbnail->max_size = thumbnail_sizes[i];
+
+      if (!thumbnail_update (thumbnail))
+        {
+          thumbnail_free (thumbnail);
+          window_data_maybe_free (window);
+          return clutter_clone_new (meta_window_actor_get_texture (window_actor));
+        }
+
+      window->thumbnails[i] = thumbnail;
+    }
+
+  actor = g_object_new (CLUTTER_TYPE_TEXTURE,
+                        "sync-size", FALSE,
+                        "keep-aspect-ratio", FALSE,
+                        NULL);
+  clutter_texture_set_cogl_texture (CLUTTER_TEXTURE (actor), thumbnail->texture);
+  clutter_actor_set_size (actor,
+                          cogl_texture_get_width (source),
+                          cogl_texture_get_height (source));
+
+  thumbnail->actors = g_slist_prepend (thumbnail->actors, actor);
+  g_signal_connect (actor, "destroy",
+                    G_CALLBACK (on_thumbnail_actor_destroy), thumbnail);
+
+  return actor;
+}
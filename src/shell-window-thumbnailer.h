@@ -0,0 +1,30 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+#ifndef __SHELL_WINDOW_THUMBNAILER_H__
+#define __SHELL_WINDOW_THUMBNAILER_H__
+
+#include <clutter/clutter.h>
+#include <meta/meta-window-actor.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ShellWindowThumbnailer      ShellWindowThumbnailer;
+typedef struct _ShellWindowThumbnailerClass ShellWindowThumbnailerClass;
+
+#define SHELL_TYPE_WINDOW_THUMBNAILER              (shell_window_thumbnailer_get_type ())
+#define SHELL_WINDOW_THUMBNAILER(object)           (G_TYPE_CHECK_INSTANCE_CAST ((object), SHELL_TYPE_WINDOW_THUMBNAILER, ShellWindowThumbnailer))
+#define SHELL_WINDOW_THUMBNAILER_CLASS(klass)      (G_TYPE_CHECK_CLASS_CAST ((klass), SHELL_TYPE_WINDOW_THUMBNAILER, ShellWindowThumbnailerClass))
+#define SHELL_IS_WINDOW_THUMBNAILER(object)        (G_TYPE_CHECK_INSTANCE_TYPE ((object), SHELL_TYPE_WINDOW_THUMBNAILER))
+#define SHELL_IS_WINDOW_THUMBNAILER_CLASS(klass)   (G_TYPE_CHECK_CLASS_TYPE ((klass), SHELL_TYPE_WINDOW_THUMBNAILER))
+#define SHELL_WINDOW_THUMBNAILER_GET_CLASS(object) (G_TYPE_INSTANCE_GET_CLASS ((object), SHELL_TYPE_WINDOW_THUMBNAILER, ShellWindowThumbnailerClass))
+
+GType shell_window_thumbnailer_get_type (void) G_GNUC_CONST;
+
+ShellWindowThumbnailer *shell_window_thumbnailer_get_default   (void);
+
+ClutterActor           *shell_window_thumbnailer_get_thumbnail (ShellWindowThumbnailer *thumbnailer,
+                                                                MetaWindowActor        *window_actor,
+                                                                int                     max_size);
+
+G_END_DECLS
+
+#endif /* __SHELL_WINDOW_THUMBNAILER_H__ */
@@ -0,0 +1,361 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+#include "config.h"
+
+#include <clutter/clutter.h>
+
+#include "shell-global.h"
+#include "shell-perf-log.h"
+#include "shell-work-scheduler.h"
+
+/* Time spent on work before each repaint, in microseconds. At least one
+ * piece of work is done per frame however long it takes. */
+#define FRAME_BUDGET_US 5000
+
+struct _ShellWorkSchedulerClass
+{
+  GObjectClass parent_class;
+};
+
+struct _ShellWorkScheduler
+{
+  GObject parent_instance;
+
+  /* WorkItem *, sorted by priority, then in the order they were added */
+  GQueue items;
+  guint last_id;
+
+  /* stage name => StageInfo */
+  GHashTable *stages;
+
+  /* Set while there is pending work; the repaint function is installed
+   * and we count as ongoing work for shell_global_run_at_leisure() */
+  guint repaint_func_id;
+  gboolean running;
+
+  /* Queues the frames the remaining work runs in, after each paint */
+  guint post_paint_func_id;
+};
+
+typedef struct {
+  char *name;
+  guint n_pending;
+  gint64 elapsed_us;
+} StageInfo;
+
+typedef struct {
+  guint id;
+  int priority;
+  StageInfo *stage;
+
+  ShellWorkFunc func;
+  gpointer user_data;
+  GDestroyNotify notify;
+} WorkItem;
+
+G_DEFINE_TYPE (ShellWorkScheduler, shell_work_scheduler, G_TYPE_OBJECT);
+
+static void
+stage_info_free (StageInfo *stage)
+{
+  g_free (stage->name);
+  g_slice_free (StageInfo, stage);
+}
+
+static StageInfo *
+get_stage (ShellWorkScheduler *scheduler,
+           const char         *name)
+{
+  StageInfo *stage = g_hash_table_lookup (scheduler->stages, name);
+
+  if (stage == NULL)
+    {
+      stage = g_slice_new0 (StageInfo);
+      stage->name = g_strdup (name);
+      g_hash_table_insert (scheduler->stages, stage->name, stage);
+
+      shell_perf_log_define_event (shell_perf_log_get_default (),
+                                   name,
+                                   "Time spent building this stage across frames, in microseconds",
+                                   "x");
+    }
+
+  return stage;
+}
+
+static void
+queue_frame (void)
+{
+  ClutterActor *stage = CLUTTER_ACTOR (shell_global_get_stage (shell_global_get ()));
+
+  clutter_actor_queue_redraw (stage);
+}
+
+/* Removes @link from the queue. The stage of a finished item is logged
+ * when it was the last one; if the last one was cancelled instead, the
+ * stage's time is discarded.
+ */
+static void
+remove_item (ShellWorkScheduler *scheduler,
+             GList              *link,
+             gboolean            finished)
+{
+  WorkItem *item = link->data;
+  StageInfo *stage = item->stage;
+
+  g_queue_delete_link (&scheduler->items, link);
+
+  stage->n_pending--;
+  if (stage->n_pending == 0)
+    {
+      if (finished)
+        shell_perf_log_event_x (shell_perf_log_get_default (),
+                                stage->name, stage->elapsed_us);
+      stage->elapsed_us = 0;
+    }
+
+  if (item->notify)
+    item->notify (item->user_data);
+  g_slice_free (WorkItem, item);
+}
+
+static GList *
+find_item (ShellWorkScheduler *scheduler,
+           guint               id)
+{
+  GList *l;
+
+  for (l = scheduler->items.head; l; l = l->next)
+    {
+      WorkItem *item = l->data;
+
+      if (item->id == id)
+        return l;
+    }
+
+  return NULL;
+}
+
+static gboolean
+run_work (gpointer data)
+{
+  ShellWorkScheduler *scheduler = data;
+  gint64 start, now;
+
+  start = now = g_get_monotonic_time ();
+
+  scheduler->running = TRUE;
+
+  while (!g_queue_is_empty (&scheduler->items))
+    {
+      GList *link = scheduler->items.head;
+      WorkItem *item = link->data;
+      guint id = item->id;
+      StageInfo *stage = item->stage;
+      gboolean more;
+      gint64 item_start = now;
+
+      more = item->func (item->user_data);
+
+      now = g_get_monotonic_time ();
+      stage->elapsed_us += now - item_start;
+
+      /* The function may have removed itself, or other items */
+      link = find_item (scheduler, id);
+      if (link && !more)
+        remove_item (scheduler, link, TRUE);
+
+      if (now - start >= FRAME_BUDGET_US)
+        break;
+    }
+
+  scheduler->running = FALSE;
+
+  if (g_queue_is_empty (&scheduler->items))
+    {
+      scheduler->repaint_func_id = 0;
+      shell_global_end_work (shell_global_get ());
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Makes sure there is another frame to continue the work in, even if
+ * nothing else on the stage is changing. A redraw queued before the
+ * paint, from run_work(), would be taken by the frame being painted.
+ * This removes itself once the queue is empty: a repaint function
+ * can't be removed while the repaint functions are being run, as
+ * during run_work().
+ */
+static gboolean
+queue_next_frame (gpointer data)
+{
+  ShellWorkScheduler *scheduler = data;
+
+  if (g_queue_is_empty (&scheduler->items))
+    {
+      scheduler->post_paint_func_id = 0;
+      return FALSE;
+    }
+
+  queue_frame ();
+
+  return TRUE;
+}
+
+static void
+shell_work_scheduler_init (ShellWorkScheduler *scheduler)
+{
+  g_queue_init (&scheduler->items);
+  scheduler->stages = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                             NULL,
+                                             (GDestroyNotify) stage_info_free);
+}
+
+static void
+shell_work_scheduler_finalize (GObject *object)
+{
+  ShellWorkScheduler *scheduler = SHELL_WORK_SCHEDULER (object);
+
+  while (!g_queue_is_empty (&scheduler->items))
+    remove_item (scheduler, scheduler->items.head, FALSE);
+
+  if (scheduler->repaint_func_id != 0)
+    {
+      clutter_threads_remove_repaint_func (scheduler->repaint_func_id);
+      shell_global_end_work (shell_global_get ());
+    }
+
+  if (scheduler->post_paint_func_id != 0)
+    clutter_threads_remove_repaint_func (scheduler->post_paint_func_id);
+
+  g_hash_table_destroy (scheduler->stages);
+
+  G_OBJECT_CLASS (shell_work_scheduler_parent_class)->finalize (object);
+}
+
+static void
+shell_work_scheduler_class_init (ShellWorkSchedulerClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->finalize = shell_work_scheduler_finalize;
+}
+
+/**
+ * shell_work_scheduler_get_default:
+ *
+ * Return Value: (transfer none): The global #ShellWorkScheduler singleton
+ */
+ShellWorkScheduler *
+shell_work_scheduler_get_default (void)
+{
+  static ShellWorkScheduler *instance = NULL;
+
+  if (instance == NULL)
+    instance = g_object_new (SHELL_TYPE_WORK_SCHEDULER, NULL);
+
+  return instance;
+}
+
+/**
+ * shell_work_scheduler_add:
+ * @scheduler: the #ShellWorkScheduler
+ * @stage: name of the stage the work belongs to, used as perf event name
+ * @priority: work with lower values runs first
+ * @func: (scope notified): function doing the work
+ * @user_data: data to pass to @func
+ * @notify: function to call to free @user_data
+ *
+ * Schedules @func to be called before the following frames, until it
+ * returns %FALSE. Pending work counts as ongoing work for
+ * shell_global_run_at_leisure().
+ *
+ * Return value: an id that can be passed to shell_work_scheduler_remove()
+ */
+guint
+shell_work_scheduler_add (ShellWorkScheduler *scheduler,
+                          const char         *stage,
+                          int                 priority,
+                          ShellWorkFunc       func,
+                          gpointer            user_data,
+                          GDestroyNotify      notify)
+{
+  WorkItem *item;
+  GList *l;
+
+  g_return_val_if_fail (SHELL_IS_WORK_SCHEDULER (scheduler), 0);
+  g_return_val_if_fail (stage != NULL, 0);
+  g_return_val_if_fail (func != NULL, 0);
+
+  item = g_slice_new (WorkItem);
+  item->id = ++scheduler->last_id;
+  item->priority = priority;
+  item->stage = get_stage (scheduler, stage);
+  item->func = func;
+  item->user_data = user_data;
+  item->notify = notify;
+
+  item->stage->n_pending++;
+
+  if (scheduler->repaint_func_id == 0)
+    {
+      shell_global_begin_work (shell_global_get ());
+
+      scheduler->repaint_func_id =
+        clutter_threads_add_repaint_func_full (CLUTTER_REPAINT_FLAGS_PRE_PAINT,
+                                               run_work, scheduler, NULL);
+      queue_frame ();
+    }
+
+  if (scheduler->post_paint_func_id == 0)
+    scheduler->post_paint_func_id =
+      clutter_threads_add_repaint_func_full (CLUTTER_REPAINT_FLAGS_POST_PAINT,
+                                             queue_next_frame, scheduler, NULL);
+
+  for (l = scheduler->items.head; l; l = l->next)
+    {
+      WorkItem *other = l->data;
+
+      if (other->priority > priority)
+        break;
+    }
+
+  if (l)
+    g_queue_insert_before (&scheduler->items, l, item);
+  else
+    g_queue_push_tail (&scheduler->items, item);
+
+  return item->id;
+}
+
+/**
+ * shell_work_scheduler_remove:
+ * @scheduler: the #ShellWorkScheduler
+ * @id: an id returned by shell_work_scheduler_add()
+ *
+ * Cancels work that hasn't finished yet. Does nothing if it has.
+ */
+void
+shell_work_scheduler_remove (ShellWorkScheduler *scheduler,
+                             guint               id)
+{
+  GList *link;
+
+  g_return_if_fail (SHELL_IS_WORK_SCHEDULER (scheduler));
+
+  link = find_item (scheduler, id);
+  if (link == NULL)
+    return;
+
+  remove_item (scheduler, link, FALSE);
+
+  /* While running, run_work() takes care of this when it returns */
+  if (g_queue_is_empty (&scheduler->items) && !scheduler->running)
+    {
+      clutter_threads_remove_repaint_func (scheduler->repaint_func_id);
+      scheduler->repaint_func_id = 0;
+      shell_global_end_work (shell_global_get ());
+    }
+}
@@ -0,0 +1,52 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+#ifndef __SHELL_WORK_SCHEDULER_H__
+#define __SHELL_WORK_SCHEDULER_H__
+
+#include <glib-object.h>
+
+/**
+ * SECTION:shell-work-scheduler
+ * @short_description: Spreads construction work across frames
+ *
+ * #ShellWorkScheduler runs pieces of work before stage repaints, in
+ * priority order, stopping each frame once a time budget is used up so
+ * that animations running at the same time stay smooth. Each piece of
+ * work belongs to a named stage; when the last piece of a stage is done
+ * the time spent on it is logged as a perf event with the stage name.
+ */
+
+typedef struct _ShellWorkScheduler      ShellWorkScheduler;
+typedef struct _ShellWorkSchedulerClass ShellWorkSchedulerClass;
+
+#define SHELL_TYPE_WORK_SCHEDULER              (shell_work_scheduler_get_type ())
+#define SHELL_WORK_SCHEDULER(object)           (G_TYPE_CHECK_INSTANCE_CAST ((object), SHELL_TYPE_WORK_SCHEDULER, ShellWorkScheduler))
+#define SHELL_WORK_SCHEDULER_CLASS(klass)      (G_TYPE_CHECK_CLASS_CAST ((klass), SHELL_TYPE_WORK_SCHEDULER, ShellWorkSchedulerClass))
+#define SHELL_IS_WORK_SCHEDULER(object)        (G_TYPE_CHECK_INSTANCE_TYPE ((object), SHELL_TYPE_WORK_SCHEDULER))
+#define SHELL_IS_WORK_SCHEDULER_CLASS(klass)   (G_TYPE_CHECK_CLASS_TYPE ((klass), SHELL_TYPE_WORK_SCHEDULER))
+#define SHELL_WORK_SCHEDULER_GET_CLASS(obj)    (G_TYPE_INSTANCE_GET_CLASS ((obj), SHELL_TYPE_WORK_SCHEDULER, ShellWorkSchedulerClass))
+
+/**
+ * ShellWorkFunc:
+ * @user_data: data passed to shell_work_scheduler_add()
+ *
+ * Does one piece of work.
+ *
+ * Return value: %TRUE if there is more work left and the function
+ *   should be called again, %FALSE if it is done
+ */
+typedef gboolean (*ShellWorkFunc) (gpointer user_data);
+
+GType shell_work_scheduler_get_type (void) G_GNUC_CONST;
+
+ShellWorkScheduler *shell_work_scheduler_get_default (void);
+
+guint               shell_work_scheduler_add         (ShellWorkScheduler *scheduler,
+                                                      const char         *stage,
+                                                      int                 priority,
+                                                      ShellWorkFunc       func,
+                                                      gpointer            user_data,
+                                                      GDestroyNotify      notify);
+void                shell_work_scheduler_remove      (ShellWorkScheduler *scheduler,
+                                                      guint               id);
+
+#endif /* __SHELL_WORK_SCHEDULER_H__ */
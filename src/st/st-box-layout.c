@@ -880,6 +880,58 @@ get_border_paint_offsets (StBoxLayout *self,
     *y = 0;
 }
 
+/* Whether @child could draw anything inside @viewport, which is in the
+ * coordinate space of the box's children. Children without a known
+ * paint volume are always considered visible.
+ */
+static gboolean
+child_is_in_viewport (ClutterActor          *actor,
+                      ClutterActor          *child,
+                      const ClutterActorBox *viewport)
+{
+  const ClutterPaintVolume *volume;
+  ClutterVertex origin;
+  float width, height;
+
+  if (!CLUTTER_ACTOR_IS_VISIBLE (child))
+    return FALSE;
+
+  volume = clutter_actor_get_transformed_paint_volume (child, actor);
+  if (volume == NULL)
+    return TRUE;
+
+  clutter_paint_volume_get_origin (volume, &origin);
+  width = clutter_paint_volume_get_width (volume);
+  height = clutter_paint_volume_get_height (volume);
+
+  return (origin.x < viewport->x2 && origin.x + width > viewport->x1 &&
+          origin.y < viewport->y2 && origin.y + height > viewport->y1);
+}
+
+/* Paints the children of a box, skipping the ones that are scrolled
+ * out of the viewport; this is shared between paint and pick, as
+ * clutter_actor_paint() does the right thing in both cases.
+ */
+static void
+paint_children (StBoxLayout           *self,
+                const ClutterActorBox *viewport)
+{
+  StBoxLayoutPrivate *priv = self->priv;
+  ClutterActor *actor = CLUTTER_ACTOR (self);
+  ClutterActor *child;
+  gboolean scrolled = priv->hadjustment || priv->vadjustment;
+
+  for (child = clutter_actor_get_first_child (actor);
+       child != NULL;
+       child = clutter_actor_get_next_sibling (child))
+    {
+      if (scrolled && !child_is_in_viewport (actor, child, viewport))
+        continue;
+
+      _st_statistics_increment (ST_STATISTIC_PAINTED_CHILDREN);
+      clutter_actor_paint (child);
+    }
+}
 
 static void
 st_box_layout_paint (ClutterActor *actor)
@@ -890,7 +942,6 @@ st_box_layout_paint (ClutterActor *actor)
   gdouble x, y;
   ClutterActorBox allocation_box;
   ClutterActorBox content_box;
-  ClutterActor *child;
 
   get_border_paint_offsets (self, &x, &y);
   if (x != 0 || y != 0)
@@ -926,10 +977,7 @@ st_box_layout_paint (ClutterActor *actor)
                               (int)content_box.x2,
                               (int)content_box.y2);
 
-  for (child = clutter_actor_get_first_child (actor);
-       child != NULL;
-       child = clutter_actor_get_next_sibling (child))
-    clutter_actor_paint (child);
+  paint_children (self, &content_box);
 
   if (priv->hadjustment || priv->vadjustment)
     cogl_clip_pop ();
@@ -945,7 +993,6 @@ st_box_layout_pick (ClutterActor       *actor,
   gdouble x, y;
   ClutterActorBox allocation_box;
   ClutterActorBox content_box;
-  ClutterActor *child;
 
   get_border_paint_offsets (self, &x, &y);
   if (x != 0 || y != 0)
@@ -978,10 +1025,7 @@ st_box_layout_pick (ClutterActor       *actor,
                               (int)content_box.x2,
                               (int)content_box.y2);
 
-  for (child = clutter_actor_get_first_child (actor);
-       child != NULL;
-       child = clutter_actor_get_next_sibling (child))
-    clutter_actor_paint (child);
+  paint_children (self, &content_box);
 
   if (priv->hadjustment || priv->vadjustment)
     cogl_clip_pop ();
@@ -0,0 +1,1487 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-grid-view.c: a scrollable grid that only creates visible items
+ *
+ * Copyright 2012 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * SECTION:st-grid-view
+ * @short_description: a scrollable grid that only creates visible items
+ *
+ * #StGridView lays out #StGridView:n-items equally sized items in rows,
+ * filling as many columns as fit in its width (or at most
+ * #StGridView:max-columns; a grid view with a single column can be
+ * used as a list).
+ *
+ * Rather than containing one actor per item, the grid view asks for
+ * actors with the #StGridView::create-item signal and reuses them as
+ * it scrolls: only the rows in view, plus #StGridView:overscan rows
+ * on each side, are bound to items with #StGridView::bind-item.
+ * Items that scroll away are passed to #StGridView::unbind-item and
+ * kept around, hidden, to be bound again later. Items are bound when
+ * the view scrolls, or from an idle before the next layout; the layout
+ * itself only positions the items that are already bound.
+ *
+ * #StGridView implements #StScrollable and is meant to be placed in an
+ * #StScrollView for vertical scrolling. The size of the items is
+ * given by #StGridView:item-width and #StGridView:item-height, or is
+ * measured from the first item if they are not set; the space between
+ * items is taken from the 'spacing' style property.
+ */
+
+#include <math.h>
+
+#include "st-grid-view.h"
+
+#include "st-private.h"
+#include "st-scrollable.h"
+
+static void st_grid_view_scrollable_interface_init (StScrollableInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (StGridView, st_grid_view, ST_TYPE_WIDGET,
+                         G_IMPLEMENT_INTERFACE (ST_TYPE_SCROLLABLE,
+                                                st_grid_view_scrollable_interface_init));
+
+#define GRID_VIEW_PRIVATE(o) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((o), ST_TYPE_GRID_VIEW, StGridViewPrivate))
+
+#define DEFAULT_OVERSCAN 1
+
+enum {
+  PROP_0,
+
+  PROP_N_ITEMS,
+  PROP_MAX_COLUMNS,
+  PROP_ITEM_WIDTH,
+  PROP_ITEM_HEIGHT,
+  PROP_OVERSCAN,
+
+  PROP_HADJUST,
+  PROP_VADJUST
+};
+
+enum {
+  CREATE_ITEM,
+  BIND_ITEM,
+  UNBIND_ITEM,
+
+  LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0, };
+
+struct _StGridViewPrivate
+{
+  StAdjustment *hadjustment;
+  StAdjustment *vadjustment;
+
+  guint  n_items;
+  guint  max_columns;
+  guint  overscan;
+  gfloat item_width;
+  gfloat item_height;
+  gfloat spacing;
+
+  /* Size of the first item, if item-width or item-height is unset */
+  gfloat measured_width;
+  gfloat measured_height;
+  guint  measured : 1;
+
+  /* Layout as of the last allocation */
+  guint  n_columns;
+  gfloat viewport_height;
+  guint  in_allocation : 1;
+
+  /* Idle binding the items for the current layout */
+  guint  update_id;
+
+  /* items->pdata[i] is the actor bound to item first_item + i */
+  GPtrArray *items;
+  guint      first_item;
+
+  /* Hidden actors that are not bound to any item */
+  GSList *recycled;
+};
+
+static gboolean st_grid_view_update_items (StGridView *view);
+static void     queue_update_items        (StGridView *view);
+static void     queue_update              (StGridView *view);
+
+/*
+ * StScrollable Interface Implementation
+ */
+static void
+adjustment_value_notify_cb (StAdjustment *adjustment,
+                            GParamSpec   *pspec,
+                            StGridView   *view)
+{
+  /* The allocation clamps the value; don't bind items from there */
+  if (view->priv->in_allocation)
+    {
+      queue_update_items (view);
+      return;
+    }
+
+  if (st_grid_view_update_items (view))
+    clutter_actor_queue_relayout (CLUTTER_ACTOR (view));
+  else
+    clutter_actor_queue_redraw (CLUTTER_ACTOR (view));
+}
+
+static void
+scrollable_set_adjustments (StScrollable *scrollable,
+                            StAdjustment *hadjustment,
+                            StAdjustment *vadjustment)
+{
+  StGridViewPrivate *priv = ST_GRID_VIEW (scrollable)->priv;
+
+  g_object_freeze_notify (G_OBJECT (scrollable));
+
+  if (hadjustment != priv->hadjustment)
+    {
+      if (priv->hadjustment)
+        g_object_unref (priv->hadjustment);
+
+      if (hadjustment)
+        g_object_ref (hadjustment);
+
+      priv->hadjustment = hadjustment;
+      g_object_notify (G_OBJECT (scrollable), "hadjustment");
+    }
+
+  if (vadjustment != priv->vadjustment)
+    {
+      if (priv->vadjustment)
+        {
+          g_signal_handlers_disconnect_by_func (priv->vadjustment,
+                                                adjustment_value_notify_cb,
+                                                scrollable);
+          g_object_unref (priv->vadjustment);
+        }
+
+      if (vadjustment)
+        {
+          g_object_ref (vadjustment);
+          g_signal_connect (vadjustment, "notify::value",
+                            G_CALLBACK (adjustment_value_notify_cb),
+                            scrollable);
+        }
+
+      priv->vadjustment = vadjustment;
+      g_object_notify (G_OBJECT (scrollable), "vadjustment");
+
+      queue_update (ST_GRID_VIEW (scrollable));
+    }
+
+  g_object_thaw_notify (G_OBJECT (scrollable));
+}
+
+static void
+scrollable_get_adjustments (StScrollable  *scrollable,
+                            StAdjustment **hadjustment,
+                            StAdjustment **vadjustment)
+{
+  StGridViewPrivate *priv = ST_GRID_VIEW (scrollable)->priv;
+
+  if (hadjustment)
+    *hadjustment = priv->hadjustment;
+
+  if (vadjustment)
+    *vadjustment = priv->vadjustment;
+}
+
+static void
+st_grid_view_scrollable_interface_init (StScrollableInterface *iface)
+{
+  iface->set_adjustments = scrollable_set_adjustments;
+  iface->get_adjustments = scrollable_get_adjustments;
+}
+
+/*
+ * Item management
+ */
+static ClutterActor *
+acquire_item (StGridView *view)
+{
+  StGridViewPrivate *priv = view->priv;
+  ClutterActor *item = NULL;
+
+  if (priv->recycled)
+    {
+      item = priv->recycled->data;
+      priv->recycled = g_slist_delete_link (priv->recycled, priv->recycled);
+      clutter_actor_show (item);
+
+      return item;
+    }
+
+  g_signal_emit (view, signals[CREATE_ITEM], 0, &item);
+  if (item == NULL)
+    {
+      g_warning ("StGridView::create-item didn't return an actor");
+      return NULL;
+    }
+
+  clutter_actor_add_child (CLUTTER_ACTOR (view), item);
+  g_object_unref (item);
+
+  return item;
+}
+
+static void
+release_item (StGridView   *view,
+              ClutterActor *item)
+{
+  StGridViewPrivate *priv = view->priv;
+
+  if (item == NULL)
+    return;
+
+  g_signal_emit (view, signals[UNBIND_ITEM], 0, item);
+
+  clutter_actor_hide (item);
+  priv->recycled = g_slist_prepend (priv->recycled, item);
+}
+
+static void
+release_all_items (StGridView *view)
+{
+  StGridViewPrivate *priv = view->priv;
+  guint i;
+
+  for (i = 0; i < priv->items->len; i++)
+    release_item (view, g_ptr_array_index (priv->items, i));
+
+  g_ptr_array_set_size (priv->items, 0);
+  priv->first_item = 0;
+}
+
+/* Measures the first item if the item size isn't set. Returns %TRUE
+ * if the measured size changed.
+ */
+static gboolean
+ensure_measured (StGridView *view)
+{
+  StGridViewPrivate *priv = view->priv;
+  gfloat old_width = priv->measured_width;
+  gfloat old_height = priv->measured_height;
+  ClutterActor *item;
+
+  if ((priv->item_width > 0 && priv->item_height > 0) ||
+      priv->measured || priv->n_items == 0)
+    return FALSE;
+
+  /* Measure a throwaway binding of the first item; the actor goes
+   * to the recycled list and will be reused right away.
+   */
+  item = acquire_item (view);
+  if (item == NULL)
+    return FALSE;
+
+  g_signal_emit (view, signals[BIND_ITEM], 0, item, 0);
+  clutter_actor_get_preferred_size (item, NULL, NULL,
+                                    &priv->measured_width,
+                                    &priv->measured_height);
+  release_item (view, item);
+
+  priv->measured = TRUE;
+
+  return priv->measured_width != old_width || priv->measured_height != old_height;
+}
+
+static void
+get_cell_size (StGridView *view,
+               gfloat     *width,
+               gfloat     *height)
+{
+  StGridViewPrivate *priv = view->priv;
+
+  *width = priv->item_width > 0 ? priv->item_width : priv->measured_width;
+  *height = priv->item_height > 0 ? priv->item_height : priv->measured_height;
+}
+
+static guint
+compute_n_columns (StGridView *view,
+                   gfloat      for_width)
+{
+  StGridViewPrivate *priv = view->priv;
+  gfloat cell_width, cell_height;
+  guint n_columns;
+
+  get_cell_size (view, &cell_width, &cell_height);
+
+  if (cell_width <= 0 || for_width < 0)
+    n_columns = priv->n_items;
+  else
+    n_columns = (for_width + priv->spacing) / (cell_width + priv->spacing);
+
+  if (priv->max_columns > 0)
+    n_columns = MIN (n_columns, priv->max_columns);
+
+  return MAX (n_columns, 1);
+}
+
+static gfloat
+compute_content_height (StGridView *view,
+                        guint       n_columns)
+{
+  StGridViewPrivate *priv = view->priv;
+  gfloat cell_width, cell_height;
+  guint n_rows;
+
+  get_cell_size (view, &cell_width, &cell_height);
+
+  n_rows = (priv->n_items + n_columns - 1) / n_columns;
+  if (n_rows == 0)
+    return 0;
+
+  return n_rows * cell_height + (n_rows - 1) * priv->spacing;
+}
+
+/* Computes the cell of item @index for the current layout, within
+ * @content_box */
+static void
+get_cell_box (StGridView            *view,
+              const ClutterActorBox *content_box,
+              guint                  index,
+              ClutterActorBox       *box)
+{
+  StGridViewPrivate *priv = view->priv;
+  gfloat cell_width, cell_height, x, y;
+  guint n_columns = MAX (priv->n_columns, 1);
+
+  get_cell_size (view, &cell_width, &cell_height);
+
+  x = (index % n_columns) * (cell_width + priv->spacing);
+  y = (index / n_columns) * (cell_height + priv->spacing);
+
+  if (clutter_actor_get_text_direction (CLUTTER_ACTOR (view)) == CLUTTER_TEXT_DIRECTION_RTL)
+    box->x1 = content_box->x2 - x - cell_width;
+  else
+    box->x1 = content_box->x1 + x;
+  box->y1 = content_box->y1 + y;
+  box->x2 = box->x1 + cell_width;
+  box->y2 = box->y1 + cell_height;
+}
+
+/* Sets the layout from the last allocation. Returns %TRUE if the
+ * items in view may have changed.
+ */
+static gboolean
+update_layout (StGridView            *view,
+               const ClutterActorBox *content_box)
+{
+  StGridViewPrivate *priv = view->priv;
+  guint old_n_columns = priv->n_columns;
+  gfloat old_viewport_height = priv->viewport_height;
+
+  priv->n_columns = compute_n_columns (view, content_box->x2 - content_box->x1);
+  priv->viewport_height = content_box->y2 - content_box->y1;
+
+  return priv->n_columns != old_n_columns || priv->viewport_height != old_viewport_height;
+}
+
+static gboolean
+update_items_idle (gpointer data)
+{
+  StGridView *view = data;
+  ClutterActor *actor = CLUTTER_ACTOR (view);
+  gboolean changed;
+
+  view->priv->update_id = 0;
+
+  /* Queued again when mapped */
+  if (!CLUTTER_ACTOR_IS_MAPPED (actor))
+    return FALSE;
+
+  changed = ensure_measured (view);
+
+  if (clutter_actor_has_allocation (actor))
+    {
+      StThemeNode *theme_node = st_widget_get_theme_node (ST_WIDGET (view));
+      ClutterActorBox allocation_box, content_box;
+
+      clutter_actor_get_allocation_box (actor, &allocation_box);
+      st_theme_node_get_content_box (theme_node, &allocation_box, &content_box);
+
+      update_layout (view, &content_box);
+      if (st_grid_view_update_items (view))
+        changed = TRUE;
+    }
+
+  if (changed)
+    clutter_actor_queue_relayout (actor);
+
+  return FALSE;
+}
+
+/* Binds the items in view, and measures the item size, before the next
+ * layout; creating and binding actors can't happen during the layout.
+ */
+static void
+queue_update_items (StGridView *view)
+{
+  StGridViewPrivate *priv = view->priv;
+
+  /* Ahead of the redraw, which is dispatched at a lower priority */
+  if (priv->update_id == 0)
+    priv->update_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+                                       update_items_idle, view, NULL);
+}
+
+static void
+queue_update (StGridView *view)
+{
+  queue_update_items (view);
+  clutter_actor_queue_relayout (CLUTTER_ACTOR (view));
+}
+
+/* Binds the items that are within the viewport or the overscan around
+ * it, recycling the ones that are not. Returns %TRUE if any item was
+ * bound.
+ */
+static gboolean
+st_grid_view_update_items (StGridView *view)
+{
+  StGridViewPrivate *priv = view->priv;
+  GPtrArray *old_items;
+  guint old_first, first, last, index;
+  gboolean changed = FALSE;
+
+  if (priv->n_columns == 0)
+    return FALSE;
+
+  if (priv->vadjustment)
+    {
+      gfloat cell_width, cell_height, row_height;
+      gdouble value;
+      gint first_row, last_row;
+
+      get_cell_size (view, &cell_width, &cell_height);
+      row_height = cell_height + priv->spacing;
+      value = st_adjustment_get_value (priv->vadjustment);
+
+      if (row_height > 0)
+        {
+          first_row = floor (value / row_height) - priv->overscan;
+          last_row = ceil ((value + priv->viewport_height) / row_height) + priv->overscan;
+        }
+      else
+        {
+          first_row = 0;
+          last_row = G_MAXINT / priv->n_columns;
+        }
+
+      first = MIN ((guint) MAX (first_row, 0) * priv->n_columns, priv->n_items);
+      last = MIN ((guint) MAX (last_row, 0) * priv->n_columns, priv->n_items);
+    }
+  else
+    {
+      first = 0;
+      last = priv->n_items;
+    }
+
+  if (first == priv->first_item && last == priv->first_item + priv->items->len)
+    return FALSE;
+
+  old_items = priv->items;
+  old_first = priv->first_item;
+
+  for (index = old_first; index < old_first + old_items->len; index++)
+    {
+      if (index < first || index >= last)
+        release_item (view, g_ptr_array_index (old_items, index - old_first));
+    }
+
+  priv->items = g_ptr_array_sized_new (last - first);
+  priv->first_item = first;
+
+  for (index = first; index < last; index++)
+    {
+      ClutterActor *item;
+
+      if (index >= old_first && index < old_first + old_items->len)
+        {
+          item = g_ptr_array_index (old_items, index - old_first);
+        }
+      else
+        {
+          item = acquire_item (view);
+          if (item != NULL)
+            g_signal_emit (view, signals[BIND_ITEM], 0, item, index);
+
+          changed = TRUE;
+        }
+
+      g_ptr_array_add (priv->items, item);
+    }
+
+  g_ptr_array_free (old_items, TRUE);
+
+  return changed;
+}
+
+/*
+ * ClutterActor implementation
+ */
+static void
+st_grid_view_get_preferred_width (ClutterActor *actor,
+                                  gfloat        for_height,
+                                  gfloat       *min_width_p,
+                                  gfloat       *natural_width_p)
+{
+  StGridView *view = ST_GRID_VIEW (actor);
+  StGridViewPrivate *priv = view->priv;
+  StThemeNode *theme_node = st_widget_get_theme_node (ST_WIDGET (actor));
+  gfloat cell_width, cell_height;
+  guint n_columns;
+
+  st_theme_node_adjust_for_height (theme_node, &for_height);
+
+  get_cell_size (view, &cell_width, &cell_height);
+
+  n_columns = priv->n_items;
+  if (priv->max_columns > 0)
+    n_columns = MIN (n_columns, priv->max_columns);
+
+  if (min_width_p)
+    *min_width_p = priv->n_items > 0 ? cell_width : 0;
+
+  if (natural_width_p)
+    *natural_width_p = n_columns > 0 ? n_columns * cell_width + (n_columns - 1) * priv->spacing : 0;
+
+  st_theme_node_adjust_preferred_width (theme_node, min_width_p, natural_width_p);
+}
+
+static void
+st_grid_view_get_preferred_height (ClutterActor *actor,
+                                   gfloat        for_width,
+                                   gfloat       *min_height_p,
+                                   gfloat       *natural_height_p)
+{
+  StGridView *view = ST_GRID_VIEW (actor);
+  StThemeNode *theme_node = st_widget_get_theme_node (ST_WIDGET (actor));
+  gfloat height;
+
+  st_theme_node_adjust_for_width (theme_node, &for_width);
+
+  height = compute_content_height (view, compute_n_columns (view, for_width));
+
+  if (min_height_p)
+    *min_height_p = height;
+
+  if (natural_height_p)
+    *natural_height_p = height;
+
+  st_theme_node_adjust_preferred_height (theme_node, min_height_p, natural_height_p);
+}
+
+static void
+st_grid_view_allocate (ClutterActor          *actor,
+                       const ClutterActorBox *box,
+                       ClutterAllocationFlags flags)
+{
+  StGridView *view = ST_GRID_VIEW (actor);
+  StGridViewPrivate *priv = view->priv;
+  StThemeNode *theme_node = st_widget_get_theme_node (ST_WIDGET (actor));
+  ClutterActorBox content_box;
+  gfloat avail_width, avail_height, content_height;
+  gfloat cell_width, cell_height;
+  guint i;
+
+  clutter_actor_set_allocation (actor, box, flags);
+
+  st_theme_node_get_content_box (theme_node, box, &content_box);
+
+  avail_width  = content_box.x2 - content_box.x1;
+  avail_height = content_box.y2 - content_box.y1;
+
+  get_cell_size (view, &cell_width, &cell_height);
+  if (update_layout (view, &content_box))
+    queue_update_items (view);
+  content_height = compute_content_height (view, priv->n_columns);
+
+  priv->in_allocation = TRUE;
+
+  /* update adjustments for scrolling */
+  if (priv->vadjustment)
+    {
+      gdouble prev_value;
+
+      g_object_set (G_OBJECT (priv->vadjustment),
+                    "lower", 0.0,
+                    "upper", MAX (content_height, avail_height),
+                    "page-size", avail_height,
+                    "step-increment", cell_height + priv->spacing,
+                    "page-increment", avail_height - avail_height / 6,
+                    NULL);
+
+      prev_value = st_adjustment_get_value (priv->vadjustment);
+      st_adjustment_set_value (priv->vadjustment, prev_value);
+    }
+
+  if (priv->hadjustment)
+    {
+      g_object_set (G_OBJECT (priv->hadjustment),
+                    "lower", 0.0,
+                    "upper", avail_width,
+                    "page-size", avail_width,
+                    "step-increment", avail_width / 6,
+                    "page-increment", avail_width - avail_width / 6,
+                    NULL);
+      st_adjustment_set_value (priv->hadjustment, 0.0);
+    }
+
+  priv->in_allocation = FALSE;
+
+  /* Only position the items that are bound; if the layout changed,
+   * the items now in view are bound from an idle before the next one.
+   */
+  for (i = 0; i < priv->items->len; i++)
+    {
+      ClutterActor *item = g_ptr_array_index (priv->items, i);
+      gfloat natural_width, natural_height, width, height;
+      ClutterActorBox cell_box, child_box;
+
+      if (item == NULL)
+        continue;
+
+      get_cell_box (view, &content_box, priv->first_item + i, &cell_box);
+
+      /* Center the item in its cell, without growing it beyond its
+       * natural size.
+       */
+      clutter_actor_get_preferred_size (item, NULL, NULL,
+                                        &natural_width, &natural_height);
+      width = MIN (cell_width, natural_width);
+      height = MIN (cell_height, natural_height);
+
+      child_box.x1 = (int) (cell_box.x1 + (cell_width - width) / 2);
+      child_box.y1 = (int) (cell_box.y1 + (cell_height - height) / 2);
+      child_box.x2 = child_box.x1 + width;
+      child_box.y2 = child_box.y1 + height;
+
+      clutter_actor_allocate (item, &child_box, flags);
+    }
+}
+
+static void
+st_grid_view_map (ClutterActor *actor)
+{
+  CLUTTER_ACTOR_CLASS (st_grid_view_parent_class)->map (actor);
+
+  queue_update_items (ST_GRID_VIEW (actor));
+}
+
+static void
+st_grid_view_apply_transform (ClutterActor *actor,
+                              CoglMatrix   *m)
+{
+  StGridViewPrivate *priv = ST_GRID_VIEW (actor)->priv;
+  gdouble y;
+
+  CLUTTER_ACTOR_CLASS (st_grid_view_parent_class)->apply_transform (actor, m);
+
+  if (priv->vadjustment)
+    y = st_adjustment_get_value (priv->vadjustment);
+  else
+    y = 0;
+
+  cogl_matrix_translate (m, 0, (int) -y, 0);
+}
+
+static gdouble
+get_scroll_offset (StGridView *view)
+{
+  StGridViewPrivate *priv = view->priv;
+
+  return priv->vadjustment ? st_adjustment_get_value (priv->vadjustment) : 0;
+}
+
+/* Shared between paint and pick: the background and borders don't
+ * scroll, while the items are clipped to the content area.
+ */
+static void
+paint_items (StGridView *view)
+{
+  StGridViewPrivate *priv = view->priv;
+  ClutterActor *actor = CLUTTER_ACTOR (view);
+  StThemeNode *theme_node = st_widget_get_theme_node (ST_WIDGET (view));
+  ClutterActorBox allocation_box;
+  ClutterActorBox content_box;
+  gdouble y = get_scroll_offset (view);
+  guint i;
+
+  if (priv->items->len == 0)
+    return;
+
+  clutter_actor_get_allocation_box (actor, &allocation_box);
+  st_theme_node_get_content_box (theme_node, &allocation_box, &content_box);
+
+  cogl_clip_push_rectangle ((int)content_box.x1,
+                            (int)(content_box.y1 + y),
+                            (int)content_box.x2,
+                            (int)(content_box.y2 + y));
+
+  for (i = 0; i < priv->items->len; i++)
+    {
+      ClutterActor *item = g_ptr_array_index (priv->items, i);
+
+      if (item != NULL)
+        clutter_actor_paint (item);
+    }
+
+  cogl_clip_pop ();
+}
+
+static void
+st_grid_view_paint (ClutterActor *actor)
+{
+  StGridView *view = ST_GRID_VIEW (actor);
+  gdouble y = get_scroll_offset (view);
+
+  if (y != 0)
+    {
+      cogl_push_matrix ();
+      cogl_translate (0, (int)y, 0);
+    }
+
+  st_widget_paint_background (ST_WIDGET (actor));
+
+  if (y != 0)
+    cogl_pop_matrix ();
+
+  paint_items (view);
+}
+
+static void
+st_grid_view_pick (ClutterActor       *actor,
+                   const ClutterColor *color)
+{
+  StGridView *view = ST_GRID_VIEW (actor);
+  gdouble y = get_scroll_offset (view);
+
+  if (y != 0)
+    {
+      cogl_push_matrix ();
+      cogl_translate (0, (int)y, 0);
+    }
+
+  CLUTTER_ACTOR_CLASS (st_grid_view_parent_class)->pick (actor, color);
+
+  if (y != 0)
+    cogl_pop_matrix ();
+
+  paint_items (view);
+}
+
+static gboolean
+st_grid_view_get_paint_volume (ClutterActor       *actor,
+                               ClutterPaintVolume *volume)
+{
+  gdouble y;
+
+  if (!clutter_paint_volume_set_from_allocation (volume, actor))
+    return FALSE;
+
+  /* Our own paint volume doesn't scroll, but apply_transform()
+   * includes the scroll offset; compensate for it.
+   */
+  y = get_scroll_offset (ST_GRID_VIEW (actor));
+  if (y != 0)
+    {
+      ClutterVertex origin;
+
+      clutter_paint_volume_get_origin (volume, &origin);
+      origin.y += y;
+      clutter_paint_volume_set_origin (volume, &origin);
+    }
+
+  return TRUE;
+}
+
+static void
+st_grid_view_style_changed (StWidget *widget)
+{
+  StGridViewPrivate *priv = ST_GRID_VIEW (widget)->priv;
+  StThemeNode *theme_node = st_widget_get_theme_node (widget);
+  gfloat old_spacing = priv->spacing;
+
+  priv->spacing = (int)(st_theme_node_get_length (theme_node, "spacing") + 0.5);
+  priv->measured = FALSE;
+
+  if (priv->spacing != old_spacing || priv->item_width <= 0 || priv->item_height <= 0)
+    queue_update (ST_GRID_VIEW (widget));
+
+  ST_WIDGET_CLASS (st_grid_view_parent_class)->style_changed (widget);
+}
+
+/* Scrolls the least needed for the row of item @index to be in view;
+ * the items of that row are bound right away.
+ */
+static void
+scroll_to_item (StGridView *view,
+                guint       index)
+{
+  StGridViewPrivate *priv = view->priv;
+  gfloat cell_width, cell_height, y;
+  gdouble value;
+
+  if (priv->vadjustment == NULL || priv->n_columns == 0)
+    return;
+
+  get_cell_size (view, &cell_width, &cell_height);
+  y = (index / priv->n_columns) * (cell_height + priv->spacing);
+  value = st_adjustment_get_value (priv->vadjustment);
+
+  if (y < value)
+    value = y;
+  else if (y + cell_height > value + priv->viewport_height)
+    value = y + cell_height - priv->viewport_height;
+  else
+    return;
+
+  st_adjustment_set_value (priv->vadjustment, value);
+}
+
+/* Items that aren't bound aren't in the focus chain, so moving the
+ * focus from one item to the next is done by index; the target item is
+ * scrolled into view, which binds it, and then focused.
+ */
+static gboolean
+st_grid_view_navigate_focus (StWidget         *widget,
+                             ClutterActor     *from,
+                             GtkDirectionType  direction)
+{
+  StGridView *view = ST_GRID_VIEW (widget);
+  StGridViewPrivate *priv = view->priv;
+  ClutterActor *item = NULL;
+  guint i, index = 0, target, n_columns;
+  gboolean rtl;
+
+  if (from != NULL)
+    {
+      for (i = 0; i < priv->items->len; i++)
+        {
+          ClutterActor *bound = g_ptr_array_index (priv->items, i);
+
+          if (bound != NULL && clutter_actor_contains (bound, from))
+            {
+              item = bound;
+              index = priv->first_item + i;
+              break;
+            }
+        }
+    }
+
+  /* Focus entering the grid goes to one of the bound items */
+  if (item == NULL || priv->n_columns == 0)
+    return ST_WIDGET_CLASS (st_grid_view_parent_class)->navigate_focus (widget, from, direction);
+
+  /* Let the item move the focus within itself first */
+  if (ST_IS_WIDGET (item) && item != from &&
+      st_widget_navigate_focus (ST_WIDGET (item), from, direction, FALSE))
+    return TRUE;
+
+  n_columns = priv->n_columns;
+  rtl = clutter_actor_get_text_direction (CLUTTER_ACTOR (view)) == CLUTTER_TEXT_DIRECTION_RTL;
+  if (rtl && direction == GTK_DIR_LEFT)
+    direction = GTK_DIR_RIGHT;
+  else if (rtl && direction == GTK_DIR_RIGHT)
+    direction = GTK_DIR_LEFT;
+
+  switch (direction)
+    {
+    case GTK_DIR_TAB_FORWARD:
+      target = index + 1;
+      break;
+
+    case GTK_DIR_TAB_BACKWARD:
+      if (index == 0)
+        return FALSE;
+      target = index - 1;
+      break;
+
+    case GTK_DIR_UP:
+      if (index < n_columns)
+        return FALSE;
+      target = index - n_columns;
+      break;
+
+    case GTK_DIR_DOWN:
+      target = index + n_columns;
+      /* Go to the end of a shorter last row */
+      if (target >= priv->n_items &&
+          index / n_columns < (priv->n_items - 1) / n_columns)
+        target = priv->n_items - 1;
+      break;
+
+    case GTK_DIR_LEFT:
+      if (index % n_columns == 0)
+        return FALSE;
+      target = index - 1;
+      break;
+
+    case GTK_DIR_RIGHT:
+      if (index % n_columns == n_columns - 1)
+        return FALSE;
+      target = index + 1;
+      break;
+
+    default:
+      return FALSE;
+    }
+
+  if (target >= priv->n_items)
+    return FALSE;
+
+  scroll_to_item (view, target);
+
+  item = st_grid_view_get_item (view, target);
+  if (item == NULL || !ST_IS_WIDGET (item))
+    return FALSE;
+
+  return st_widget_navigate_focus (ST_WIDGET (item), NULL, direction, FALSE);
+}
+
+/*
+ * GObject implementation
+ */
+static void
+st_grid_view_get_property (GObject    *object,
+                           guint       property_id,
+                           GValue     *value,
+                           GParamSpec *pspec)
+{
+  StGridViewPrivate *priv = ST_GRID_VIEW (object)->priv;
+  StAdjustment *adjustment;
+
+  switch (property_id)
+    {
+    case PROP_N_ITEMS:
+      g_value_set_uint (value, priv->n_items);
+      break;
+
+    case PROP_MAX_COLUMNS:
+      g_value_set_uint (value, priv->max_columns);
+      break;
+
+    case PROP_ITEM_WIDTH:
+      g_value_set_float (value, priv->item_width);
+      break;
+
+    case PROP_ITEM_HEIGHT:
+      g_value_set_float (value, priv->item_height);
+      break;
+
+    case PROP_OVERSCAN:
+      g_value_set_uint (value, priv->overscan);
+      break;
+
+    case PROP_HADJUST:
+      scrollable_get_adjustments (ST_SCROLLABLE (object), &adjustment, NULL);
+      g_value_set_object (value, adjustment);
+      break;
+
+    case PROP_VADJUST:
+      scrollable_get_adjustments (ST_SCROLLABLE (object), NULL, &adjustment);
+      g_value_set_object (value, adjustment);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    }
+}
+
+static void
+st_grid_view_set_property (GObject      *object,
+                           guint         property_id,
+                           const GValue *value,
+                           GParamSpec   *pspec)
+{
+  StGridView *view = ST_GRID_VIEW (object);
+  StGridViewPrivate *priv = view->priv;
+
+  switch (property_id)
+    {
+    case PROP_N_ITEMS:
+      st_grid_view_set_n_items (view, g_value_get_uint (value));
+      break;
+
+    case PROP_MAX_COLUMNS:
+      st_grid_view_set_max_columns (view, g_value_get_uint (value));
+      break;
+
+    case PROP_ITEM_WIDTH:
+      st_grid_view_set_item_size (view, g_value_get_float (value), priv->item_height);
+      break;
+
+    case PROP_ITEM_HEIGHT:
+      st_grid_view_set_item_size (view, priv->item_width, g_value_get_float (value));
+      break;
+
+    case PROP_OVERSCAN:
+      st_grid_view_set_overscan (view, g_value_get_uint (value));
+      break;
+
+    case PROP_HADJUST:
+      scrollable_set_adjustments (ST_SCROLLABLE (object),
+                                  g_value_get_object (value),
+                                  priv->vadjustment);
+      break;
+
+    case PROP_VADJUST:
+      scrollable_set_adjustments (ST_SCROLLABLE (object),
+                                  priv->hadjustment,
+                                  g_value_get_object (value));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    }
+}
+
+static void
+st_grid_view_dispose (GObject *object)
+{
+  StGridViewPrivate *priv = ST_GRID_VIEW (object)->priv;
+
+  scrollable_set_adjustments (ST_SCROLLABLE (object), NULL, NULL);
+
+  if (priv->update_id != 0)
+    {
+      g_source_remove (priv->update_id);
+      priv->update_id = 0;
+    }
+
+  /* The actors themselves are destroyed along with us */
+  g_ptr_array_set_size (priv->items, 0);
+  g_slist_free (priv->recycled);
+  priv->recycled = NULL;
+
+  G_OBJECT_CLASS (st_grid_view_parent_class)->dispose (object);
+}
+
+static void
+st_grid_view_finalize (GObject *object)
+{
+  StGridViewPrivate *priv = ST_GRID_VIEW (object)->priv;
+
+  g_ptr_array_free (priv->items, TRUE);
+
+  G_OBJECT_CLASS (st_grid_view_parent_class)->finalize (object);
+}
+
+static void
+st_grid_view_class_init (StGridViewClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  ClutterActorClass *actor_class = CLUTTER_ACTOR_CLASS (klass);
+  StWidgetClass *widget_class = ST_WIDGET_CLASS (klass);
+  GParamSpec *pspec;
+
+  g_type_class_add_private (klass, sizeof (StGridViewPrivate));
+
+  object_class->get_property = st_grid_view_get_property;
+  object_class->set_property = st_grid_view_set_property;
+  object_class->dispose = st_grid_view_dispose;
+  object_class->finalize = st_grid_view_finalize;
+
+  actor_class->get_preferred_width = st_grid_view_get_preferred_width;
+  actor_class->get_preferred_height = st_grid_view_get_preferred_height;
+  actor_class->allocate = st_grid_view_allocate;
+  actor_class->map = st_grid_view_map;
+  actor_class->apply_transform = st_grid_view_apply_transform;
+  actor_class->paint = st_grid_view_paint;
+  actor_class->pick = st_grid_view_pick;
+  actor_class->get_paint_volume = st_grid_view_get_paint_volume;
+
+  widget_class->style_changed = st_grid_view_style_changed;
+  widget_class->navigate_focus = st_grid_view_navigate_focus;
+
+  pspec = g_param_spec_uint ("n-items",
+                             "Number of items",
+                             "Number of items in the grid",
+                             0, G_MAXUINT, 0,
+                             ST_PARAM_READWRITE);
+  g_object_class_install_property (object_class, PROP_N_ITEMS, pspec);
+
+  pspec = g_param_spec_uint ("max-columns",
+                             "Maximum columns",
+                             "Maximum number of columns, or 0 for no limit",
+                             0, G_MAXUINT, 0,
+                             ST_PARAM_READWRITE);
+  g_object_class_install_property (object_class, PROP_MAX_COLUMNS, pspec);
+
+  pspec = g_param_spec_float ("item-width",
+                              "Item width",
+                              "Width of each item, or 0 to use the width of the first item",
+                              0, G_MAXFLOAT, 0,
+                              ST_PARAM_READWRITE);
+  g_object_class_install_property (object_class, PROP_ITEM_WIDTH, pspec);
+
+  pspec = g_param_spec_float ("item-height",
+                              "Item height",
+                              "Height of each item, or 0 to use the height of the first item",
+                              0, G_MAXFLOAT, 0,
+                              ST_PARAM_READWRITE);
+  g_object_class_install_property (object_class, PROP_ITEM_HEIGHT, pspec);
+
+  pspec = g_param_spec_uint ("overscan",
+                             "Overscan",
+                             "Number of rows to keep bound above and below the visible ones",
+                             0, G_MAXUINT, DEFAULT_OVERSCAN,
+                             ST_PARAM_READWRITE);
+  g_object_class_install_property (object_class, PROP_OVERSCAN, pspec);
+
+  /* StScrollable properties */
+  g_object_class_override_property (object_class,
+                                    PROP_HADJUST,
+                                    "hadjustment");
+
+  g_object_class_override_property (object_class,
+                                    PROP_VADJUST,
+                                    "vadjustment");
+
+  /**
+   * StGridView::create-item:
+   * @view: the #StGridView
+   *
+   * Emitted when the grid view needs a new actor to show items; the
+   * actor will be bound to an item with #StGridView::bind-item before
+   * being shown.
+   *
+   * Returns: (transfer full): a new #ClutterActor
+   */
+  signals[CREATE_ITEM] =
+    g_signal_new ("create-item",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  g_signal_accumulator_first_wins, NULL, NULL,
+                  CLUTTER_TYPE_ACTOR, 0);
+
+  /**
+   * StGridView::bind-item:
+   * @view: the #StGridView
+   * @item: an actor returned by #StGridView::create-item
+   * @index: the index of the item that @item should show
+   *
+   * Emitted when @item is about to be shown for item @index.
+   */
+  signals[BIND_ITEM] =
+    g_signal_new ("bind-item",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 2,
+                  CLUTTER_TYPE_ACTOR, G_TYPE_UINT);
+
+  /**
+   * StGridView::unbind-item:
+   * @view: the #StGridView
+   * @item: an actor returned by #StGridView::create-item
+   *
+   * Emitted when @item is no longer used to show an item, so that
+   * resources specific to the item can be released.
+   */
+  signals[UNBIND_ITEM] =
+    g_signal_new ("unbind-item",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 1,
+                  CLUTTER_TYPE_ACTOR);
+}
+
+static void
+st_grid_view_init (StGridView *view)
+{
+  view->priv = GRID_VIEW_PRIVATE (view);
+
+  view->priv->overscan = DEFAULT_OVERSCAN;
+  view->priv->items = g_ptr_array_new ();
+}
+
+/**
+ * st_grid_view_new:
+ *
+ * Create a new #StGridView.
+ *
+ * Returns: a newly allocated #StGridView
+ */
+StWidget *
+st_grid_view_new (void)
+{
+  return g_object_new (ST_TYPE_GRID_VIEW, NULL);
+}
+
+/**
+ * st_grid_view_set_n_items:
+ * @view: A #StGridView
+ * @n_items: the number of items
+ *
+ * Sets the number of items in the grid. Items that are already bound
+ * keep their binding; call st_grid_view_items_changed() if their
+ * contents changed as well.
+ */
+void
+st_grid_view_set_n_items (StGridView *view,
+                          guint       n_items)
+{
+  StGridViewPrivate *priv;
+
+  g_return_if_fail (ST_IS_GRID_VIEW (view));
+
+  priv = view->priv;
+
+  if (priv->n_items == n_items)
+    return;
+
+  priv->n_items = n_items;
+
+  /* Drop bindings beyond the new end */
+  if (priv->first_item + priv->items->len > n_items)
+    release_all_items (view);
+
+  queue_update (view);
+
+  g_object_notify (G_OBJECT (view), "n-items");
+}
+
+/**
+ * st_grid_view_get_n_items:
+ * @view: A #StGridView
+ *
+ * Returns: the number of items in the grid
+ */
+guint
+st_grid_view_get_n_items (StGridView *view)
+{
+  g_return_val_if_fail (ST_IS_GRID_VIEW (view), 0);
+
+  return view->priv->n_items;
+}
+
+/**
+ * st_grid_view_set_max_columns:
+ * @view: A #StGridView
+ * @max_columns: the maximum number of columns, or 0 for no limit
+ *
+ * Limits the number of columns of the grid; a limit of 1 turns the
+ * grid into a list.
+ */
+void
+st_grid_view_set_max_columns (StGridView *view,
+                              guint       max_columns)
+{
+  g_return_if_fail (ST_IS_GRID_VIEW (view));
+
+  if (view->priv->max_columns == max_columns)
+    return;
+
+  view->priv->max_columns = max_columns;
+  queue_update (view);
+
+  g_object_notify (G_OBJECT (view), "max-columns");
+}
+
+/**
+ * st_grid_view_get_max_columns:
+ * @view: A #StGridView
+ *
+ * Returns: the maximum number of columns, or 0 if there is no limit
+ */
+guint
+st_grid_view_get_max_columns (StGridView *view)
+{
+  g_return_val_if_fail (ST_IS_GRID_VIEW (view), 0);
+
+  return view->priv->max_columns;
+}
+
+/**
+ * st_grid_view_set_item_size:
+ * @view: A #StGridView
+ * @width: the width of each item, or 0
+ * @height: the height of each item, or 0
+ *
+ * Sets the size of the cells of the grid. If either is 0, the
+ * preferred size of the first item is used.
+ */
+void
+st_grid_view_set_item_size (StGridView *view,
+                            gfloat      width,
+                            gfloat      height)
+{
+  StGridViewPrivate *priv;
+
+  g_return_if_fail (ST_IS_GRID_VIEW (view));
+
+  priv = view->priv;
+
+  g_object_freeze_notify (G_OBJECT (view));
+
+  if (priv->item_width != width)
+    {
+      priv->item_width = width;
+      g_object_notify (G_OBJECT (view), "item-width");
+    }
+
+  if (priv->item_height != height)
+    {
+      priv->item_height = height;
+      g_object_notify (G_OBJECT (view), "item-height");
+    }
+
+  queue_update (view);
+
+  g_object_thaw_notify (G_OBJECT (view));
+}
+
+/**
+ * st_grid_view_get_item_size:
+ * @view: A #StGridView
+ * @width: (out) (allow-none): return location for the item width
+ * @height: (out) (allow-none): return location for the item height
+ *
+ * Gets the size set with st_grid_view_set_item_size().
+ */
+void
+st_grid_view_get_item_size (StGridView *view,
+                            gfloat     *width,
+                            gfloat     *height)
+{
+  g_return_if_fail (ST_IS_GRID_VIEW (view));
+
+  if (width)
+    *width = view->priv->item_width;
+  if (height)
+    *height = view->priv->item_height;
+}
+
+/**
+ * st_grid_view_set_overscan:
+ * @view: A #StGridView
+ * @overscan: a number of rows
+ *
+ * Sets how many rows above and below the visible ones are kept bound,
+ * so that small scrolls and keyboard navigation find their items
+ * already in place.
+ */
+void
+st_grid_view_set_overscan (StGridView *view,
+                           guint       overscan)
+{
+  g_return_if_fail (ST_IS_GRID_VIEW (view));
+
+  if (view->priv->overscan == overscan)
+    return;
+
+  view->priv->overscan = overscan;
+  queue_update (view);
+
+  g_object_notify (G_OBJECT (view), "overscan");
+}
+
+/**
+ * st_grid_view_get_overscan:
+ * @view: A #StGridView
+ *
+ * Returns: the number of rows bound outside of the viewport
+ */
+guint
+st_grid_view_get_overscan (StGridView *view)
+{
+  g_return_val_if_fail (ST_IS_GRID_VIEW (view), 0);
+
+  return view->priv->overscan;
+}
+
+/**
+ * st_grid_view_items_changed:
+ * @view: A #StGridView
+ *
+ * Tells the grid view that the contents of its items changed, so
+ * that all bound actors are bound again.
+ */
+void
+st_grid_view_items_changed (StGridView *view)
+{
+  g_return_if_fail (ST_IS_GRID_VIEW (view));
+
+  release_all_items (view);
+  view->priv->measured = FALSE;
+
+  queue_update (view);
+}
+
+/**
+ * st_grid_view_get_item:
+ * @view: A #StGridView
+ * @index: the index of an item
+ *
+ * Gets the actor currently showing item @index.
+ *
+ * Returns: (transfer none): the actor bound to @index, or %NULL if
+ *   the item is scrolled too far out of view to be bound
+ */
+ClutterActor *
+st_grid_view_get_item (StGridView *view,
+                       guint       index)
+{
+  StGridViewPrivate *priv;
+
+  g_return_val_if_fail (ST_IS_GRID_VIEW (view), NULL);
+
+  priv = view->priv;
+
+  if (index < priv->first_item || index >= priv->first_item + priv->items->len)
+    return NULL;
+
+  return g_ptr_array_index (priv->items, index - priv->first_item);
+}
+
+/**
+ * st_grid_view_get_cell_box:
+ * @view: A #StGridView
+ * @index: the index of an item
+ * @box: (out): return location for the cell
+ *
+ * Gets the cell of item @index in the coordinates of @view, as of the
+ * last allocation, whether or not the item is bound. This can be used
+ * to scroll to an item whose actor was just bound and isn't allocated
+ * yet.
+ */
+void
+st_grid_view_get_cell_box (StGridView      *view,
+                           guint            index,
+                           ClutterActorBox *box)
+{
+  StThemeNode *theme_node;
+  ClutterActorBox allocation_box, content_box;
+
+  g_return_if_fail (ST_IS_GRID_VIEW (view));
+  g_return_if_fail (box != NULL);
+
+  theme_node = st_widget_get_theme_node (ST_WIDGET (view));
+  clutter_actor_get_allocation_box (CLUTTER_ACTOR (view), &allocation_box);
+  st_theme_node_get_content_box (theme_node, &allocation_box, &content_box);
+
+  get_cell_box (view, &content_box, index, box);
+}
@@ -0,0 +1,108 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-grid-view.h: a scrollable grid that only creates visible items
+ *
+ * Copyright 2012 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if !defined(ST_H_INSIDE) && !defined(ST_COMPILATION)
+#error "Only <st/st.h> can be included directly.h"
+#endif
+
+#ifndef __ST_GRID_VIEW_H__
+#define __ST_GRID_VIEW_H__
+
+#include <st/st-widget.h>
+
+G_BEGIN_DECLS
+
+#define ST_TYPE_GRID_VIEW st_grid_view_get_type()
+
+#define ST_GRID_VIEW(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj), \
+  ST_TYPE_GRID_VIEW, StGridView))
+
+#define ST_GRID_VIEW_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST ((klass), \
+  ST_TYPE_GRID_VIEW, StGridViewClass))
+
+#define ST_IS_GRID_VIEW(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj), \
+  ST_TYPE_GRID_VIEW))
+
+#define ST_IS_GRID_VIEW_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass), \
+  ST_TYPE_GRID_VIEW))
+
+#define ST_GRID_VIEW_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj), \
+  ST_TYPE_GRID_VIEW, StGridViewClass))
+
+typedef struct _StGridView StGridView;
+typedef struct _StGridViewClass StGridViewClass;
+typedef struct _StGridViewPrivate StGridViewPrivate;
+
+/**
+ * StGridView:
+ *
+ * The contents of this structure are private and should only be accessed
+ * through the public API.
+ */
+struct _StGridView
+{
+  /*< private >*/
+  StWidget parent;
+
+  StGridViewPrivate *priv;
+};
+
+struct _StGridViewClass
+{
+  StWidgetClass parent_class;
+};
+
+GType st_grid_view_get_type (void);
+
+StWidget     *st_grid_view_new             (void);
+
+void          st_grid_view_set_n_items     (StGridView *view,
+                                            guint       n_items);
+guint         st_grid_view_get_n_items     (StGridView *view);
+
+void          st_grid_view_set_max_columns (StGridView *view,
+                                            guint       max_columns);
+guint         st_grid_view_get_max_columns (StGridView *view);
+
+void          st_grid_view_set_item_size   (StGridView *view,
+                                            gfloat      width,
+                                            gfloat      height);
+void          st_grid_view_get_item_size   (StGridView *view,
+                                            gfloat     *width,
+                                            gfloat     *height);
+
+void          st_grid_view_set_overscan    (StGridView *view,
+                                            guint       overscan);
+guint         st_grid_view_get_overscan    (StGridView *view);
+
+void          st_grid_view_items_changed   (StGridView *view);
+ClutterActor *st_grid_view_get_item        (StGridView *view,
+                                            guint       index);
+void          st_grid_view_get_cell_box    (StGridView      *view,
+                                            guint            index,
+                                            ClutterActorBox *box);
+
+G_END_DECLS
+
+#endif /* __ST_GRID_VIEW_H__ */
@@ -231,8 +231,8 @@ st_label_paint (ClutterActor *actor)
           if (priv->text_shadow_material != COGL_INVALID_HANDLE)
             cogl_handle_unref (priv->text_shadow_material);
 
-          material = _st_create_shadow_material_from_actor (shadow_spec,
-                                                            priv->label);
+          material = _st_get_text_shadow_material (shadow_spec,
+                                                   CLUTTER_TEXT (priv->label));
 
           priv->shadow_width = width;
           priv->shadow_height = height;
@@ -0,0 +1,260 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-offscreen-pool.c: Recycled textures for offscreen rendering
+ *
+ * Copyright 2012 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Transitions and offscreen effects render into a texture that only
+ * lives as long as the transition, or until the actor changes size.
+ * Hovering across a row of buttons starts a transition on each of
+ * them, so rather than allocating a texture and framebuffer every
+ * time we keep the released ones around and hand them out again.
+ *
+ * Sizes are rounded up to BUCKET_SIZE unless the caller needs an
+ * exact size, so a released texture can be reused for anything that
+ * fits in it; users are expected to only look at the top-left
+ * width x height of the texture. The memory kept in the pool is
+ * limited to MAX_FREE_BYTES, and textures that are bigger than
+ * MAX_TEXTURE_BYTES aren't kept at all.
+ */
+
+#include "config.h"
+
+#include "st-offscreen-pool.h"
+#include "st-private.h"
+
+#define BUCKET_SIZE 32
+#define MAX_TEXTURE_BYTES (4 * 1024 * 1024)
+#define MAX_FREE_BYTES (16 * 1024 * 1024)
+
+typedef struct {
+  CoglHandle texture;
+  CoglHandle offscreen;
+  int width;
+  int height;
+} PoolEntry;
+
+/* Most recently released first */
+static GList *free_entries = NULL;
+static gsize free_bytes = 0;
+
+/* CoglHandle => PoolEntry */
+static GHashTable *used_entries = NULL;
+
+static gsize
+entry_bytes (PoolEntry *entry)
+{
+  return (gsize) entry->width * entry->height * 4;
+}
+
+static void
+entry_free (PoolEntry *entry)
+{
+  if (entry->offscreen != COGL_INVALID_HANDLE)
+    cogl_handle_unref (entry->offscreen);
+  cogl_handle_unref (entry->texture);
+
+  g_slice_free (PoolEntry, entry);
+}
+
+static PoolEntry *
+take_free_entry (int      width,
+                 int      height,
+                 gboolean exact_size)
+{
+  PoolEntry *best = NULL;
+  GList *l, *best_link = NULL;
+
+  for (l = free_entries; l; l = l->next)
+    {
+      PoolEntry *entry = l->data;
+
+      if (exact_size)
+        {
+          if (entry->width != width || entry->height != height)
+            continue;
+        }
+      else
+        {
+          if (entry->width < width || entry->height < height)
+            continue;
+
+          /* Don't let a small transition hold on to a huge texture */
+          if (entry->width > width + BUCKET_SIZE * 2 ||
+              entry->height > height + BUCKET_SIZE * 2)
+            continue;
+        }
+
+      if (best == NULL || entry_bytes (entry) < entry_bytes (best))
+        {
+          best = entry;
+          best_link = l;
+        }
+    }
+
+  if (best != NULL)
+    {
+      free_entries = g_list_delete_link (free_entries, best_link);
+      free_bytes -= entry_bytes (best);
+    }
+
+  return best;
+}
+
+/**
+ * _st_offscreen_pool_acquire:
+ * @width: the width needed
+ * @height: the height needed
+ * @exact_size: %TRUE if the texture must be exactly @width x @height;
+ *   otherwise it may be bigger
+ * @offscreen: (out) (allow-none): location to store an offscreen
+ *   framebuffer targeting the texture, or %NULL if the caller doesn't
+ *   need one
+ *
+ * Gets a texture to render to, recycling one that was released with
+ * _st_offscreen_pool_release() if possible. The texture must be given
+ * back with _st_offscreen_pool_release() rather than unreferenced,
+ * and its contents are undefined.
+ *
+ * Return value: (transfer none): the texture, or %COGL_INVALID_HANDLE
+ *   if allocating it failed
+ */
+CoglHandle
+_st_offscreen_pool_acquire (int         width,
+                            int         height,
+                            gboolean    exact_size,
+                            CoglHandle *offscreen)
+{
+  PoolEntry *entry;
+
+  g_return_val_if_fail (width > 0 && height > 0, COGL_INVALID_HANDLE);
+
+  if (G_UNLIKELY (used_entries == NULL))
+    used_entries = g_hash_table_new (NULL, NULL);
+
+  entry = take_free_entry (width, height, exact_size);
+
+  if (entry != NULL)
+    {
+      _st_statistics_increment (ST_STATISTIC_OFFSCREEN_REUSES);
+    }
+  else
+    {
+      int alloc_width = width, alloc_height = height;
+
+      if (!exact_size)
+        {
+          alloc_width = (width + BUCKET_SIZE - 1) / BUCKET_SIZE * BUCKET_SIZE;
+          alloc_height = (height + BUCKET_SIZE - 1) / BUCKET_SIZE * BUCKET_SIZE;
+        }
+
+      entry = g_slice_new0 (PoolEntry);
+      entry->width = alloc_width;
+      entry->height = alloc_height;
+      entry->offscreen = COGL_INVALID_HANDLE;
+      entry->texture = cogl_texture_new_with_size (alloc_width, alloc_height,
+                                                   COGL_TEXTURE_NO_SLICING,
+                                                   COGL_PIXEL_FORMAT_RGBA_8888_PRE);
+
+      if (entry->texture == COGL_INVALID_HANDLE)
+        {
+          g_slice_free (PoolEntry, entry);
+          return COGL_INVALID_HANDLE;
+        }
+
+      _st_statistics_increment (ST_STATISTIC_OFFSCREEN_ALLOCATIONS);
+    }
+
+  if (offscreen != NULL)
+    {
+      if (entry->offscreen == COGL_INVALID_HANDLE)
+        entry->offscreen = cogl_offscreen_new_to_texture (entry->texture);
+
+      if (entry->offscreen == COGL_INVALID_HANDLE)
+        {
+          entry_free (entry);
+          return COGL_INVALID_HANDLE;
+        }
+
+      *offscreen = entry->offscreen;
+    }
+
+  g_hash_table_insert (used_entries, entry->texture, entry);
+
+  return entry->texture;
+}
+
+/**
+ * _st_offscreen_pool_release:
+ * @texture: a texture returned by _st_offscreen_pool_acquire()
+ *
+ * Gives back a texture, along with its offscreen framebuffer, so that
+ * it can be handed out again. If the pool is full, the least recently
+ * released textures are freed.
+ */
+void
+_st_offscreen_pool_release (CoglHandle texture)
+{
+  PoolEntry *entry;
+
+  entry = used_entries ? g_hash_table_lookup (used_entries, texture) : NULL;
+  g_return_if_fail (entry != NULL);
+
+  g_hash_table_remove (used_entries, texture);
+
+  if (entry_bytes (entry) > MAX_TEXTURE_BYTES)
+    {
+      entry_free (entry);
+      return;
+    }
+
+  free_entries = g_list_prepend (free_entries, entry);
+  free_bytes += entry_bytes (entry);
+
+  while (free_bytes > MAX_FREE_BYTES)
+    {
+      GList *last = g_list_last (free_entries);
+      PoolEntry *oldest = last->data;
+
+      free_entries = g_list_delete_link (free_entries, last);
+      free_bytes -= entry_bytes (oldest);
+      entry_free (oldest);
+    }
+}
+
+/**
+ * _st_offscreen_pool_get_bytes:
+ *
+ * Return value: the memory used by the textures of the pool, both the
+ *   ones handed out and the ones kept for reuse, in bytes
+ */
+gsize
+_st_offscreen_pool_get_bytes (void)
+{
+  GHashTableIter iter;
+  gpointer value;
+  gsize bytes = free_bytes;
+
+  if (used_entries == NULL)
+    return bytes;
+
+  g_hash_table_iter_init (&iter, used_entries);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    bytes += entry_bytes (value);
+
+  return bytes;
+}
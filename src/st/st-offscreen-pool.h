@@ -0,0 +1,38 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-offscreen-pool.h: Recycled textures for offscreen rendering
+ *
+ * Copyright 2012 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __ST_OFFSCREEN_POOL_H__
+#define __ST_OFFSCREEN_POOL_H__
+
+#include <cogl/cogl.h>
+
+G_BEGIN_DECLS
+
+CoglHandle _st_offscreen_pool_acquire (int         width,
+                                       int         height,
+                                       gboolean    exact_size,
+                                       CoglHandle *offscreen);
+void       _st_offscreen_pool_release (CoglHandle  texture);
+
+gsize      _st_offscreen_pool_get_bytes (void);
+
+G_END_DECLS
+
+#endif /* __ST_OFFSCREEN_POOL_H__ */
@@ -520,6 +520,148 @@ _st_create_shadow_material_from_actor (StShadow     *shadow_spec,
   return shadow_material;
 }
 
+/* Text shadows of recently painted labels, so that a label cycling
+ * through the same strings (a clock, a counter) or many labels
+ * showing the same string only render and blur each one once.
+ */
+#define TEXT_SHADOW_CACHE_SIZE 64
+
+typedef struct {
+  char       *key;
+  CoglHandle  material;
+} TextShadowEntry;
+
+static GHashTable *text_shadow_cache = NULL;  /* key => GList link in text_shadow_lru */
+static GQueue text_shadow_lru = G_QUEUE_INIT; /* of TextShadowEntry, most recent first */
+
+static char *
+get_text_shadow_key (StShadow    *shadow_spec,
+                     ClutterText *text,
+                     float        width,
+                     float        height)
+{
+  PangoFontDescription *font_desc;
+  ClutterColor color;
+  char *font, *key;
+
+  /* Arbitrary attribute lists can't be compared cheaply */
+  if (clutter_text_get_attributes (text) != NULL)
+    return NULL;
+
+  /* The text is captured at its paint opacity, so a shadow created
+   * while it's translucent (fading in, say) has a reduced alpha that
+   * would be wrong for anybody else; only share opaque captures. */
+  if (clutter_actor_get_paint_opacity (CLUTTER_ACTOR (text)) != 0xff)
+    return NULL;
+
+  font_desc = clutter_text_get_font_description (text);
+  font = font_desc ? pango_font_description_to_string (font_desc) : NULL;
+  clutter_text_get_color (text, &color);
+
+  /* The shadow material only depends on the alpha of what's painted
+   * and the blur radius; color, offset and spread are applied when
+   * painting it. */
+  key = g_strdup_printf ("%s|%u|%g|%gx%g|%d%d%d%d%d%d%d|%s",
+                         font ? font : "",
+                         color.alpha,
+                         shadow_spec->blur,
+                         width, height,
+                         clutter_text_get_use_markup (text),
+                         clutter_text_get_single_line_mode (text),
+                         clutter_text_get_line_wrap (text),
+                         clutter_text_get_line_wrap_mode (text),
+                         clutter_text_get_ellipsize (text),
+                         clutter_text_get_line_alignment (text),
+                         clutter_text_get_justify (text),
+                         clutter_text_get_text (text));
+  g_free (font);
+
+  return key;
+}
+
+static void
+text_shadow_entry_free (TextShadowEntry *entry)
+{
+  g_hash_table_remove (text_shadow_cache, entry->key);
+  g_free (entry->key);
+  cogl_handle_unref (entry->material);
+  g_slice_free (TextShadowEntry, entry);
+}
+
+/**
+ * _st_get_text_shadow_material:
+ * @shadow_spec: the shadow to create
+ * @text: the text to create a shadow for
+ *
+ * Like _st_create_shadow_material_from_actor(), but shares the result
+ * with other #ClutterText actors showing the same text with the same
+ * font, size and layout options.
+ *
+ * Return value: (transfer full): a new reference to the shadow
+ *   material, or %COGL_INVALID_HANDLE
+ */
+CoglHandle
+_st_get_text_shadow_material (StShadow    *shadow_spec,
+                              ClutterText *text)
+{
+  TextShadowEntry *entry;
+  ClutterActorBox box;
+  float width, height;
+  GList *link;
+  char *key;
+
+  g_return_val_if_fail (shadow_spec != NULL, COGL_INVALID_HANDLE);
+
+  clutter_actor_get_allocation_box (CLUTTER_ACTOR (text), &box);
+  clutter_actor_box_get_size (&box, &width, &height);
+
+  if (width == 0 || height == 0)
+    return COGL_INVALID_HANDLE;
+
+  key = get_text_shadow_key (shadow_spec, text, width, height);
+  if (key == NULL)
+    return _st_create_shadow_material_from_actor (shadow_spec, CLUTTER_ACTOR (text));
+
+  if (G_UNLIKELY (text_shadow_cache == NULL))
+    text_shadow_cache = g_hash_table_new (g_str_hash, g_str_equal);
+
+  link = g_hash_table_lookup (text_shadow_cache, key);
+  if (link != NULL)
+    {
+      g_free (key);
+
+      g_queue_unlink (&text_shadow_lru, link);
+      g_queue_push_head_link (&text_shadow_lru, link);
+
+      _st_statistics_increment (ST_STATISTIC_TEXT_SHADOW_CACHE_HITS);
+
+      entry = link->data;
+      return cogl_handle_ref (entry->material);
+    }
+
+  entry = g_slice_new (TextShadowEntry);
+  entry->key = key;
+  entry->material = _st_create_shadow_material_from_actor (shadow_spec,
+                                                           CLUTTER_ACTOR (text));
+
+  if (entry->material == COGL_INVALID_HANDLE)
+    {
+      g_free (entry->key);
+      g_slice_free (TextShadowEntry, entry);
+      return COGL_INVALID_HANDLE;
+    }
+
+  _st_statistics_increment (ST_STATISTIC_TEXT_SHADOWS_CREATED);
+
+  g_queue_push_head (&text_shadow_lru, entry);
+  g_hash_table_insert (text_shadow_cache, entry->key, text_shadow_lru.head);
+
+  if (text_shadow_lru.length > TEXT_SHADOW_CACHE_SIZE)
+    text_shadow_entry_free (g_queue_pop_tail (&text_shadow_lru));
+
+  return cogl_handle_ref (entry->material);
+}
+
 /**
  * _st_create_shadow_cairo_pattern:
  * @shadow_spec: the definition of the shadow
@@ -691,3 +833,60 @@ _st_paint_shadow_with_opacity (StShadow        *shadow_spec,
                                       shadow_box.x2, shadow_box.y2,
                                       0, 0, 1, 1);
 }
+
+static GHashTable *shader_cache = NULL;
+
+/**
+ * _st_get_shader_for_source:
+ * @fragment_source: GLSL source of a fragment shader
+ *
+ * Looks up a fragment shader for @fragment_source, creating it the
+ * first time the source is seen, so that every effect using the same
+ * source shares a single shader. Effects still need a program of their
+ * own to attach it to, since uniforms are stored on the program.
+ *
+ * Returns: (transfer none): the shader, or %COGL_INVALID_HANDLE if
+ *   GLSL isn't available or the shader failed to compile. Failures are
+ *   cached as well.
+ */
+CoglHandle
+_st_get_shader_for_source (const char *fragment_source)
+{
+  CoglHandle shader;
+  gint64 start;
+
+  if (G_UNLIKELY (shader_cache == NULL))
+    shader_cache = g_hash_table_new (g_str_hash, g_str_equal);
+
+  if (g_hash_table_lookup_extended (shader_cache, fragment_source, NULL, &shader))
+    return shader;
+
+  shader = COGL_INVALID_HANDLE;
+
+  if (clutter_feature_available (CLUTTER_FEATURE_SHADERS_GLSL))
+    {
+      start = g_get_monotonic_time ();
+
+      shader = cogl_create_shader (COGL_SHADER_TYPE_FRAGMENT);
+      cogl_shader_source (shader, fragment_source);
+      cogl_shader_compile (shader);
+
+      if (!cogl_shader_is_compiled (shader))
+        {
+          gchar *log_buf = cogl_shader_get_info_log (shader);
+
+          g_warning (G_STRLOC ": Unable to compile shader: %s", log_buf);
+          g_free (log_buf);
+
+          cogl_handle_unref (shader);
+          shader = COGL_INVALID_HANDLE;
+        }
+
+      _st_statistics_event (ST_STATISTIC_SHADER_COMPILES,
+                            g_get_monotonic_time () - start);
+    }
+
+  g_hash_table_insert (shader_cache, g_strdup (fragment_source), shader);
+
+  return shader;
+}
@@ -28,6 +28,7 @@
 #include "st-widget.h"
 #include "st-bin.h"
 #include "st-shadow.h"
+#include "st-statistics.h"
 
 G_BEGIN_DECLS
 
@@ -71,6 +72,8 @@ CoglHandle _st_create_shadow_material (StShadow   *shadow_spec,
                                        CoglHandle  src_texture);
 CoglHandle _st_create_shadow_material_from_actor (StShadow     *shadow_spec,
                                                   ClutterActor *actor);
+CoglHandle _st_get_text_shadow_material (StShadow    *shadow_spec,
+                                         ClutterText *text);
 cairo_pattern_t *_st_create_shadow_cairo_pattern (StShadow        *shadow_spec,
                                                   cairo_pattern_t *src_pattern);
 
@@ -79,4 +82,15 @@ void _st_paint_shadow_with_opacity (StShadow        *shadow_spec,
                                     ClutterActorBox *box,
                                     guint8           paint_opacity);
 
+void _st_statistics_increment (StStatistic statistic);
+void _st_statistics_event     (StStatistic statistic,
+                               gint64      value);
+
+void _st_statistics_instance_created   (GObject *object);
+void _st_statistics_instance_finalized (GObject *object);
+
+gsize _st_texture_cache_get_bytes (void);
+
+CoglHandle _st_get_shader_for_source (const char *fragment_source);
+
 #endif /* __ST_PRIVATE_H__ */
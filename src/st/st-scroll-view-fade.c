@@ -24,6 +24,8 @@
 #define ST_SCROLL_VIEW_FADE_GET_CLASS(obj)      (G_TYPE_INSTANCE_GET_CLASS ((obj), ST_TYPE_SCROLL_VIEW_FADE, StScrollViewFadeClass))
 
 #include "st-scroll-view-fade.h"
+#include "st-offscreen-pool.h"
+#include "st-private.h"
 #include "st-scroll-view.h"
 #include "st-widget.h"
 #include "st-theme-node.h"
@@ -100,6 +102,8 @@ struct _StScrollViewFade
   /* a back pointer to our actor, so that we can query it */
   ClutterActor *actor;
 
+  /* Shared between all instances, see _st_get_shader_for_source();
+   * the program holds our uniforms, so it is per instance */
   CoglHandle shader;
   CoglHandle program;
 
@@ -112,11 +116,13 @@ struct _StScrollViewFade
   gint offset_left_uniform;
   gint offset_right_uniform;
 
+  /* Borrowed from the offscreen pool; ClutterOffscreenEffect holds
+   * its own reference while it renders to it */
+  CoglHandle texture;
+
   StAdjustment *vadjustment;
   StAdjustment *hadjustment;
 
-  guint is_attached : 1;
-
   float vfade_offset;
   float hfade_offset;
 };
@@ -153,20 +159,11 @@ st_scroll_view_fade_pre_paint (ClutterEffect *effect)
     return FALSE;
 
   if (self->program == COGL_INVALID_HANDLE)
-    self->program = cogl_create_program ();
-
-  if (!self->is_attached)
     {
-      g_assert (self->shader != COGL_INVALID_HANDLE);
-      g_assert (self->program != COGL_INVALID_HANDLE);
-
+      self->program = cogl_create_program ();
       cogl_program_attach_shader (self->program, self->shader);
       cogl_program_link (self->program);
 
-      cogl_handle_unref (self->shader);
-
-      self->is_attached = TRUE;
-
       self->tex_uniform =
         cogl_program_get_uniform_location (self->program, "tex");
       self->height_uniform =
@@ -194,10 +191,19 @@ st_scroll_view_fade_create_texture (ClutterOffscreenEffect *effect,
                                     gfloat                  min_width,
                                     gfloat                  min_height)
 {
-  return cogl_texture_new_with_size (min_width,
-                                     min_height,
-                                     COGL_TEXTURE_NO_SLICING,
-                                     COGL_PIXEL_FORMAT_RGBA_8888_PRE);
+  StScrollViewFade *self = ST_SCROLL_VIEW_FADE (effect);
+
+  /* ClutterOffscreenEffect only asks for a new texture when the size
+   * changes, after dropping the previous one. It paints the whole
+   * texture, so we need the exact size. */
+  if (self->texture != COGL_INVALID_HANDLE)
+    _st_offscreen_pool_release (self->texture);
+
+  self->texture = _st_offscreen_pool_acquire (min_width, min_height, TRUE, NULL);
+  if (self->texture == COGL_INVALID_HANDLE)
+    return COGL_INVALID_HANDLE;
+
+  return cogl_handle_ref (self->texture);
 }
 
 static void
@@ -396,9 +402,7 @@ st_scroll_view_fade_dispose (GObject *gobject)
   if (self->program != COGL_INVALID_HANDLE)
     {
       cogl_handle_unref (self->program);
-
       self->program = COGL_INVALID_HANDLE;
-      self->shader = COGL_INVALID_HANDLE;
     }
 
   if (self->vadjustment)
@@ -420,6 +424,15 @@ st_scroll_view_fade_dispose (GObject *gobject)
   self->actor = NULL;
 
   G_OBJECT_CLASS (st_scroll_view_fade_parent_class)->dispose (gobject);
+
+  /* Only return the texture to the pool once ClutterOffscreenEffect
+   * dropped its own reference and framebuffer, so that nobody else
+   * gets it while it is still rendered to */
+  if (self->texture != COGL_INVALID_HANDLE)
+    {
+      _st_offscreen_pool_release (self->texture);
+      self->texture = COGL_INVALID_HANDLE;
+    }
 }
 
 static void
@@ -542,42 +555,19 @@ st_scroll_view_fade_class_init (StScrollViewFadeClass *klass)
 static void
 st_scroll_view_fade_init (StScrollViewFade *self)
 {
-  static CoglHandle shader = COGL_INVALID_HANDLE;
-
-  if (shader == COGL_INVALID_HANDLE)
-    {
-      if (clutter_feature_available (CLUTTER_FEATURE_SHADERS_GLSL))
-        {
-          shader = cogl_create_shader (COGL_SHADER_TYPE_FRAGMENT);
-          cogl_shader_source (shader, fade_glsl_shader);
-          cogl_shader_compile (shader);
-          if (!cogl_shader_is_compiled (shader))
-            {
-              gchar *log_buf = cogl_shader_get_info_log (shader);
-
-              g_warning (G_STRLOC ": Unable to compile the fade shader: %s",
-                         log_buf);
-              g_free (log_buf);
-
-              cogl_handle_unref (shader);
-              shader = COGL_INVALID_HANDLE;
-          }
-        }
-    }
-
-  self->shader = shader;
-  self->is_attached = FALSE;
+  self->shader = _st_get_shader_for_source (fade_glsl_shader);
+  self->program = COGL_INVALID_HANDLE;
   self->tex_uniform = -1;
   self->height_uniform = -1;
   self->width_uniform = -1;
   self->fade_area_uniform = -1;
   self->offset_top_uniform = -1;
   self->offset_bottom_uniform = -1;
+  self->offset_left_uniform = -1;
+  self->offset_right_uniform = -1;
+  self->texture = COGL_INVALID_HANDLE;
   self->vfade_offset = DEFAULT_FADE_OFFSET;
   self->hfade_offset = DEFAULT_FADE_OFFSET;
-
-  if (shader != COGL_INVALID_HANDLE)
-    cogl_handle_ref (self->shader);
 }
 
 ClutterEffect *
@@ -0,0 +1,179 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-statistics.c: Counters for performance measurement
+ *
+ * Copyright 2012 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "st-statistics.h"
+#include "st-offscreen-pool.h"
+#include "st-private.h"
+
+/**
+ * SECTION:st-statistics
+ * @short_description: Counters for performance measurement
+ *
+ * St counts a few interesting events, such as cairo rasterizations of
+ * theme node backgrounds, so that they can be fed into a performance
+ * log. It also counts the live widgets of each type, to find out what
+ * is leaked. All counters are only accessed from the main thread.
+ */
+
+static guint counters[ST_STATISTIC_LAST];
+
+/* GType => number of live widgets of exactly that type */
+static GHashTable *instance_counts;
+
+static StStatisticsEventFunc event_func;
+static gpointer event_func_data;
+
+void
+_st_statistics_increment (StStatistic statistic)
+{
+  g_return_if_fail (statistic < ST_STATISTIC_LAST);
+
+  counters[statistic]++;
+}
+
+void
+_st_statistics_event (StStatistic statistic,
+                      gint64      value)
+{
+  g_return_if_fail (statistic < ST_STATISTIC_LAST);
+
+  counters[statistic]++;
+
+  if (event_func)
+    event_func (statistic, value, event_func_data);
+}
+
+/**
+ * st_statistics_get:
+ * @statistic: a #StStatistic
+ *
+ * Returns: the number of times the event counted by @statistic
+ *   happened since startup
+ */
+guint
+st_statistics_get (StStatistic statistic)
+{
+  g_return_val_if_fail (statistic < ST_STATISTIC_LAST, 0);
+
+  return counters[statistic];
+}
+
+/**
+ * st_statistics_set_event_func: (skip)
+ * @func: function to call when an event is recorded, or %NULL
+ * @user_data: data to pass to @func
+ *
+ * Sets a function to be called for each occurrence of the rare
+ * statistics that are reported as events, such as
+ * %ST_STATISTIC_SHADER_COMPILES.
+ */
+void
+st_statistics_set_event_func (StStatisticsEventFunc func,
+                              gpointer              user_data)
+{
+  event_func = func;
+  event_func_data = user_data;
+}
+
+void
+_st_statistics_instance_created (GObject *object)
+{
+  GType type = G_OBJECT_TYPE (object);
+  guint count;
+
+  if (G_UNLIKELY (instance_counts == NULL))
+    instance_counts = g_hash_table_new (NULL, NULL);
+
+  count = GPOINTER_TO_UINT (g_hash_table_lookup (instance_counts, GSIZE_TO_POINTER (type)));
+  g_hash_table_insert (instance_counts, GSIZE_TO_POINTER (type), GUINT_TO_POINTER (count + 1));
+}
+
+void
+_st_statistics_instance_finalized (GObject *object)
+{
+  GType type = G_OBJECT_TYPE (object);
+  guint count;
+
+  count = GPOINTER_TO_UINT (g_hash_table_lookup (instance_counts, GSIZE_TO_POINTER (type)));
+  g_return_if_fail (count > 0);
+
+  if (count == 1)
+    g_hash_table_remove (instance_counts, GSIZE_TO_POINTER (type));
+  else
+    g_hash_table_insert (instance_counts, GSIZE_TO_POINTER (type), GUINT_TO_POINTER (count - 1));
+}
+
+/**
+ * st_statistics_get_instance_types:
+ *
+ * Returns: (transfer full): the names of the types that live #StWidget
+ *   instances have, including subclasses defined outside of St
+ */
+char **
+st_statistics_get_instance_types (void)
+{
+  GHashTableIter iter;
+  gpointer key;
+  char **types;
+  int i = 0;
+
+  if (instance_counts == NULL)
+    return g_new0 (char *, 1);
+
+  types = g_new (char *, g_hash_table_size (instance_counts) + 1);
+
+  g_hash_table_iter_init (&iter, instance_counts);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    types[i++] = g_strdup (g_type_name (GPOINTER_TO_SIZE (key)));
+  types[i] = NULL;
+
+  return types;
+}
+
+/**
+ * st_statistics_get_instance_count:
+ * @type_name: name of a type
+ *
+ * Returns: the number of live widgets whose type is exactly @type_name
+ */
+guint
+st_statistics_get_instance_count (const char *type_name)
+{
+  GType type = g_type_from_name (type_name);
+
+  if (type == 0 || instance_counts == NULL)
+    return 0;
+
+  return GPOINTER_TO_UINT (g_hash_table_lookup (instance_counts, GSIZE_TO_POINTER (type)));
+}
+
+/**
+ * st_statistics_get_texture_bytes:
+ *
+ * Returns: the memory used by textures that St keeps, in the texture
+ *   cache and for offscreen rendering, in bytes
+ */
+guint
+st_statistics_get_texture_bytes (void)
+{
+  return _st_texture_cache_get_bytes () + _st_offscreen_pool_get_bytes ();
+}
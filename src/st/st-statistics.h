@@ -0,0 +1,109 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-statistics.h: Counters for performance measurement
+ *
+ * Copyright 2012 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if !defined(ST_H_INSIDE) && !defined(ST_COMPILATION)
+#error "Only <st/st.h> can be included directly.h"
+#endif
+
+#ifndef __ST_STATISTICS_H__
+#define __ST_STATISTICS_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+/**
+ * StStatistic:
+ * @ST_STATISTIC_PRERENDERS: number of times a theme node background was
+ *   rasterized with cairo
+ * @ST_STATISTIC_SLICED_PAINTS: number of size changes that reused a
+ *   nine-slice prerendered background instead of rasterizing it again
+ * @ST_STATISTIC_PAINTED_CHILDREN: number of children painted or picked
+ *   by #StBoxLayout, after skipping the ones scrolled out of view
+ * @ST_STATISTIC_SHADER_COMPILES: number of GLSL shaders created for
+ *   effects; this is also reported as an event, with the time spent in
+ *   Cogl in microseconds. Cogl defers the GL compile and link to the
+ *   first paint with the shader, so that time is not included.
+ * @ST_STATISTIC_OFFSCREEN_ALLOCATIONS: number of textures allocated for
+ *   theme node transitions and offscreen effects
+ * @ST_STATISTIC_OFFSCREEN_REUSES: number of times such a texture was
+ *   recycled instead of being allocated
+ * @ST_STATISTIC_TEXT_SHADOWS_CREATED: number of label text shadows
+ *   rendered and blurred
+ * @ST_STATISTIC_TEXT_SHADOW_CACHE_HITS: number of label text shadows
+ *   found in the cache instead
+ * @ST_STATISTIC_THEME_NODES_RECOMPUTED: number of times a widget got a
+ *   new theme node because its style or the style of an ancestor changed
+ * @ST_STATISTIC_HOVER_CHANGES: number of times the #StWidget:hover
+ *   property changed on any widget
+ * @ST_STATISTIC_TABLE_TRACKS_COMPUTED: number of times #StTable measured
+ *   its children to compute column widths and row heights
+ * @ST_STATISTIC_TABLE_TRACKS_REUSED: number of #StTable allocations that
+ *   reused the column widths and row heights from the previous one
+ * @ST_STATISTIC_THEME_NODE_DRAW_CALLS: number of rectangle batches
+ *   submitted to Cogl to paint theme node backgrounds, borders and
+ *   outlines
+ *
+ * Counters that St keeps for performance measurement; they only ever
+ * increase, see st_statistics_get().
+ */
+typedef enum {
+  ST_STATISTIC_PRERENDERS,
+  ST_STATISTIC_SLICED_PAINTS,
+  ST_STATISTIC_PAINTED_CHILDREN,
+  ST_STATISTIC_SHADER_COMPILES,
+  ST_STATISTIC_OFFSCREEN_ALLOCATIONS,
+  ST_STATISTIC_OFFSCREEN_REUSES,
+  ST_STATISTIC_TEXT_SHADOWS_CREATED,
+  ST_STATISTIC_TEXT_SHADOW_CACHE_HITS,
+  ST_STATISTIC_THEME_NODES_RECOMPUTED,
+  ST_STATISTIC_HOVER_CHANGES,
+  ST_STATISTIC_TABLE_TRACKS_COMPUTED,
+  ST_STATISTIC_TABLE_TRACKS_REUSED,
+  ST_STATISTIC_THEME_NODE_DRAW_CALLS,
+
+  ST_STATISTIC_LAST
+} StStatistic;
+
+/**
+ * StStatisticsEventFunc:
+ * @statistic: the #StStatistic that was incremented
+ * @value: a value associated with this occurrence, such as a duration
+ * @user_data: data passed to st_statistics_set_event_func()
+ *
+ * Called for the statistics that are rare enough to be reported
+ * individually.
+ */
+typedef void (*StStatisticsEventFunc) (StStatistic statistic,
+                                       gint64      value,
+                                       gpointer    user_data);
+
+guint st_statistics_get            (StStatistic           statistic);
+void  st_statistics_set_event_func (StStatisticsEventFunc func,
+                                    gpointer              user_data);
+
+guint   st_statistics_get_texture_bytes  (void);
+
+char  **st_statistics_get_instance_types (void);
+guint   st_statistics_get_instance_count (const char *type_name);
+
+G_END_DECLS
+
+#endif /* __ST_STATISTICS_H__ */
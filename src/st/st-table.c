@@ -80,6 +80,15 @@ struct _StTablePrivate
   GArray *col_widths;
   GArray *row_heights;
 
+  /* col_widths and row_heights were computed for these content box
+   * sizes, while layout_generation was tracks_generation. The
+   * generation changes each time a relayout is queued on the table,
+   * which includes size changes of children. */
+  guint   layout_generation;
+  guint   tracks_generation;
+  gint    tracks_for_width;
+  gint    tracks_for_height;
+
   guint   homogeneous : 1;
 };
 
@@ -557,6 +566,48 @@ st_table_calculate_row_heights (StTable *table,
   return row_heights;
 }
 
+/* Computes the column widths and row heights for a content box of the
+ * given size, or returns the ones from the last allocation if nothing
+ * changed since. */
+static void
+st_table_ensure_tracks (StTable  *table,
+                        gint      for_width,
+                        gint      for_height,
+                        gint    **col_widths,
+                        gint    **row_heights)
+{
+  StTablePrivate *priv = table->priv;
+
+  if (priv->tracks_generation != priv->layout_generation ||
+      priv->tracks_for_width != for_width ||
+      priv->tracks_for_height != for_height)
+    {
+      gint *widths;
+
+      /* st_table_calculate_col_widths() returns a pointer to
+       * priv->pref_widths, which is also used for size requests */
+      widths = st_table_calculate_col_widths (table, for_width);
+      g_array_set_size (priv->col_widths, priv->n_cols);
+      memcpy (priv->col_widths->data, widths, priv->n_cols * sizeof (gint));
+
+      st_table_calculate_row_heights (table, for_height,
+                                      (gint *) priv->col_widths->data);
+
+      priv->tracks_generation = priv->layout_generation;
+      priv->tracks_for_width = for_width;
+      priv->tracks_for_height = for_height;
+
+      _st_statistics_increment (ST_STATISTIC_TABLE_TRACKS_COMPUTED);
+    }
+  else
+    {
+      _st_statistics_increment (ST_STATISTIC_TABLE_TRACKS_REUSED);
+    }
+
+  *col_widths = (gint *) priv->col_widths->data;
+  *row_heights = (gint *) priv->row_heights->data;
+}
+
 static void
 st_table_preferred_allocate (ClutterActor          *self,
                              const ClutterActorBox *content_box,
@@ -576,14 +627,10 @@ st_table_preferred_allocate (ClutterActor          *self,
   col_spacing = (priv->col_spacing);
   row_spacing = (priv->row_spacing);
 
-  col_widths =
-    st_table_calculate_col_widths (table,
-                                   (int) (content_box->x2 - content_box->x1));
-
-  row_heights =
-    st_table_calculate_row_heights (table,
-                                    (int) (content_box->y2 - content_box->y1),
-                                    col_widths);
+  st_table_ensure_tracks (table,
+                          (int) (content_box->x2 - content_box->x1),
+                          (int) (content_box->y2 - content_box->y1),
+                          &col_widths, &row_heights);
 
   ltr = (clutter_actor_get_text_direction (self) == CLUTTER_TEXT_DIRECTION_LTR);
 
@@ -897,6 +944,14 @@ st_table_get_preferred_height (ClutterActor *self,
   st_theme_node_adjust_preferred_height (theme_node, min_height_p, natural_height_p);
 }
 
+static void
+st_table_queue_relayout (ClutterActor *self)
+{
+  ST_TABLE (self)->priv->layout_generation++;
+
+  CLUTTER_ACTOR_CLASS (st_table_parent_class)->queue_relayout (self);
+}
+
 static void
 st_table_style_changed (StWidget *self)
 {
@@ -936,6 +991,7 @@ st_table_class_init (StTableClass *klass)
   actor_class->allocate = st_table_allocate;
   actor_class->get_preferred_width = st_table_get_preferred_width;
   actor_class->get_preferred_height = st_table_get_preferred_height;
+  actor_class->queue_relayout = st_table_queue_relayout;
 
   widget_class->style_changed = st_table_style_changed;
 
@@ -975,6 +1031,9 @@ st_table_init (StTable *table)
   table->priv->n_cols = 0;
   table->priv->n_rows = 0;
 
+  table->priv->layout_generation = 1;
+  table->priv->tracks_generation = 0;
+
   table->priv->min_widths = g_array_new (FALSE,
                                          TRUE,
                                          sizeof (gint));
@@ -1485,3 +1485,33 @@ st_texture_cache_get_default (void)
     instance = g_object_new (ST_TYPE_TEXTURE_CACHE, NULL);
   return instance;
 }
+
+/**
+ * _st_texture_cache_get_bytes:
+ *
+ * Return value: the memory used by the textures and cairo surfaces
+ *   kept in the default texture cache, in bytes, assuming 4 bytes per
+ *   texture pixel
+ */
+gsize
+_st_texture_cache_get_bytes (void)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+  gsize bytes = 0;
+
+  if (instance == NULL)
+    return 0;
+
+  g_hash_table_iter_init (&iter, instance->priv->keyed_cache);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      /* These entries are image surfaces rather than textures */
+      if (g_str_has_prefix (key, CACHE_PREFIX_URI_FOR_CAIRO))
+        bytes += (gsize) cairo_image_surface_get_stride (value) * cairo_image_surface_get_height (value);
+      else
+        bytes += (gsize) cogl_texture_get_width (value) * cogl_texture_get_height (value) * 4;
+    }
+
+  return bytes;
+}
@@ -28,6 +28,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #include "st-shadow.h"
@@ -950,6 +951,8 @@ st_theme_node_prerender_background (StThemeNode *node)
   ClutterActorBox paint_box;
   cairo_path_t *interior_path = NULL;
 
+  _st_statistics_increment (ST_STATISTIC_PRERENDERS);
+
   border_image = st_theme_node_get_border_image (node);
 
   shadow_spec = st_theme_node_get_background_image_shadow (node);
@@ -1261,6 +1264,198 @@ st_theme_node_prerender_background (StThemeNode *node)
   return texture;
 }
 
+/* Width of the stretchable center of a nine-slice prerendered texture;
+ * only the middle column/row of it is sampled so that linear filtering
+ * never picks up pixels from the edges.
+ */
+#define SLICE_CENTER_SIZE 3
+
+/* Figures out whether the cairo prerendered background of @node can
+ * be rendered once at a small size and stretched as nine slices (or
+ * three, for linear gradients, which can only be stretched across the
+ * gradient direction) to any size. On success, the prerendered texture
+ * is sized @width x @height in node->slice_width/height and the edges
+ * that must not be stretched are stored in node->slice.
+ */
+static gboolean
+st_theme_node_compute_slices (StThemeNode *node,
+                              float        width,
+                              float        height)
+{
+  StShadow *box_shadow_spec;
+  float extra_x = 0, extra_y = 0;
+  gboolean x_sliced, y_sliced;
+  guint *radius = node->border_radius;
+  int *border = node->border_width;
+
+  /* Background and border images are positioned relative to the whole
+   * node and radial gradients vary in both directions.
+   */
+  if (st_theme_node_get_background_image (node) != NULL ||
+      st_theme_node_get_border_image (node) != NULL ||
+      node->background_gradient_type == ST_GRADIENT_RADIAL)
+    return FALSE;
+
+  box_shadow_spec = st_theme_node_get_box_shadow (node);
+  if (box_shadow_spec)
+    {
+      /* Outer shadows are blurred from the whole prerendered texture,
+       * and inset shadows with spread scale with the node size.
+       */
+      if (!box_shadow_spec->inset || box_shadow_spec->spread != 0)
+        return FALSE;
+
+      extra_x = ceil (ABS (box_shadow_spec->xoffset) + 2 * box_shadow_spec->blur);
+      extra_y = ceil (ABS (box_shadow_spec->yoffset) + 2 * box_shadow_spec->blur);
+    }
+
+  node->slice[ST_SIDE_LEFT] = MAX (MAX (radius[ST_CORNER_TOPLEFT],
+                                        radius[ST_CORNER_BOTTOMLEFT]),
+                                   border[ST_SIDE_LEFT]) + extra_x;
+  node->slice[ST_SIDE_RIGHT] = MAX (MAX (radius[ST_CORNER_TOPRIGHT],
+                                         radius[ST_CORNER_BOTTOMRIGHT]),
+                                    border[ST_SIDE_RIGHT]) + extra_x;
+  node->slice[ST_SIDE_TOP] = MAX (MAX (radius[ST_CORNER_TOPLEFT],
+                                       radius[ST_CORNER_TOPRIGHT]),
+                                  border[ST_SIDE_TOP]) + extra_y;
+  node->slice[ST_SIDE_BOTTOM] = MAX (MAX (radius[ST_CORNER_BOTTOMLEFT],
+                                          radius[ST_CORNER_BOTTOMRIGHT]),
+                                     border[ST_SIDE_BOTTOM]) + extra_y;
+
+  /* Slicing only pays off if there is something to stretch */
+  x_sliced = (node->background_gradient_type != ST_GRADIENT_HORIZONTAL &&
+              width >= node->slice[ST_SIDE_LEFT] + node->slice[ST_SIDE_RIGHT] + SLICE_CENTER_SIZE);
+  y_sliced = (node->background_gradient_type != ST_GRADIENT_VERTICAL &&
+              height >= node->slice[ST_SIDE_TOP] + node->slice[ST_SIDE_BOTTOM] + SLICE_CENTER_SIZE);
+
+  if (!x_sliced && !y_sliced)
+    return FALSE;
+
+  node->prerendered_x_sliced = x_sliced;
+  node->prerendered_y_sliced = y_sliced;
+
+  node->slice_width = x_sliced ? node->slice[ST_SIDE_LEFT] + SLICE_CENTER_SIZE + node->slice[ST_SIDE_RIGHT]
+                               : width;
+  node->slice_height = y_sliced ? node->slice[ST_SIDE_TOP] + SLICE_CENTER_SIZE + node->slice[ST_SIDE_BOTTOM]
+                                : height;
+
+  return TRUE;
+}
+
+/* Whether the current sliced prerendered texture can be painted at
+ * @width x @height without rendering it again.
+ */
+static gboolean
+st_theme_node_can_reuse_slices (StThemeNode *node,
+                                float        width,
+                                float        height)
+{
+  if (node->prerendered_material == COGL_INVALID_HANDLE ||
+      !(node->prerendered_x_sliced || node->prerendered_y_sliced))
+    return FALSE;
+
+  if (node->prerendered_x_sliced)
+    {
+      if (width < node->slice[ST_SIDE_LEFT] + node->slice[ST_SIDE_RIGHT] + SLICE_CENTER_SIZE)
+        return FALSE;
+    }
+  else if (width != node->alloc_width)
+    return FALSE;
+
+  if (node->prerendered_y_sliced)
+    {
+      if (height < node->slice[ST_SIDE_TOP] + node->slice[ST_SIDE_BOTTOM] + SLICE_CENTER_SIZE)
+        return FALSE;
+    }
+  else if (height != node->alloc_height)
+    return FALSE;
+
+  return TRUE;
+}
+
+/* Splits one axis of a sliced paint into up to three segments and
+ * returns their number; segment i spans @pos[i] to @pos[i + 1] and
+ * samples the texture from @coords[2 * i] to @coords[2 * i + 1].
+ */
+static int
+compute_slice_segments (gboolean  sliced,
+                        float     start,
+                        float     end,
+                        float     size,
+                        float     texture_size,
+                        float    *pos,
+                        float    *coords)
+{
+  if (!sliced)
+    {
+      pos[0] = 0;
+      pos[1] = size;
+      coords[0] = 0;
+      coords[1] = 1;
+      return 1;
+    }
+
+  pos[0] = 0;
+  pos[1] = start;
+  pos[2] = size - end;
+  pos[3] = size;
+
+  coords[0] = 0;
+  coords[1] = start / texture_size;
+  /* Only sample the middle pixel of the center */
+  coords[2] = (start + 1) / texture_size;
+  coords[3] = (start + 2) / texture_size;
+  coords[4] = (texture_size - end) / texture_size;
+  coords[5] = 1;
+
+  return 3;
+}
+
+static void
+st_theme_node_paint_sliced_prerendered (StThemeNode           *node,
+                                        const ClutterActorBox *box,
+                                        guint8                 paint_opacity)
+{
+  float xpos[4], ypos[4], s[6], t[6];
+  float rects[9 * 8];
+  int n_x, n_y, i, j, n_rects = 0;
+
+  n_x = compute_slice_segments (node->prerendered_x_sliced,
+                                node->slice[ST_SIDE_LEFT], node->slice[ST_SIDE_RIGHT],
+                                box->x2 - box->x1, node->slice_width,
+                                xpos, s);
+  n_y = compute_slice_segments (node->prerendered_y_sliced,
+                                node->slice[ST_SIDE_TOP], node->slice[ST_SIDE_BOTTOM],
+                                box->y2 - box->y1, node->slice_height,
+                                ypos, t);
+
+  for (j = 0; j < n_y; j++)
+    for (i = 0; i < n_x; i++)
+      {
+        float *rect = &rects[8 * n_rects];
+
+        if (xpos[i] == xpos[i + 1] || ypos[j] == ypos[j + 1])
+          continue;
+
+        rect[0] = box->x1 + xpos[i];
+        rect[1] = box->y1 + ypos[j];
+        rect[2] = box->x1 + xpos[i + 1];
+        rect[3] = box->y1 + ypos[j + 1];
+        rect[4] = s[2 * i];
+        rect[5] = t[2 * j];
+        rect[6] = s[2 * i + 1];
+        rect[7] = t[2 * j + 1];
+
+        n_rects++;
+      }
+
+  cogl_material_set_color4ub (node->prerendered_material,
+                              paint_opacity, paint_opacity, paint_opacity, paint_opacity);
+  cogl_set_source (node->prerendered_material);
+  cogl_rectangles_with_texture_coords (rects, n_rects);
+  _st_statistics_increment (ST_STATISTIC_THEME_NODE_DRAW_CALLS);
+}
+
 void
 _st_theme_node_free_drawing_state (StThemeNode  *node)
 {
@@ -1303,6 +1498,8 @@ _st_theme_node_init_drawing_state (StThemeNode *node)
   node->border_slices_material = COGL_INVALID_HANDLE;
   node->prerendered_texture = COGL_INVALID_HANDLE;
   node->prerendered_material = COGL_INVALID_HANDLE;
+  node->prerendered_x_sliced = FALSE;
+  node->prerendered_y_sliced = FALSE;
 
   for (corner_id = 0; corner_id < 4; corner_id++)
     node->corner_material[corner_id] = COGL_INVALID_HANDLE;
@@ -1414,7 +1611,25 @@ st_theme_node_render_resources (StThemeNode   *node,
       || (has_inset_box_shadow && (has_border || node->background_color.alpha > 0))
       || (background_image && (has_border || has_border_radius))
       || has_large_corners)
-    node->prerendered_texture = st_theme_node_prerender_background (node);
+    {
+      /* Where possible, render once at a minimal size and stretch the
+       * result, so that animated size changes don't re-rasterize
+       */
+      if (st_theme_node_compute_slices (node, width, height))
+        {
+          node->alloc_width = node->slice_width;
+          node->alloc_height = node->slice_height;
+
+          node->prerendered_texture = st_theme_node_prerender_background (node);
+
+          node->alloc_width = width;
+          node->alloc_height = height;
+        }
+      else
+        {
+          node->prerendered_texture = st_theme_node_prerender_background (node);
+        }
+    }
 
   if (node->prerendered_texture)
     node->prerendered_material = _st_create_texture_material (node->prerendered_texture);
@@ -1505,6 +1720,8 @@ paint_material_with_opacity (CoglHandle       material,
                                         coords->x1, coords->y1, coords->x2, coords->y2);
   else
     cogl_rectangle (box->x1, box->y1, box->x2, box->y2);
+
+  _st_statistics_increment (ST_STATISTIC_THEME_NODE_DRAW_CALLS);
 }
 
 static void
@@ -1607,45 +1824,71 @@ st_theme_node_paint_borders (StThemeNode           *node,
                              : height - border_width[ST_SIDE_BOTTOM];
 
           cogl_rectangles (rects, 4);
+          _st_statistics_increment (ST_STATISTIC_THEME_NODE_DRAW_CALLS);
         }
     }
 
-  /* corners */
+  /* corners; corners with the same radius and colors share a material,
+   * so we draw all the corners using one material in one go */
   if (max_border_radius > 0 && paint_opacity > 0)
     {
+      float corner_rects[4 * 8];
+      gboolean corner_done[4] = { FALSE, FALSE, FALSE, FALSE };
+
       for (corner_id = 0; corner_id < 4; corner_id++)
         {
-          if (node->corner_material[corner_id] == COGL_INVALID_HANDLE)
-            continue;
+          CoglHandle material = node->corner_material[corner_id];
+          int other_id, n_rects = 0;
 
-          cogl_material_set_color4ub (node->corner_material[corner_id],
-                                      paint_opacity, paint_opacity,
-                                      paint_opacity, paint_opacity);
-          cogl_set_source (node->corner_material[corner_id]);
+          if (material == COGL_INVALID_HANDLE || corner_done[corner_id])
+            continue;
 
-          switch (corner_id)
+          for (other_id = corner_id; other_id < 4; other_id++)
             {
-              case ST_CORNER_TOPLEFT:
-                cogl_rectangle_with_texture_coords (0, 0,
-                                                    max_width_radius[ST_CORNER_TOPLEFT], max_width_radius[ST_CORNER_TOPLEFT],
-                                                    0, 0, 0.5, 0.5);
-                break;
-              case ST_CORNER_TOPRIGHT:
-                cogl_rectangle_with_texture_coords (width - max_width_radius[ST_CORNER_TOPRIGHT], 0,
-                                                    width, max_width_radius[ST_CORNER_TOPRIGHT],
-                                                    0.5, 0, 1, 0.5);
-                break;
-              case ST_CORNER_BOTTOMRIGHT:
-                cogl_rectangle_with_texture_coords (width - max_width_radius[ST_CORNER_BOTTOMRIGHT], height - max_width_radius[ST_CORNER_BOTTOMRIGHT],
-                                                    width, height,
-                                                    0.5, 0.5, 1, 1);
-                break;
-              case ST_CORNER_BOTTOMLEFT:
-                cogl_rectangle_with_texture_coords (0, height - max_width_radius[ST_CORNER_BOTTOMLEFT],
-                                                    max_width_radius[ST_CORNER_BOTTOMLEFT], height,
-                                                    0, 0.5, 0.5, 1);
-                break;
+              float *rect = &corner_rects[n_rects * 8];
+              float r = max_width_radius[other_id];
+
+              if (node->corner_material[other_id] != material)
+                continue;
+
+              switch (other_id)
+                {
+                  case ST_CORNER_TOPLEFT:
+                    rect[0] = 0;         rect[1] = 0;
+                    rect[2] = r;         rect[3] = r;
+                    rect[4] = 0;         rect[5] = 0;
+                    rect[6] = 0.5;       rect[7] = 0.5;
+                    break;
+                  case ST_CORNER_TOPRIGHT:
+                    rect[0] = width - r; rect[1] = 0;
+                    rect[2] = width;     rect[3] = r;
+                    rect[4] = 0.5;       rect[5] = 0;
+                    rect[6] = 1;         rect[7] = 0.5;
+                    break;
+                  case ST_CORNER_BOTTOMRIGHT:
+                    rect[0] = width - r; rect[1] = height - r;
+                    rect[2] = width;     rect[3] = height;
+                    rect[4] = 0.5;       rect[5] = 0.5;
+                    rect[6] = 1;         rect[7] = 1;
+                    break;
+                  case ST_CORNER_BOTTOMLEFT:
+                    rect[0] = 0;         rect[1] = height - r;
+                    rect[2] = r;         rect[3] = height;
+                    rect[4] = 0;         rect[5] = 0.5;
+                    rect[6] = 0.5;       rect[7] = 1;
+                    break;
+                }
+
+              corner_done[other_id] = TRUE;
+              n_rects++;
             }
+
+          cogl_material_set_color4ub (material,
+                                      paint_opacity, paint_opacity,
+                                      paint_opacity, paint_opacity);
+          cogl_set_source (material);
+          cogl_rectangles_with_texture_coords (corner_rects, n_rects);
+          _st_statistics_increment (ST_STATISTIC_THEME_NODE_DRAW_CALLS);
         }
     }
 
@@ -1653,6 +1896,10 @@ st_theme_node_paint_borders (StThemeNode           *node,
   alpha = paint_opacity * node->background_color.alpha / 255;
   if (alpha > 0)
     {
+      /* up to 2 padding rectangles per corner, and 3 for the rest */
+      float bg_rects[11 * 4];
+      int n_bg_rects = 0;
+
       cogl_set_source_color4ub (node->background_color.red,
                                 node->background_color.green,
                                 node->background_color.blue,
@@ -1664,7 +1911,7 @@ st_theme_node_paint_borders (StThemeNode           *node,
        */
       for (corner_id = 0; corner_id < 4; corner_id++)
         {
-          float verts[8];
+          float *verts = &bg_rects[n_bg_rects * 4];
           int n_rects;
 
           /* corner texture does not need padding */
@@ -1740,7 +1987,7 @@ st_theme_node_paint_borders (StThemeNode           *node,
                   }
                 break;
             }
-          cogl_rectangles (verts, n_rects);
+          n_bg_rects += n_rects;
         }
 
       /* Once we've drawn the borders and corners, if the corners are bigger
@@ -1755,20 +2002,33 @@ st_theme_node_paint_borders (StThemeNode           *node,
        * necessary, then the main rectangle
        */
       if (max_border_radius > border_width[ST_SIDE_TOP])
-        cogl_rectangle (MAX(max_border_radius, border_width[ST_SIDE_LEFT]),
-                        border_width[ST_SIDE_TOP],
-                        width - MAX(max_border_radius, border_width[ST_SIDE_RIGHT]),
-                        max_border_radius);
+        {
+          float *verts = &bg_rects[n_bg_rects++ * 4];
+
+          verts[0] = MAX(max_border_radius, border_width[ST_SIDE_LEFT]);
+          verts[1] = border_width[ST_SIDE_TOP];
+          verts[2] = width - MAX(max_border_radius, border_width[ST_SIDE_RIGHT]);
+          verts[3] = max_border_radius;
+        }
       if (max_border_radius > border_width[ST_SIDE_BOTTOM])
-        cogl_rectangle (MAX(max_border_radius, border_width[ST_SIDE_LEFT]),
-                        height - max_border_radius,
-                        width - MAX(max_border_radius, border_width[ST_SIDE_RIGHT]),
-                        height - border_width[ST_SIDE_BOTTOM]);
-
-      cogl_rectangle (border_width[ST_SIDE_LEFT],
-                      MAX(border_width[ST_SIDE_TOP], max_border_radius),
-                      width - border_width[ST_SIDE_RIGHT],
-                      height - MAX(border_width[ST_SIDE_BOTTOM], max_border_radius));
+        {
+          float *verts = &bg_rects[n_bg_rects++ * 4];
+
+          verts[0] = MAX(max_border_radius, border_width[ST_SIDE_LEFT]);
+          verts[1] = height - max_border_radius;
+          verts[2] = width - MAX(max_border_radius, border_width[ST_SIDE_RIGHT]);
+          verts[3] = height - border_width[ST_SIDE_BOTTOM];
+        }
+
+      bg_rects[n_bg_rects * 4 + 0] = border_width[ST_SIDE_LEFT];
+      bg_rects[n_bg_rects * 4 + 1] = MAX(border_width[ST_SIDE_TOP], max_border_radius);
+      bg_rects[n_bg_rects * 4 + 2] = width - border_width[ST_SIDE_RIGHT];
+      bg_rects[n_bg_rects * 4 + 3] = height - MAX(border_width[ST_SIDE_BOTTOM], max_border_radius);
+      n_bg_rects++;
+
+      /* All of the background in a single call */
+      cogl_rectangles (bg_rects, n_bg_rects);
+      _st_statistics_increment (ST_STATISTIC_THEME_NODE_DRAW_CALLS);
     }
 }
 
@@ -1862,6 +2122,7 @@ st_theme_node_paint_sliced_border_image (StThemeNode           *node,
     };
 
     cogl_rectangles_with_texture_coords (rectangles, 9);
+    _st_statistics_increment (ST_STATISTIC_THEME_NODE_DRAW_CALLS);
   }
 }
 
@@ -1922,6 +2183,7 @@ st_theme_node_paint_outline (StThemeNode           *node,
   rects[15] = height;
 
   cogl_rectangles (rects, 4);
+  _st_statistics_increment (ST_STATISTIC_THEME_NODE_DRAW_CALLS);
 }
 
 void
@@ -1943,7 +2205,18 @@ st_theme_node_paint (StThemeNode           *node,
     return;
 
   if (node->alloc_width != width || node->alloc_height != height)
-    st_theme_node_render_resources (node, width, height);
+    {
+      if (st_theme_node_can_reuse_slices (node, width, height))
+        {
+          node->alloc_width = width;
+          node->alloc_height = height;
+          _st_statistics_increment (ST_STATISTIC_SLICED_PAINTS);
+        }
+      else
+        {
+          st_theme_node_render_resources (node, width, height);
+        }
+    }
 
   /* Rough notes about the relationship of borders and backgrounds in CSS3;
    * see http://www.w3.org/TR/css3-background/ for more accurate details.
@@ -1972,10 +2245,13 @@ st_theme_node_paint (StThemeNode           *node,
    */
 
   if (node->box_shadow_material)
-    _st_paint_shadow_with_opacity (node->box_shadow,
-                                   node->box_shadow_material,
-                                   &allocation,
-                                   paint_opacity);
+    {
+      _st_paint_shadow_with_opacity (node->box_shadow,
+                                     node->box_shadow_material,
+                                     &allocation,
+                                     paint_opacity);
+      _st_statistics_increment (ST_STATISTIC_THEME_NODE_DRAW_CALLS);
+    }
 
   if (node->prerendered_material != COGL_INVALID_HANDLE ||
       node->border_slices_material != COGL_INVALID_HANDLE)
@@ -1984,14 +2260,21 @@ st_theme_node_paint (StThemeNode           *node,
         {
           ClutterActorBox paint_box;
 
-          st_theme_node_get_background_paint_box (node,
-                                                  &allocation,
-                                                  &paint_box);
-
-          paint_material_with_opacity (node->prerendered_material,
-                                       &paint_box,
-                                       NULL,
-                                       paint_opacity);
+          if (node->prerendered_x_sliced || node->prerendered_y_sliced)
+            {
+              st_theme_node_paint_sliced_prerendered (node, &allocation, paint_opacity);
+            }
+          else
+            {
+              st_theme_node_get_background_paint_box (node,
+                                                      &allocation,
+                                                      &paint_box);
+
+              paint_material_with_opacity (node->prerendered_material,
+                                           &paint_box,
+                                           NULL,
+                                           paint_opacity);
+            }
         }
 
       if (node->border_slices_material != COGL_INVALID_HANDLE)
@@ -2035,10 +2318,13 @@ st_theme_node_paint (StThemeNode           *node,
        * to logically confine it.
        */
       if (node->background_shadow_material != COGL_INVALID_HANDLE)
-        _st_paint_shadow_with_opacity (node->background_image_shadow,
-                                       node->background_shadow_material,
-                                       &background_box,
-                                       paint_opacity);
+        {
+          _st_paint_shadow_with_opacity (node->background_image_shadow,
+                                         node->background_shadow_material,
+                                         &background_box,
+                                         paint_opacity);
+          _st_statistics_increment (ST_STATISTIC_THEME_NODE_DRAW_CALLS);
+        }
 
       paint_material_with_opacity (node->background_material,
                                    &background_box,
@@ -2096,6 +2382,12 @@ st_theme_node_copy_cached_paint_state (StThemeNode *node,
     node->prerendered_texture = cogl_handle_ref (other->prerendered_texture);
   if (other->prerendered_material)
     node->prerendered_material = cogl_handle_ref (other->prerendered_material);
+
+  node->prerendered_x_sliced = other->prerendered_x_sliced;
+  node->prerendered_y_sliced = other->prerendered_y_sliced;
+  node->slice_width = other->slice_width;
+  node->slice_height = other->slice_height;
+  memcpy (node->slice, other->slice, sizeof (node->slice));
   for (corner_id = 0; corner_id < 4; corner_id++)
     if (other->corner_material[corner_id])
       node->corner_material[corner_id] = cogl_handle_ref (other->corner_material[corner_id]);
@@ -2107,3 +2399,19 @@ st_theme_node_invalidate_paint_state (StThemeNode *node)
   node->alloc_width = 0;
   node->alloc_height = 0;
 }
+
+/**
+ * st_theme_node_discard_paint_state:
+ * @node: a #StThemeNode
+ *
+ * Frees the textures and materials kept for painting @node. They are
+ * created again the next time the node is painted.
+ */
+void
+st_theme_node_discard_paint_state (StThemeNode *node)
+{
+  g_return_if_fail (ST_IS_THEME_NODE (node));
+
+  _st_theme_node_free_drawing_state (node);
+  st_theme_node_invalidate_paint_state (node);
+}
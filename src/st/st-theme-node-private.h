@@ -113,6 +113,13 @@ struct _StThemeNode {
   CoglHandle prerendered_texture;
   CoglHandle prerendered_material;
   CoglHandle corner_material[4];
+
+  /* Nine-slice layout of prerendered_texture, if it can be stretched */
+  guint prerendered_x_sliced : 1;
+  guint prerendered_y_sliced : 1;
+  float slice_width;
+  float slice_height;
+  float slice[4];
 };
 
 struct _StThemeNodeClass {
@@ -123,6 +130,9 @@ struct _StThemeNodeClass {
 void _st_theme_node_ensure_background (StThemeNode *node);
 void _st_theme_node_ensure_geometry (StThemeNode *node);
 
+gboolean _st_theme_node_properties_equal (StThemeNode *node_a,
+                                          StThemeNode *node_b);
+
 void _st_theme_node_init_drawing_state (StThemeNode *node);
 void _st_theme_node_free_drawing_state (StThemeNode *node);
 
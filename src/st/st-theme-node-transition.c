@@ -20,6 +20,7 @@
  */
 
 #include "st-theme-node-transition.h"
+#include "st-offscreen-pool.h"
 
 enum {
   COMPLETED,
@@ -39,6 +40,13 @@ struct _StThemeNodeTransitionPrivate {
   CoglHandle old_offscreen;
   CoglHandle new_offscreen;
 
+  /* The pooled textures may be bigger than the offscreen box, and
+   * not necessarily of the same size */
+  float old_tex_width_fraction;
+  float old_tex_height_fraction;
+  float new_tex_width_fraction;
+  float new_tex_height_fraction;
+
   CoglHandle material;
 
   ClutterTimeline *timeline;
@@ -212,6 +220,27 @@ st_theme_node_transition_get_paint_box (StThemeNodeTransition *transition,
   paint_box->y2 = MAX (old_node_box.y2, new_node_box.y2);
 }
 
+static void
+release_framebuffers (StThemeNodeTransition *transition)
+{
+  StThemeNodeTransitionPrivate *priv = transition->priv;
+
+  /* The offscreens belong to the pool along with the textures */
+  if (priv->old_texture)
+    {
+      _st_offscreen_pool_release (priv->old_texture);
+      priv->old_texture = NULL;
+      priv->old_offscreen = NULL;
+    }
+
+  if (priv->new_texture)
+    {
+      _st_offscreen_pool_release (priv->new_texture);
+      priv->new_texture = NULL;
+      priv->new_offscreen = NULL;
+    }
+}
+
 static gboolean
 setup_framebuffers (StThemeNodeTransition *transition,
                     const ClutterActorBox *allocation)
@@ -229,31 +258,20 @@ setup_framebuffers (StThemeNodeTransition *transition,
   g_return_val_if_fail (width  > 0, FALSE);
   g_return_val_if_fail (height > 0, FALSE);
 
-  if (priv->old_texture)
-    cogl_handle_unref (priv->old_texture);
-  priv->old_texture = cogl_texture_new_with_size (width, height,
-                                                  COGL_TEXTURE_NO_SLICING,
-                                                  COGL_PIXEL_FORMAT_ANY);
-
-  if (priv->new_texture)
-    cogl_handle_unref (priv->new_texture);
-  priv->new_texture = cogl_texture_new_with_size (width, height,
-                                                  COGL_TEXTURE_NO_SLICING,
-                                                  COGL_PIXEL_FORMAT_ANY);
+  release_framebuffers (transition);
 
+  priv->old_texture = _st_offscreen_pool_acquire (width, height, FALSE,
+                                                  &priv->old_offscreen);
   g_return_val_if_fail (priv->old_texture != COGL_INVALID_HANDLE, FALSE);
-  g_return_val_if_fail (priv->new_texture != COGL_INVALID_HANDLE, FALSE);
-
-  if (priv->old_offscreen)
-    cogl_handle_unref (priv->old_offscreen);
-  priv->old_offscreen = cogl_offscreen_new_to_texture (priv->old_texture);
 
-  if (priv->new_offscreen)
-    cogl_handle_unref (priv->new_offscreen);
-  priv->new_offscreen = cogl_offscreen_new_to_texture (priv->new_texture);
+  priv->new_texture = _st_offscreen_pool_acquire (width, height, FALSE,
+                                                  &priv->new_offscreen);
+  g_return_val_if_fail (priv->new_texture != COGL_INVALID_HANDLE, FALSE);
 
-  g_return_val_if_fail (priv->old_offscreen != COGL_INVALID_HANDLE, FALSE);
-  g_return_val_if_fail (priv->new_offscreen != COGL_INVALID_HANDLE, FALSE);
+  priv->old_tex_width_fraction = (float) width / cogl_texture_get_width (priv->old_texture);
+  priv->old_tex_height_fraction = (float) height / cogl_texture_get_height (priv->old_texture);
+  priv->new_tex_width_fraction = (float) width / cogl_texture_get_width (priv->new_texture);
+  priv->new_tex_height_fraction = (float) height / cogl_texture_get_height (priv->new_texture);
 
   if (priv->material == NULL)
     {
@@ -282,6 +300,7 @@ setup_framebuffers (StThemeNodeTransition *transition,
 
   cogl_push_framebuffer (priv->old_offscreen);
   cogl_clear (&clear_color, COGL_BUFFER_BIT_COLOR);
+  cogl_set_viewport (0, 0, width, height);
   cogl_ortho (priv->offscreen_box.x1, priv->offscreen_box.x2,
               priv->offscreen_box.y2, priv->offscreen_box.y1,
               0.0, 1.0);
@@ -290,6 +309,7 @@ setup_framebuffers (StThemeNodeTransition *transition,
 
   cogl_push_framebuffer (priv->new_offscreen);
   cogl_clear (&clear_color, COGL_BUFFER_BIT_COLOR);
+  cogl_set_viewport (0, 0, width, height);
   cogl_ortho (priv->offscreen_box.x1, priv->offscreen_box.x2,
               priv->offscreen_box.y2, priv->offscreen_box.y1,
               0.0, 1.0);
@@ -307,10 +327,7 @@ st_theme_node_transition_paint (StThemeNodeTransition *transition,
   StThemeNodeTransitionPrivate *priv = transition->priv;
 
   CoglColor constant;
-  float tex_coords[] = {
-    0.0, 0.0, 1.0, 1.0,
-    0.0, 0.0, 1.0, 1.0,
-  };
+  float tex_coords[8];
 
   g_return_if_fail (ST_IS_THEME_NODE (priv->old_theme_node));
   g_return_if_fail (ST_IS_THEME_NODE (priv->new_theme_node));
@@ -329,6 +346,14 @@ st_theme_node_transition_paint (StThemeNodeTransition *transition,
         return;
     }
 
+  /* Layer 0 is the new texture, layer 1 the old one */
+  tex_coords[0] = tex_coords[4] = 0.0;
+  tex_coords[1] = tex_coords[5] = 0.0;
+  tex_coords[2] = priv->new_tex_width_fraction;
+  tex_coords[3] = priv->new_tex_height_fraction;
+  tex_coords[6] = priv->old_tex_width_fraction;
+  tex_coords[7] = priv->old_tex_height_fraction;
+
   cogl_color_set_from_4f (&constant, 0., 0., 0.,
                           clutter_timeline_get_progress (priv->timeline));
   cogl_material_set_layer_combine_constant (priv->material, 1, &constant);
@@ -362,29 +387,7 @@ st_theme_node_transition_dispose (GObject *object)
       priv->new_theme_node = NULL;
     }
 
-  if (priv->old_texture)
-    {
-      cogl_handle_unref (priv->old_texture);
-      priv->old_texture = NULL;
-    }
-
-  if (priv->new_texture)
-    {
-      cogl_handle_unref (priv->new_texture);
-      priv->new_texture = NULL;
-    }
-
-  if (priv->old_offscreen)
-    {
-      cogl_handle_unref (priv->old_offscreen);
-      priv->old_offscreen = NULL;
-    }
-
-  if (priv->new_offscreen)
-    {
-      cogl_handle_unref (priv->new_offscreen);
-      priv->new_offscreen = NULL;
-    }
+  release_framebuffers (ST_THEME_NODE_TRANSITION (object));
 
   if (priv->material)
     {
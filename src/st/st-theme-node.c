@@ -460,6 +460,53 @@ ensure_properties (StThemeNode *node)
     }
 }
 
+/**
+ * _st_theme_node_properties_equal:
+ * @node_a: first #StThemeNode
+ * @node_b: second #StThemeNode
+ *
+ * Checks whether two nodes with the same parent matched the same
+ * declarations, in the same order. If so, looking up any property,
+ * inherited or not, gives the same result on both.
+ *
+ * Returns: %TRUE if the nodes have the same style properties
+ */
+gboolean
+_st_theme_node_properties_equal (StThemeNode *node_a,
+                                 StThemeNode *node_b)
+{
+  CRDeclaration *cur_decl;
+  int n_inline = 0;
+  int i;
+
+  if (node_a == node_b)
+    return TRUE;
+
+  if (node_a->parent_node != node_b->parent_node ||
+      node_a->theme != node_b->theme ||
+      g_strcmp0 (node_a->inline_style, node_b->inline_style))
+    return FALSE;
+
+  ensure_properties (node_a);
+  ensure_properties (node_b);
+
+  if (node_a->n_properties != node_b->n_properties)
+    return FALSE;
+
+  /* The inline declarations come last, and are parsed separately for
+   * each node; we already know they come from the same string. */
+  for (cur_decl = node_a->inline_properties; cur_decl; cur_decl = cur_decl->next)
+    n_inline++;
+
+  for (i = 0; i < node_a->n_properties - n_inline; i++)
+    {
+      if (node_a->properties[i] != node_b->properties[i])
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
 typedef enum {
   VALUE_FOUND,
   VALUE_NOT_FOUND,
@@ -36,6 +36,11 @@ char *_st_theme_resolve_url (StTheme      *theme,
 
 CRDeclaration *_st_theme_parse_declaration_list (const char *str);
 
+gboolean _st_theme_ancestor_selectors_match (StTheme     *theme,
+                                             StThemeNode *node,
+                                             const char  *name,
+                                             gboolean     pseudo_class);
+
 G_END_DECLS
 
 #endif /* __ST_THEME_PRIVATE_H__ */
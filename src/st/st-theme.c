@@ -72,6 +72,10 @@ struct _StTheme
   GHashTable *filenames_by_stylesheet;
 
   CRCascade *cascade;
+
+  /* Simple selectors that appear before a combinator and test a class
+   * or pseudo-class; NULL if not computed yet */
+  GPtrArray *ancestor_selectors;
 };
 
 struct _StThemeClass
@@ -238,6 +242,7 @@ st_theme_load_stylesheet (StTheme    *theme,
   insert_stylesheet (theme, path, stylesheet);
   cr_stylesheet_ref (stylesheet);
   theme->custom_stylesheets = g_slist_prepend (theme->custom_stylesheets, stylesheet);
+  g_clear_pointer (&theme->ancestor_selectors, g_ptr_array_unref);
 
   return TRUE;
 }
@@ -259,6 +264,7 @@ st_theme_unload_stylesheet (StTheme    *theme,
   g_hash_table_remove (theme->stylesheets_by_filename, path);
   g_hash_table_remove (theme->filenames_by_stylesheet, stylesheet);
   cr_stylesheet_unref (stylesheet);
+  g_clear_pointer (&theme->ancestor_selectors, g_ptr_array_unref);
 }
 
 /**
@@ -330,6 +336,7 @@ st_theme_finalize (GObject * object)
 
   g_hash_table_destroy (theme->stylesheets_by_filename);
   g_hash_table_destroy (theme->filenames_by_stylesheet);
+  g_clear_pointer (&theme->ancestor_selectors, g_ptr_array_unref);
 
   g_free (theme->application_stylesheet);
   g_free (theme->theme_stylesheet);
@@ -924,6 +931,204 @@ add_matched_properties (StTheme      *a_this,
     }
 }
 
+static gboolean
+add_sel_tests_name (CRAdditionalSel *add_sel,
+                    const char      *name,
+                    gboolean         pseudo_class)
+{
+  CRString *add_name;
+
+  if (pseudo_class && add_sel->type == PSEUDO_CLASS_ADD_SELECTOR)
+    add_name = add_sel->content.pseudo ? add_sel->content.pseudo->name : NULL;
+  else if (!pseudo_class && add_sel->type == CLASS_ADD_SELECTOR)
+    add_name = add_sel->content.class_name;
+  else
+    return FALSE;
+
+  return (add_name && add_name->stryng && add_name->stryng->str &&
+          !strqcmp (name, add_name->stryng->str, add_name->stryng->len));
+}
+
+/* Returns FALSE if an imported stylesheet hasn't been loaded yet, in
+ * which case we can't tell which selectors there are.
+ */
+static gboolean
+collect_ancestor_selectors (CRStyleSheet *sheet,
+                            GPtrArray    *selectors)
+{
+  CRStatement *cur_stmt;
+
+  for (cur_stmt = sheet->statements; cur_stmt; cur_stmt = cur_stmt->next)
+    {
+      CRSelector *sel_list = NULL;
+      CRSelector *cur_sel;
+
+      /* Look at the same statements as add_matched_properties() */
+      switch (cur_stmt->type)
+        {
+        case RULESET_STMT:
+          if (cur_stmt->kind.ruleset)
+            sel_list = cur_stmt->kind.ruleset->sel_list;
+          break;
+
+        case AT_MEDIA_RULE_STMT:
+          if (cur_stmt->kind.media_rule
+              && cur_stmt->kind.media_rule->rulesets
+              && cur_stmt->kind.media_rule->rulesets->kind.ruleset)
+            sel_list = cur_stmt->kind.media_rule->rulesets->kind.ruleset->sel_list;
+          break;
+
+        case AT_IMPORT_RULE_STMT:
+          {
+            CRAtImportRule *import_rule = cur_stmt->kind.import_rule;
+
+            if (import_rule->sheet == NULL)
+              return FALSE;
+
+            if (import_rule->sheet != (CRStyleSheet *) - 1 &&
+                !collect_ancestor_selectors (import_rule->sheet, selectors))
+              return FALSE;
+          }
+          break;
+
+        default:
+          break;
+        }
+
+      for (cur_sel = sel_list; cur_sel; cur_sel = cur_sel->next)
+        {
+          CRSimpleSel *simple_sel;
+
+          /* Every simple selector but the last one is matched
+           * against an ancestor of the styled element */
+          for (simple_sel = cur_sel->simple_sel;
+               simple_sel && simple_sel->next;
+               simple_sel = simple_sel->next)
+            {
+              CRAdditionalSel *add_sel;
+
+              for (add_sel = simple_sel->add_sel; add_sel; add_sel = add_sel->next)
+                {
+                  if (add_sel->type == CLASS_ADD_SELECTOR ||
+                      add_sel->type == PSEUDO_CLASS_ADD_SELECTOR)
+                    {
+                      g_ptr_array_add (selectors, simple_sel);
+                      break;
+                    }
+                }
+            }
+        }
+    }
+
+  return TRUE;
+}
+
+static GPtrArray *
+get_ancestor_selectors (StTheme *theme)
+{
+  GPtrArray *selectors;
+  enum CRStyleOrigin origin;
+  gboolean complete = TRUE;
+  GSList *iter;
+
+  if (theme->ancestor_selectors)
+    return theme->ancestor_selectors;
+
+  selectors = g_ptr_array_new ();
+
+  for (origin = ORIGIN_UA; origin < NB_ORIGINS && complete; origin++)
+    {
+      CRStyleSheet *sheet = cr_cascade_get_sheet (theme->cascade, origin);
+
+      if (sheet)
+        complete = collect_ancestor_selectors (sheet, selectors);
+    }
+
+  for (iter = theme->custom_stylesheets; iter && complete; iter = iter->next)
+    complete = collect_ancestor_selectors (iter->data, selectors);
+
+  if (!complete)
+    {
+      g_ptr_array_unref (selectors);
+      return NULL;
+    }
+
+  theme->ancestor_selectors = selectors;
+
+  return selectors;
+}
+
+/**
+ * _st_theme_ancestor_selectors_match:
+ * @theme: a #StTheme
+ * @node: the node of an element whose class or pseudo-class @name
+ *   was added or removed
+ * @name: the class or pseudo-class name
+ * @pseudo_class: whether @name is a pseudo-class
+ *
+ * Checks whether any selector in @theme tests @name on an ancestor of
+ * the styled element, in a way that could match @node with or without
+ * @name. If not, changing @name on @node doesn't change which rules
+ * match its descendants.
+ *
+ * Returns: %TRUE if the descendants of @node might be styled
+ *   differently, %FALSE if they certainly aren't
+ */
+gboolean
+_st_theme_ancestor_selectors_match (StTheme     *theme,
+                                    StThemeNode *node,
+                                    const char  *name,
+                                    gboolean     pseudo_class)
+{
+  GPtrArray *selectors;
+  GType element_type;
+  gboolean result = FALSE;
+  guint i;
+
+  g_return_val_if_fail (ST_IS_THEME (theme), TRUE);
+
+  selectors = get_ancestor_selectors (theme);
+  if (selectors == NULL)
+    return TRUE;
+
+  element_type = st_theme_node_get_element_type (node);
+
+  for (i = 0; i < selectors->len && !result; i++)
+    {
+      CRSimpleSel *sel = g_ptr_array_index (selectors, i);
+      CRAdditionalSel *add_sel;
+      gboolean tests_name = FALSE;
+
+      for (add_sel = sel->add_sel; add_sel && !tests_name; add_sel = add_sel->next)
+        tests_name = add_sel_tests_name (add_sel, name, pseudo_class);
+
+      if (!tests_name)
+        continue;
+
+      if ((sel->type_mask & TYPE_SELECTOR) &&
+          !(sel->name && sel->name->stryng && sel->name->stryng->str &&
+            element_name_matches_type (sel->name->stryng->str, element_type)))
+        continue;
+
+      /* Everything else in the selector has to match already */
+      result = TRUE;
+      for (add_sel = sel->add_sel; add_sel && result; add_sel = add_sel->next)
+        {
+          CRAdditionalSel single;
+
+          if (add_sel_tests_name (add_sel, name, pseudo_class))
+            continue;
+
+          /* additional_selector_matches_style() tests the whole list */
+          single = *add_sel;
+          single.next = NULL;
+          result = additional_selector_matches_style (theme, &single, node);
+        }
+    }
+
+  return result;
+}
+
 #define ORIGIN_OFFSET_IMPORTANT (NB_ORIGINS)
 #define ORIGIN_OFFSET_EXTENSION (NB_ORIGINS * 2)
 
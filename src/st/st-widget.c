@@ -39,7 +39,9 @@
 #include "st-private.h"
 #include "st-texture-cache.h"
 #include "st-theme-context.h"
+#include "st-theme-node-private.h"
 #include "st-theme-node-transition.h"
+#include "st-theme-private.h"
 
 #include "st-widget-accessible.h"
 
@@ -61,6 +63,7 @@ struct _StWidgetPrivate
 
   gboolean      is_stylable : 1;
   gboolean      is_style_dirty : 1;
+  gboolean      defer_children_style_change : 1;
   gboolean      draw_bg_color : 1;
   gboolean      draw_border_internal : 1;
   gboolean      track_hover : 1;
@@ -344,11 +347,22 @@ st_widget_dispose (GObject *gobject)
   G_OBJECT_CLASS (st_widget_parent_class)->dispose (gobject);
 }
 
+static void
+st_widget_constructed (GObject *gobject)
+{
+  if (G_OBJECT_CLASS (st_widget_parent_class)->constructed)
+    G_OBJECT_CLASS (st_widget_parent_class)->constructed (gobject);
+
+  _st_statistics_instance_created (gobject);
+}
+
 static void
 st_widget_finalize (GObject *gobject)
 {
   StWidgetPrivate *priv = ST_WIDGET (gobject)->priv;
 
+  _st_statistics_instance_finalized (gobject);
+
   g_free (priv->style_class);
   g_free (priv->pseudo_class);
   g_object_unref (priv->local_state_set);
@@ -509,6 +523,24 @@ notify_children_of_style_change (ClutterActor *self)
     }
 }
 
+/* Like notify_children_of_style_change(), but only for the widgets
+ * that use a theme of their own */
+static void
+notify_themed_children_of_style_change (ClutterActor *self)
+{
+  ClutterActorIter iter;
+  ClutterActor *actor;
+
+  clutter_actor_iter_init (&iter, self);
+  while (clutter_actor_iter_next (&iter, &actor))
+    {
+      if (ST_IS_WIDGET (actor) && ST_WIDGET (actor)->priv->theme != NULL)
+        st_widget_style_changed (ST_WIDGET (actor));
+      else
+        notify_themed_children_of_style_change (actor);
+    }
+}
+
 static void
 st_widget_real_style_changed (StWidget *self)
 {
@@ -519,7 +551,10 @@ st_widget_real_style_changed (StWidget *self)
     return;
 
   clutter_actor_queue_redraw ((ClutterActor *) self);
-  notify_children_of_style_change ((ClutterActor *) self);
+
+  /* see st_widget_class_changed() */
+  if (!priv->defer_children_style_change)
+    notify_children_of_style_change ((ClutterActor *) self);
 }
 
 void
@@ -542,6 +577,52 @@ st_widget_style_changed (StWidget *widget)
     g_object_unref (old_theme_node);
 }
 
+/* Called instead of st_widget_style_changed() when a single class or
+ * pseudo-class was added to or removed from @widget. Descendants only
+ * need a new theme node if @widget's style changed in a way they could
+ * inherit, or if the theme has a selector like ".panel-button:hover
+ * .label" that might start or stop matching them. For hover and focus
+ * changes, that is usually neither, and the subtree is left alone.
+ */
+static void
+st_widget_class_changed (StWidget   *widget,
+                         const char *name,
+                         gboolean    pseudo_class)
+{
+  StWidgetPrivate *priv = widget->priv;
+  StThemeNode *old_theme_node = priv->theme_node;
+  StThemeNode *new_theme_node;
+  StTheme *theme;
+
+  if (old_theme_node == NULL || !CLUTTER_ACTOR_IS_MAPPED (CLUTTER_ACTOR (widget)))
+    {
+      st_widget_style_changed (widget);
+      return;
+    }
+
+  g_object_ref (old_theme_node);
+
+  priv->defer_children_style_change = TRUE;
+  st_widget_style_changed (widget);
+  priv->defer_children_style_change = FALSE;
+
+  new_theme_node = priv->theme_node;
+
+  if (priv->is_stylable && new_theme_node != NULL && new_theme_node != old_theme_node)
+    {
+      theme = st_theme_node_get_theme (new_theme_node);
+
+      if (_st_theme_node_properties_equal (old_theme_node, new_theme_node) &&
+          (theme == NULL ||
+           !_st_theme_ancestor_selectors_match (theme, new_theme_node, name, pseudo_class)))
+        notify_themed_children_of_style_change (CLUTTER_ACTOR (widget));
+      else
+        notify_children_of_style_change (CLUTTER_ACTOR (widget));
+    }
+
+  g_object_unref (old_theme_node);
+}
+
 static void
 on_theme_context_changed (StThemeContext *context,
                           ClutterStage   *stage)
@@ -820,6 +901,7 @@ st_widget_class_init (StWidgetClass *klass)
 
   gobject_class->set_property = st_widget_set_property;
   gobject_class->get_property = st_widget_get_property;
+  gobject_class->constructed = st_widget_constructed;
   gobject_class->dispose = st_widget_dispose;
   gobject_class->finalize = st_widget_finalize;
 
@@ -1211,7 +1293,7 @@ st_widget_add_style_class_name (StWidget    *actor,
 
   if (add_class_name (&actor->priv->style_class, style_class))
     {
-      st_widget_style_changed (actor);
+      st_widget_class_changed (actor, style_class, FALSE);
       g_object_notify (G_OBJECT (actor), "style-class");
     }
 }
@@ -1233,7 +1315,7 @@ st_widget_remove_style_class_name (StWidget    *actor,
 
   if (remove_class_name (&actor->priv->style_class, style_class))
     {
-      st_widget_style_changed (actor);
+      st_widget_class_changed (actor, style_class, FALSE);
       g_object_notify (G_OBJECT (actor), "style-class");
     }
 }
@@ -1354,7 +1436,7 @@ st_widget_add_style_pseudo_class (StWidget    *actor,
 
   if (add_class_name (&actor->priv->pseudo_class, pseudo_class))
     {
-      st_widget_style_changed (actor);
+      st_widget_class_changed (actor, pseudo_class, TRUE);
       g_object_notify (G_OBJECT (actor), "pseudo-class");
     }
 }
@@ -1375,7 +1457,7 @@ st_widget_remove_style_pseudo_class (StWidget    *actor,
 
   if (remove_class_name (&actor->priv->pseudo_class, pseudo_class))
     {
-      st_widget_style_changed (actor);
+      st_widget_class_changed (actor, pseudo_class, TRUE);
       g_object_notify (G_OBJECT (actor), "pseudo-class");
     }
 }
@@ -1537,6 +1619,8 @@ st_widget_recompute_style (StWidget    *widget,
       return;
     }
 
+  _st_statistics_increment (ST_STATISTIC_THEME_NODES_RECOMPUTED);
+
   if (!old_theme_node ||
       !st_theme_node_geometry_equal (old_theme_node, new_theme_node))
     clutter_actor_queue_relayout ((ClutterActor *) widget);
@@ -1682,6 +1766,8 @@ st_widget_set_hover (StWidget *widget,
 
   if (priv->hover != hover)
     {
+      _st_statistics_increment (ST_STATISTIC_HOVER_CHANGES);
+
       priv->hover = hover;
       if (priv->hover)
         st_widget_add_style_pseudo_class (widget, "hover");
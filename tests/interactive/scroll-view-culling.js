@@ -0,0 +1,52 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+const Clutter = imports.gi.Clutter;
+const St = imports.gi.St;
+
+const UI = imports.testcommon.ui;
+
+const N_CHILDREN = 1000;
+
+// Checks that a scrolled St.BoxLayout only paints the children
+// that are visible through its viewport
+
+function test() {
+    let stage = new Clutter.Stage();
+    UI.init(stage);
+
+    let v = new St.ScrollView({ width: stage.width,
+                                height: stage.height });
+    stage.add_actor(v);
+
+    let b = new St.BoxLayout({ vertical: true });
+    v.add_actor(b);
+
+    for (let i = 0; i < N_CHILDREN; i++)
+        b.add(new St.Label({ text: 'Line ' + (i + 1) }));
+
+    let adjustment = v.vscroll.adjustment;
+    let positions = [ 0, 0.5, 1 ];
+    let before;
+
+    stage.connect('paint', function() {
+        before = St.statistics_get(St.Statistic.PAINTED_CHILDREN);
+    });
+    stage.connect_after('paint', function() {
+        let painted = St.statistics_get(St.Statistic.PAINTED_CHILDREN) - before;
+        let fraction = positions.shift();
+
+        if (painted <= 0 || painted >= N_CHILDREN)
+            throw new Error('Painted ' + painted + ' of ' + N_CHILDREN + ' children at ' + fraction);
+        log('Painted ' + painted + ' of ' + N_CHILDREN + ' children at ' + fraction);
+
+        if (positions.length == 0) {
+            stage.destroy();
+            return;
+        }
+
+        adjustment.value = positions[0] * (adjustment.upper - adjustment.page_size);
+    });
+
+    UI.main(stage);
+}
+test();
@@ -1,7 +1,9 @@
 // -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
 
 const Clutter = imports.gi.Clutter;
+const GLib = imports.gi.GLib;
 const Gtk = imports.gi.Gtk;
+const Mainloop = imports.mainloop;
 const St = imports.gi.St;
 
 const UI = imports.testcommon.ui;
@@ -48,6 +50,49 @@ function test() {
         b.add(t);
     }
 
+    // Scroll back and forth continuously and report the frame rate
+    let fps = new St.Label({ text: '' });
+    let autoScroll = new St.Button({ label: 'Measure FPS',
+                                     toggle_mode: true });
+    let hbox = new St.BoxLayout({ style: 'spacing: 10px;' });
+    hbox.add(autoScroll);
+    hbox.add(fps, { y_fill: false });
+    vbox.add(hbox);
+
+    let adjustment = v.vscroll.adjustment;
+    let frames = 0;
+    let direction = 1;
+
+    stage.connect('paint', function() {
+        if (!autoScroll.checked)
+            return;
+
+        frames++;
+
+        let value = adjustment.value + direction * 10;
+        if (value <= adjustment.lower || value >= adjustment.upper - adjustment.page_size)
+            direction = -direction;
+        adjustment.value = value;
+    });
+
+    autoScroll.connect('notify::checked', function () {
+        if (!autoScroll.checked)
+            return;
+
+        let start = GLib.get_monotonic_time();
+        frames = 0;
+        stage.queue_redraw();
+
+        Mainloop.timeout_add(1000, function() {
+            let now = GLib.get_monotonic_time();
+            fps.text = (frames * 1000000 / (now - start)).toFixed(1) + ' fps';
+            start = now;
+            frames = 0;
+
+            return autoScroll.checked;
+        });
+    });
+
     UI.main(stage);
 }
 test();
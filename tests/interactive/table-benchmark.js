@@ -0,0 +1,69 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+const Clutter = imports.gi.Clutter;
+const GLib = imports.gi.GLib;
+const St = imports.gi.St;
+
+const UI = imports.testcommon.ui;
+
+const N_ROWS = 25;
+const N_COLS = 20;
+const N_ITERATIONS = 200;
+
+// Times reallocating a table with hundreds of cells, once with
+// the cached column and row sizes and once forcing them to be
+// measured again, as happens when a child changes size
+
+function timeAllocations(table, box, invalidate) {
+    let start = GLib.get_monotonic_time();
+
+    for (let i = 0; i < N_ITERATIONS; i++) {
+        if (invalidate)
+            table.queue_relayout();
+        table.allocate(box, Clutter.AllocationFlags.ABSOLUTE_ORIGIN_CHANGED);
+    }
+
+    return (GLib.get_monotonic_time() - start) / N_ITERATIONS;
+}
+
+function test() {
+    let stage = new Clutter.Stage({ width: 800, height: 600 });
+    UI.init(stage);
+
+    let table = new St.Table({ style: 'spacing-rows: 2px;'
+                               + 'spacing-columns: 4px;'
+                               + 'font: 10px sans-serif;' });
+    stage.add_actor(table);
+
+    for (let row = 0; row < N_ROWS; row++) {
+        for (let col = 0; col < N_COLS; col++)
+            table.add(new St.Label({ text: row + ':' + col }),
+                      { row: row, col: col, x_expand: (col % 2) == 0 });
+    }
+
+    let id = stage.connect_after('paint', function() {
+        stage.disconnect(id);
+
+        GLib.idle_add(GLib.PRIORITY_DEFAULT, function() {
+            let box = table.get_allocation_box();
+
+            let computedBefore = St.statistics_get(St.Statistic.TABLE_TRACKS_COMPUTED);
+            let cached = timeAllocations(table, box, false);
+            let uncached = timeAllocations(table, box, true);
+            let computed = St.statistics_get(St.Statistic.TABLE_TRACKS_COMPUTED) - computedBefore;
+
+            log(N_ROWS * N_COLS + ' cells: ' +
+                cached.toFixed(1) + ' us per allocation with cached tracks, ' +
+                uncached.toFixed(1) + ' us measuring again');
+
+            if (computed != N_ITERATIONS)
+                throw new Error('Tracks computed ' + computed + ' times, expected ' + N_ITERATIONS);
+
+            stage.destroy();
+            return false;
+        });
+    });
+
+    UI.main(stage);
+}
+test();
@@ -0,0 +1,59 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+// Test cases for Shell.util_get_actor_at_pos(), which answers from the
+// geometry of the actors rather than by painting the stage
+
+const JsUnit = imports.jsUnit;
+
+const Environment = imports.ui.environment;
+Environment.init();
+
+const Clutter = imports.gi.Clutter;
+const GLib = imports.gi.GLib;
+const Shell = imports.gi.Shell;
+
+// Longer than the time an index invalidated right after being built
+// falls back to the color-buffer pick
+const INDEX_LIFETIME = 150000; // microseconds
+
+function pick(x, y) {
+    return Shell.util_get_actor_at_pos(stage, Clutter.PickMode.REACTIVE, x, y);
+}
+
+let stage = new Clutter.Stage({ width: 400, height: 400 });
+stage.show();
+
+let actor = new Clutter.Actor({ reactive: true, x: 0, y: 0,
+                                width: 100, height: 100 });
+stage.add_actor(actor);
+
+JsUnit.assertEquals('actor is picked', actor, pick(50, 50));
+JsUnit.assertEquals('stage is picked outside the actor', stage, pick(250, 50));
+
+// Moving an actor only queues a relayout; nothing is painted or
+// allocated before the next pick
+GLib.usleep(INDEX_LIFETIME);
+actor.set_position(200, 0);
+
+JsUnit.assertEquals('moved actor is picked at its new position', actor, pick(250, 50));
+JsUnit.assertEquals('moved actor is not picked at its old position', stage, pick(50, 50));
+
+// Twice in the same frame, after the index was rebuilt for the first move
+GLib.usleep(INDEX_LIFETIME);
+actor.set_position(0, 200);
+
+JsUnit.assertEquals('actor moved again is picked at its new position', actor, pick(50, 250));
+JsUnit.assertEquals('actor moved again is not picked at its old position', stage, pick(250, 50));
+
+// Actors hidden from pick are skipped, even when they move
+let dragActor = new Clutter.Actor({ reactive: true, x: 0, y: 200,
+                                    width: 100, height: 100 });
+stage.add_actor(dragActor);
+Shell.util_set_hidden_from_pick(dragActor, true);
+
+JsUnit.assertEquals('actor hidden from pick is not picked', actor, pick(50, 250));
+
+dragActor.set_position(10, 210);
+JsUnit.assertEquals('moving actor hidden from pick is not picked', actor, pick(50, 250));
+
+stage.destroy();
@@ -0,0 +1,85 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+// Test cases for tweens without time or delay, which Shell.TweenEngine
+// applies right away
+
+const JsUnit = imports.jsUnit;
+
+const Environment = imports.ui.environment;
+Environment.init();
+
+const Clutter = imports.gi.Clutter;
+const Shell = imports.gi.Shell;
+
+const Tweener = imports.ui.tweener;
+
+let engine = Shell.TweenEngine.get_default();
+
+let actor = new Clutter.Actor();
+let completed = 0;
+let id = engine.add_tween(actor, ['x'], [100], 0, 0, null, false,
+                          null, function() { completed++; });
+
+JsUnit.assertNotEquals('immediate tween has an id', 0, id);
+JsUnit.assertEquals('immediate tween sets the property', 100, actor.x);
+JsUnit.assertEquals('immediate tween completes once', 1, completed);
+JsUnit.assertEquals('immediate tween is not kept', 0, engine.get_tween_count(actor));
+
+// Through the Tweener wrapper, which only falls back to
+// imports.tweener.tweener when the engine returns no id
+actor = new Clutter.Actor();
+completed = 0;
+Tweener.addTween(actor, { y: 50,
+                          time: 0,
+                          onComplete: function() { completed++; } });
+
+JsUnit.assertEquals('immediate Tweener tween sets the property', 50, actor.y);
+JsUnit.assertEquals('immediate Tweener tween completes once', 1, completed);
+JsUnit.assertFalse('immediate Tweener tween is not kept', Tweener.isTweening(actor));
+
+// A tween added once the engine went idle starts on the first frame,
+// rather than after as long as the previous animations ran
+const GLib = imports.gi.GLib;
+const Mainloop = imports.mainloop;
+
+const FIRST_TIME = 0.5; // seconds
+const SECOND_TIME = 0.1; // seconds
+
+function runUntil(func, timeout) {
+    let timedOut = false;
+    let timeoutId = Mainloop.timeout_add(timeout, function() {
+        timedOut = true;
+        Mainloop.quit('tweenEngine');
+        return false;
+    });
+    let idleId = Mainloop.idle_add(function() {
+        if (!func())
+            return true;
+        Mainloop.quit('tweenEngine');
+        return false;
+    });
+
+    Mainloop.run('tweenEngine');
+
+    if (!timedOut)
+        Mainloop.source_remove(timeoutId);
+    else
+        Mainloop.source_remove(idleId);
+}
+
+actor = new Clutter.Actor();
+let firstDone = false;
+engine.add_tween(actor, ['x'], [100], FIRST_TIME, 0, 'linear', false,
+                 null, function() { firstDone = true; });
+runUntil(function() { return firstDone; }, 5000);
+JsUnit.assertTrue('first tween completes', firstDone);
+
+let secondStart = -1;
+let secondAdded = GLib.get_monotonic_time();
+engine.add_tween(actor, ['y'], [100], SECOND_TIME, 0, 'linear', false,
+                 function() { secondStart = GLib.get_monotonic_time(); }, null);
+runUntil(function() { return secondStart >= 0; }, 5000);
+
+JsUnit.assertTrue('tween added while idle starts', secondStart >= 0);
+JsUnit.assertTrue('tween added while idle starts without waiting for the previous session',
+                  secondStart - secondAdded < FIRST_TIME * 1000000 / 2);